@@ -7,8 +7,8 @@
 //#define STB_DIVIDE_IMPLEMENTATION
 //#include "stb_divide.h"
 
-//#define STB_DXT_IMPLEMENTATION
-//#include "stb_dxt.h"
+#define STB_DXT_IMPLEMENTATION
+#include "stb_dxt.h"
 
 //#include "stb_easy_font.h"
 
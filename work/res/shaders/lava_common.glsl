@@ -0,0 +1,18 @@
+
+// Shared by lava_vertex.glsl and lava_fragment.glsl
+// The lava lamp shader is built as a separate permutation per pass, selected with
+// the RENDER_MODE define (see LavaLamp::initialiseLavaLamp)
+
+// Render modes
+#define GLASS 0
+#define METABALL 1
+#define METAL 2
+
+#ifndef RENDER_MODE
+#define RENDER_MODE METABALL
+#endif
+
+// Maximum number of blobs the metaball pass can evaluate
+#ifndef MAX_BLOBS
+#define MAX_BLOBS 16
+#endif
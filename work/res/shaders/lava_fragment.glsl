@@ -1,5 +1,18 @@
 #version 330 core
 
+#include "lava_common.glsl"
+
+// Raymarching constants (can be overridden per permutation)
+#ifndef STEP_SIZE
+#define STEP_SIZE 0.03
+#endif
+#ifndef MAX_STEPS
+#define MAX_STEPS 400
+#endif
+#ifndef REFINE_STEPS
+#define REFINE_STEPS 3
+#endif
+
 out vec4 FragColor;
 
 // Inputs from vertex shader
@@ -7,7 +20,6 @@ in vec2 TexCoord;
 in vec3 FragPos;
 in vec3 Normal;
 
-#define MAX_BLOBS 16
 uniform vec4 uBlobPositions[MAX_BLOBS];
 uniform float uBlobRadii[MAX_BLOBS];
 uniform float uBlobBlobbiness[MAX_BLOBS];
@@ -38,10 +50,6 @@ uniform float uLampTopRadius;
 uniform float uLampHeight;
 uniform float uRadiusPadding;
 
-// Render mode: 0 = glass, 1 = metaballs, 2 = metal
-uniform int uRenderMode;
-uniform int uIsFullscreenQuad;
-
 // Compute metaball field density at a point using proper inverse power law
 float computeField(vec3 point) {
 	float fieldSum = 0.0;
@@ -206,8 +214,9 @@ vec2 rayCylinderIntersect(vec3 ro, vec3 rd, float radius, float minY, float maxY
 }
 
 void main() {
+#if RENDER_MODE == GLASS
 	// Glass rendering
-	if (uRenderMode == 0) {
+	{
 		vec3 baseColor = vec3(0.2, 0.6, 1.0);
 		vec3 shaded = simpleShading(FragPos, normalize(Normal), baseColor);
 		
@@ -220,19 +229,19 @@ void main() {
 		float alpha = mix(0.15, 0.65, fresnel);
 		
 		FragColor = vec4(shaded, alpha);
-		return;
 	}
 
+#elif RENDER_MODE == METAL
 	// Metal rendering
-	if (uRenderMode == 2) {
+	{
 		vec3 baseColor = vec3(0.7, 0.7, 0.75);
 		vec3 shaded = simpleShading(FragPos, normalize(Normal), baseColor);
 		FragColor = vec4(shaded, 1.0);
 		gl_FragDepth = gl_FragCoord.z; 
-		return;
 	}
 
-	// METABALL RAYMARCHING (uRenderMode == 1)
+#else
+	// METABALL RAYMARCHING (RENDER_MODE == METABALL)
 	vec2 uv = TexCoord; // use TexCoord for depth sampling
 	vec2 ndcXY = uv * 2.0 - 1.0;
 
@@ -269,10 +278,10 @@ void main() {
 	}
 
 	float t = tStart;
-	float stepSize = 0.03;
+	float stepSize = STEP_SIZE;
 	bool hit = false;
 	vec3 hitPos = vec3(0.0);
-	int maxSteps = 400;
+	int maxSteps = MAX_STEPS;
 	int step = 0;
 
 	// Adaptive step size based on field strength
@@ -309,7 +318,7 @@ void main() {
 				// Refine hit position with a couple binary search steps for smoother surface
 				float tHit = t;
 				float tStep = stepSize;
-				for (int refine = 0; refine < 3; refine++) {
+				for (int refine = 0; refine < REFINE_STEPS; refine++) {
 					tStep *= 0.5;
 					vec3 pTest = rayOrigin + rayDir * (tHit - tStep);
 					if (computeField(pTest) >= uThreshold) {
@@ -344,4 +353,5 @@ void main() {
 	else {
 		discard;
 	}
+#endif
 }
@@ -1,5 +1,7 @@
 #version 330 core
 
+#include "lava_common.glsl"
+
 // Vertex attributes
 layout(location = 0) in vec3 vPosition;
 layout(location = 1) in vec3 vNormal;
@@ -11,9 +13,6 @@ uniform mat4 uModelViewMatrix;
 uniform mat4 uModelMatrix;
 uniform mat4 uNormalMatrix;
 
-// New uniform to indicate fullscreen quad (pass-through)
-uniform int uIsFullscreenQuad; // 0 = normal mesh, 1 = fullscreen quad
-
 // Outputs to fragment shader
 out vec3 FragPos;   // world position (used in glass/metal mode)
 out vec3 Normal;    // world normal (used in glass/metal mode)
@@ -34,13 +33,12 @@ void main() {
 	ViewPos = viewPos.xyz;
 
 	// Final position in clip space
-	// If rendering the fullscreen quad, vPosition is already NDC/clip coords
-	if (uIsFullscreenQuad == 1) {
-		// For safety, ensure a well-formed clip position: use vPosition.xy and keep z=0, w=1
-		// (the createFullscreenQuad() sets positions in [-1,1] so this maps directly to clip)
-		gl_Position = vec4(vPosition.xy, 0.0, 1.0);
-	}
-	else {
-		gl_Position = uProjectionMatrix * viewPos;
-	}
+	// The metaball pass draws a fullscreen quad, so vPosition is already NDC/clip coords
+#if RENDER_MODE == METABALL
+	// For safety, ensure a well-formed clip position: use vPosition.xy and keep z=0, w=1
+	// (the createFullscreenQuad() sets positions in [-1,1] so this maps directly to clip)
+	gl_Position = vec4(vPosition.xy, 0.0, 1.0);
+#else
+	gl_Position = uProjectionMatrix * viewPos;
+#endif
 }
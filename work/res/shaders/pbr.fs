@@ -4,16 +4,22 @@ out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 WorldPos;
 in vec3 Normal;
+#ifdef HAS_TANGENTS
+in vec4 Tangent;
+#endif
 
 // material parameters
 uniform sampler2D albedoMap;
-uniform sampler2D normalMap;
-uniform sampler2D metallicMap;
-uniform sampler2D roughnessMap;
-uniform sampler2D aoMap;
+uniform sampler2D normalMap; // x and y only, see matt/material_cache.hpp
+uniform sampler2D ormMap;    // ao, roughness, metallic
 
 // ibl
+#ifdef IRRADIANCE_SH
+// irradiance as 9 SH coefficients, premultiplied on the CPU (see matt/sh_irradiance.cpp)
+uniform vec3 shCoeffs[9];
+#else
 uniform samplerCube irradianceMap;
+#endif
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
 
@@ -25,10 +31,28 @@ uniform vec3 camPos;
 
 const float PI = 3.14159265359;
 
-vec3 getNormalFromMap()
+#ifdef IRRADIANCE_SH
+vec3 irradianceSH(vec3 n)
 {
-    vec3 tangentNormal = texture(normalMap, TexCoords).xyz * 2.0 - 1.0;
+    vec3 e = shCoeffs[0]
+        + shCoeffs[1] * n.y + shCoeffs[2] * n.z + shCoeffs[3] * n.x
+        + shCoeffs[4] * (n.x * n.y) + shCoeffs[5] * (n.y * n.z) + shCoeffs[6] * (3.0 * n.z * n.z - 1.0)
+        + shCoeffs[7] * (n.x * n.z) + shCoeffs[8] * (n.x * n.x - n.y * n.y);
+    return max(e, vec3(0.0));
+}
+#endif
 
+vec3 getNormalFromMap()
+{
+    vec2 xy = texture(normalMap, TexCoords).rg * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+
+#ifdef HAS_TANGENTS
+    // MikkTSpace: the bitangent is rebuilt from the interpolated (unnormalised) normal and tangent
+    vec3 B = Tangent.w * cross(Normal, Tangent.xyz);
+    return normalize(tangentNormal.x * Tangent.xyz + tangentNormal.y * B + tangentNormal.z * Normal);
+#else
+    // no tangents in the mesh, reconstruct the frame from screen space derivatives
     vec3 Q1  = dFdx(WorldPos);
     vec3 Q2  = dFdy(WorldPos);
     vec2 st1 = dFdx(TexCoords);
@@ -40,6 +64,7 @@ vec3 getNormalFromMap()
     mat3 TBN = mat3(T, B, N);
 
     return normalize(TBN * tangentNormal);
+#endif
 }
 
 float DistributionGGX(vec3 N, vec3 H, float roughness)
@@ -91,9 +116,10 @@ void main()
 {
     // material parameters
     vec3 albedo = pow(texture(albedoMap, TexCoords).rgb, vec3(2.2));
-    float metallic = texture(metallicMap, TexCoords).r;
-    float roughness = texture(roughnessMap, TexCoords).r;
-    float ao = texture(aoMap, TexCoords).r;
+    vec3 orm = texture(ormMap, TexCoords).rgb;
+    float ao = orm.r;
+    float roughness = orm.g;
+    float metallic = orm.b;
 
     // lighting data
     vec3 N = getNormalFromMap();
@@ -141,7 +167,11 @@ void main()
     vec3 kD = 1.0 - kS;
     kD *= 1.0 - metallic;	  
     
+#ifdef IRRADIANCE_SH
+    vec3 irradiance = irradianceSH(N);
+#else
     vec3 irradiance = texture(irradianceMap, N).rgb;
+#endif
     vec3 diffuse      = irradiance * albedo;
     
     // sample both the pre-filter map and the BRDF lut and combine them together as per the Split-Sum approximation to get the IBL specular part.
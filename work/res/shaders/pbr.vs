@@ -2,21 +2,34 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#ifdef HAS_TANGENTS
+layout (location = 3) in vec4 aTangent; // w is the bitangent sign, see cgra::mesh_builder::generate_tangents
+#endif
 
 out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
+#ifdef HAS_TANGENTS
+out vec4 Tangent;
+#endif
 
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 uniform mat3 normalMatrix;
+#ifdef HAS_TANGENTS
+uniform mat3 tangentMatrix; // the model matrix without a packed mesh's position transform
+#endif
 
 void main()
 {
     TexCoords = aTexCoords;
     WorldPos = vec3(model * vec4(aPos, 1.0));
     Normal = normalMatrix * aNormal;   
+#ifdef HAS_TANGENTS
+    // tangents follow the surface like positions do
+    Tangent = vec4(tangentMatrix * aTangent.xyz, aTangent.w);
+#endif
 
     gl_Position =  projection * view * vec4(WorldPos, 1.0);
 }
\ No newline at end of file
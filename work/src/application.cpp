@@ -3,6 +3,7 @@
 #include <string>
 #include <chrono>
 #include <algorithm>
+#include <sstream>
 
 // glm
 #include <glm/gtc/constants.hpp>
@@ -10,12 +11,18 @@
 
 // project
 #include "application.hpp"
+#include "cgra/cgra_bvh.hpp"
 #include "cgra/cgra_geometry.hpp"
+#include "cgra/cgra_gpu_profiler.hpp"
 #include "cgra/cgra_gui.hpp"
 #include "cgra/cgra_image.hpp"
 #include "cgra/cgra_shader.hpp"
+#include "cgra/cgra_trace.hpp"
 #include "cgra/cgra_wavefront.hpp"
 
+#include "matt/brdf_lut.hpp"
+#include "matt/environment_loader.hpp"
+#include "matt/environment_manager.hpp"
 #include "matt/render_utils.hpp"
 #include "matt/pbr.hpp"
 
@@ -27,24 +34,37 @@ using namespace glm;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// the PBR spheres, drawn and picked at these places with radius 2.5
+const vec3 spherePositions[3] = { vec3(0.0, 5.0, 0.0), vec3(5.5, 5.0, 0.0), vec3(-5.5, 5.0, 0.0) };
+const char* sphereNames[3] = { "Gold sphere", "Plastic sphere", "Cloth sphere" };
+const char* lampNames[2] = { "Lava lamp glass", "Lava lamp metal" };
+const float sphereScale = 2.5f;
+
+mat4 sphereModel(int i) {
+	return translate(mat4(1), spherePositions[i]) * scale(mat4(1), vec3(sphereScale));
+}
+
 void basic_model::draw(const glm::mat4& view, const glm::mat4 proj) {
 	mat4 modelview = view * modelTransform;
 
 	glUseProgram(shader); // load shader and variables
-	glUniformMatrix4fv(glGetUniformLocation(shader, "uProjectionMatrix"), 1, GL_FALSE, value_ptr(proj));
-	glUniformMatrix4fv(glGetUniformLocation(shader, "uModelViewMatrix"), 1, GL_FALSE, value_ptr(modelview));
-	glUniform3fv(glGetUniformLocation(shader, "uColor"), 1, value_ptr(color));
+	glUniformMatrix4fv(cgra::uniform_location(shader, "uProjectionMatrix"), 1, GL_FALSE, value_ptr(proj));
+	glUniformMatrix4fv(cgra::uniform_location(shader, "uModelViewMatrix"), 1, GL_FALSE, value_ptr(modelview));
+	glUniform3fv(cgra::uniform_location(shader, "uColor"), 1, value_ptr(color));
 
 	mesh.draw(); // draw
 }
 
 
 Application::Application(GLFWwindow* window) : m_window(window) {
+	CGRA_TRACE_ZONE("Application::Application");
+	m_record_trace = trace::enabled();
+
 	buildShaders();
 
 	m_shader = m_default_shader;
 	m_model.shader = m_shader;
-	//m_model.mesh = load_wavefront_data(CGRA_SRCDIR + std::string("/res//assets//teapot.obj")).build();
+	//m_model.mesh = load_wavefront(CGRA_SRCDIR + std::string("/res//assets//teapot.obj"));
 	m_model.color = vec3(1, 0, 0);
 
 	// Initialize lava lamp using new LavaLamp API
@@ -52,10 +72,22 @@ Application::Application(GLFWwindow* window) : m_window(window) {
 		CGRA_SRCDIR + std::string("//res//shaders//lava_vertex.glsl"),
 		CGRA_SRCDIR + std::string("//res//shaders//lava_fragment.glsl")
 	);
+
+	// nothing in them moves, so they are built once
+	for (int i = 0; i < 3; i++) m_sphereScene.add(sphereBvh(), sphereModel(i));
+	m_sphereScene.build();
+	m_lampScene.add(m_lavaLamp.getGlassBvh(), mat4(1));
+	m_lampScene.add(m_lavaLamp.getMetalBvh(), mat4(1));
+	m_lampScene.build();
 }
 
 
 void Application::render() {
+	CGRA_TRACE_ZONE("Application::render");
+
+	// swaps in a requested IBL environment once it has finished loading
+	updateEnvironmentLoader();
+
 	// retrieve the window hieght
 	int width, height;
 	glfwGetFramebufferSize(m_window, &width, &height);
@@ -73,20 +105,16 @@ void Application::render() {
 	// projection matrix
 	mat4 proj = perspective(1.f, float(1280) / float(720), 0.1f, 100.f);
 
-	// model matrix
-	mat4 model = glm::mat4(1.0f);
-
 	// view matrix
 	mat4 view = translate(mat4(1), vec3(0, -6, -m_distance))
 		* rotate(mat4(1), m_pitch, vec3(1, 0, 0))
 		* rotate(mat4(1), m_yaw, vec3(0, 1, 0));
+	m_view = view;
+	m_proj = proj;
 
 	if (m_UseSkybox || m_UseSphere) {
 		// pbr
-		glUseProgram(m_pbr_shader);
-		glUniformMatrix4fv(glGetUniformLocation(m_pbr_shader, "projection"), 1, GL_FALSE, value_ptr(proj));
-		glUniformMatrix4fv(glGetUniformLocation(m_pbr_shader, "view"), 1, GL_FALSE, value_ptr(view));
-		glUniform3fv(glGetUniformLocation(m_pbr_shader, "camPos"), 1, value_ptr(vec3(inverse(view) * vec4(0, 0, 0, 1))));
+		setPBRCamera(view, proj, vec3(inverse(view) * vec4(0, 0, 0, 1)));
 
 		// bind pre-computed IBL data
 		glActiveTexture(GL_TEXTURE0);
@@ -101,45 +129,37 @@ void Application::render() {
 	}
 
 	if (m_UseSphere) {
-		// gold
-		bindPBRTextures(gold);
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(0.0, 5.0, 0.0));
-		model = glm::scale(model, glm::vec3(2.5, 2.5, 2.5));
-		glUniformMatrix4fv(glGetUniformLocation(m_pbr_shader, "model"), 1, GL_FALSE, value_ptr(model));
-		glUniformMatrix3fv(glGetUniformLocation(m_pbr_shader, "normalMatrix"), 1, GL_FALSE, value_ptr(glm::transpose(glm::inverse(glm::mat3(model)))));
-		renderSphere();
-
-		// plastic
-		bindPBRTextures(plastic);
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(5.5, 5.0, 0.0));
-		model = glm::scale(model, glm::vec3(2.5, 2.5, 2.5));
-		glUniformMatrix4fv(glGetUniformLocation(m_pbr_shader, "model"), 1, GL_FALSE, value_ptr(model));
-		glUniformMatrix3fv(glGetUniformLocation(m_pbr_shader, "normalMatrix"), 1, GL_FALSE, value_ptr(glm::transpose(glm::inverse(glm::mat3(model)))));
-		renderSphere();
-
-		bindPBRTextures(cloth);
-		model = glm::mat4(1.0f);
-		model = glm::translate(model, glm::vec3(-5.5, 5.0, 0.0));
-		model = glm::scale(model, glm::vec3(2.5, 2.5, 2.5));
-		glUniformMatrix4fv(glGetUniformLocation(m_pbr_shader, "model"), 1, GL_FALSE, value_ptr(model));
-		glUniformMatrix3fv(glGetUniformLocation(m_pbr_shader, "normalMatrix"), 1, GL_FALSE, value_ptr(glm::transpose(glm::inverse(glm::mat3(model)))));
-		renderSphere();
+		gpu_profiler::scope pass("PBR spheres");
+
+		// only the spheres at least partly in view are drawn
+		vector<uint32_t> visible;
+		m_sphereScene.cull(proj * view, visible);
+
+		// gold, plastic and cloth
+		const textureData* materials[3] = { &gold, &plastic, &cloth };
+		for (uint32_t i : visible) {
+			bindPBRTextures(*materials[i]);
+			renderSphere(sphereModel(i), view, proj, float(height));
+		}
 	}
 	if (m_UseSkybox) {
+		gpu_profiler::scope pass("Skybox");
+
 		// render skybox
 		glUseProgram(m_background_shader);
 		mat4 viewSkybox = mat4(mat3(view));
-		glUniformMatrix4fv(glGetUniformLocation(m_background_shader, "view"), 1, GL_FALSE, value_ptr(viewSkybox));
+		glUniformMatrix4fv(cgra::uniform_location(m_background_shader, "view"), 1, GL_FALSE, value_ptr(viewSkybox));
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
 		renderCube();
 	}
 
 	// helpful draw options
-	if (m_show_grid) drawGrid(view, proj);
-	if (m_show_axis) drawAxis(view, proj);
+	if (m_show_grid || m_show_axis) {
+		gpu_profiler::scope pass("Grid/axis");
+		if (m_show_grid) drawGrid(view, proj);
+		if (m_show_axis) drawAxis(view, proj);
+	}
 	glPolygonMode(GL_FRONT_AND_BACK, (m_showWireframe) ? GL_LINE : GL_FILL);
 
 	// Render lava lamp
@@ -154,6 +174,8 @@ void Application::render() {
 }
 
 void Application::renderGUI() {
+	CGRA_TRACE_ZONE("Application::renderGUI");
+
 	// setup window
 	ImGui::SetNextWindowPos(ImVec2(5, 5), ImGuiSetCond_Once);
 	ImGui::SetNextWindowSize(ImVec2(400, 350), ImGuiSetCond_Once);
@@ -172,11 +194,17 @@ void Application::renderGUI() {
 	ImGui::Checkbox("Wireframe", &m_showWireframe);
 	ImGui::SameLine();
 	if (ImGui::Button("Screenshot")) rgba_image::screenshot(true);
+	ImGui::Checkbox("Show profiler", &m_show_profiler);
+	ImGui::SameLine();
+	if (ImGui::Checkbox("Record trace", &m_record_trace)) trace::set_enabled(m_record_trace);
+	ImGui::SameLine();
+	if (ImGui::Button("Save trace")) saveTrace();
 
 	ImGui::Separator();
 	ImGui::Text("Lava Lamp Controls");
 	ImGui::Checkbox("Show Lava Lamp", &m_showLavaLamp);
 	ImGui::Checkbox("Animate", &m_animateLamp);
+	ImGui::Text("Picked: %s (click to pick)", m_picked.empty() ? "nothing" : m_picked.c_str());
 
 	// Lava lamp physics parameters
 	if (ImGui::SliderFloat("Heater Temperature", &m_heaterTemp, 20.0f, 200.0f, "%.1f")) {
@@ -194,7 +222,7 @@ void Application::renderGUI() {
 	ImGui::End();
 
 	ImGui::SetNextWindowPos(ImVec2(410, 5), ImGuiSetCond_Once);
-	ImGui::SetNextWindowSize(ImVec2(400, 200), ImGuiSetCond_Once);
+	ImGui::SetNextWindowSize(ImVec2(400, 300), ImGuiSetCond_Once);
 	ImGui::Begin("PBR Controls", 0);
 
 	ImGui::Text("Physically Based Rendering (PBR) Settings");
@@ -207,17 +235,30 @@ void Application::renderGUI() {
 	ImGui::Text("Change IBL Environment");
 	
 	if (ImGui::Button("Space Environment")) {
-		loadPBRShaders(CGRA_SRCDIR + std::string("//res//textures//space.hdr"));
+		requestEnvironment(CGRA_SRCDIR + std::string("//res//textures//space.hdr"));
 	}
 
 	if (ImGui::Button("Studio Environment")) {
-		loadPBRShaders(CGRA_SRCDIR + std::string("//res//textures//studio.hdr"));
+		requestEnvironment(CGRA_SRCDIR + std::string("//res//textures//studio.hdr"));
 	}
 
 	if (ImGui::Button("Sunset Environment")) {
-		loadPBRShaders(CGRA_SRCDIR + std::string("//res//textures//sunset.hdr"));
+		requestEnvironment(CGRA_SRCDIR + std::string("//res//textures//sunset.hdr"));
+	}
+
+	std::string loading = loadingEnvironment();
+	if (!loading.empty()) ImGui::Text("Loading %s...", loading.substr(loading.find_last_of("/\\") + 1).c_str());
+	renderEnvironmentGUI();
+
+	ImGui::Separator();
+	if (ImGui::Button("Validate BRDF LUT")) m_brdf_lut_error = validateBRDFLUT(m_brdf_shader);
+	if (m_brdf_lut_error >= 0) {
+		ImGui::SameLine();
+		ImGui::Text("CPU vs GPU max error %.2e", m_brdf_lut_error);
 	}
 	ImGui::End();
+
+	if (m_show_profiler) gpu_profiler::renderGUI(&m_show_profiler);
 }
 
 void Application::cursorPosCallback(double xpos, double ypos) {
@@ -248,6 +289,10 @@ void Application::mouseButtonCallback(int button, int action, int mods) {
 	// capture is left-mouse down
 	if (button == GLFW_MOUSE_BUTTON_LEFT)
 		m_leftMouseDown = (action == GLFW_PRESS); // only other option is GLFW_RELEASE
+
+	// a press and release without dragging the camera picks
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) m_mouseDownPosition = m_mousePosition;
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE && distance(m_mousePosition, m_mouseDownPosition) < 3.0f) pick(m_mousePosition);
 }
 
 void Application::scrollCallback(double xoffset, double yoffset) {
@@ -256,7 +301,35 @@ void Application::scrollCallback(double xoffset, double yoffset) {
 }
 
 void Application::keyCallback(int key, int scancode, int action, int mods) {
-	(void)key, (void)scancode, (void)action, (void)mods; // currently un-used
+	(void)scancode, (void)mods; // currently un-used
+
+	// dump the recent CPU trace
+	if (key == GLFW_KEY_F9 && action == GLFW_PRESS) saveTrace();
+}
+
+void Application::saveTrace() {
+	if (!trace::enabled()) {
+		cout << "Trace recording is disabled, enable it in the GUI or set CGRA_TRACE" << endl;
+		return;
+	}
+	ostringstream filename_ss;
+	filename_ss << "trace_" << (chrono::system_clock::now().time_since_epoch() / 1ms) << ".json";
+	trace::write_chrome_json(filename_ss.str(), m_trace_seconds);
+}
+
+void Application::pick(vec2 position) {
+	CGRA_TRACE_ZONE("Application::pick");
+
+	// cursor positions are in window coordinates, which differ from the framebuffer on high dpi screens
+	int width, height;
+	glfwGetWindowSize(m_window, &width, &height);
+	ray r = screen_ray(position, vec2(width, height), m_view, m_proj);
+
+	// the hit carries over between the scenes, so the second only hits if it is closer
+	ray_hit hit;
+	m_picked.clear();
+	if (m_showLavaLamp && m_lampScene.intersect(r, hit)) m_picked = lampNames[hit.instance];
+	if (m_UseSphere && m_sphereScene.intersect(r, hit)) m_picked = sphereNames[hit.instance];
 }
 
 void Application::charCallback(unsigned int c) {
@@ -1,11 +1,15 @@
 #pragma once
 
+// std
+#include <string>
+
 // glm
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 // project
 #include "opengl.hpp"
+#include "cgra/cgra_bvh.hpp"
 #include "cgra/cgra_mesh.hpp"
 
 //teammate includes
@@ -42,11 +46,29 @@ private:
 	// last input
 	bool m_leftMouseDown = false;
 	glm::vec2 m_mousePosition;
+	glm::vec2 m_mouseDownPosition; // a release near here is a click, which picks
+
+	// camera of the last frame, for picking
+	glm::mat4 m_view{ 1 };
+	glm::mat4 m_proj{ 1 };
+	std::string m_picked; // name of the last object clicked on
+
+	// the fixed objects, built once for culling and picking (instances in the order of sphereNames and lampNames)
+	cgra::scene_bvh m_sphereScene;
+	cgra::scene_bvh m_lampScene;
 
 	// drawing flags
 	bool m_show_axis = false;
 	bool m_show_grid = false;
 	bool m_showWireframe = false;
+	bool m_show_profiler = false;
+
+	// CPU trace capture (see cgra_trace.hpp)
+	bool m_record_trace = false;
+	float m_trace_seconds = 10.0f;
+
+	// result of the last BRDF LUT validation (negative if never run)
+	float m_brdf_lut_error = -1.0f;
 
 	// geometry
 	basic_model m_model;
@@ -98,4 +120,10 @@ public:
 	void scrollCallback(double xoffset, double yoffset);
 	void keyCallback(int key, int scancode, int action, int mods);
 	void charCallback(unsigned int c);
+
+	// writes the last m_trace_seconds of CPU zones to a chrome trace file
+	void saveTrace();
+
+	// casts a ray through a window position at the lamp and spheres, setting m_picked
+	void pick(glm::vec2 position);
 };
\ No newline at end of file
@@ -0,0 +1,412 @@
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef CGRA_HAVE_OPENMP
+#include <omp.h>
+#endif
+
+// project
+#include "cgra_bvh.hpp"
+#include "cgra_trace.hpp"
+#include "cgra_wavefront.hpp"
+
+
+using namespace glm;
+
+namespace cgra {
+
+	namespace {
+
+		const int g_sah_bins = 16;
+
+		// nodes with more items than this are always split
+		const uint32_t g_max_leaf_size = 8;
+
+		// cost of visiting a node, relative to testing one item
+		const float g_traversal_cost = 1.0f;
+
+		// traversal stacks deeper than this move to the heap
+		const int g_stack_size = 64;
+
+		// the nodes still to visit in a traversal, kept on the C++ stack unless the tree is unusually deep
+		template <typename T>
+		class traversal_stack {
+		private:
+			T m_local[g_stack_size];
+			std::vector<T> m_heap;
+			T *m_data = m_local;
+			size_t m_capacity = g_stack_size;
+			size_t m_size = 0;
+
+		public:
+			bool empty() const { return m_size == 0; }
+
+			void push(const T &item) {
+				if (m_size == m_capacity) {
+					if (m_heap.empty()) m_heap.assign(m_local, m_local + m_size);
+					m_capacity *= 2;
+					m_heap.resize(m_capacity);
+					m_data = m_heap.data();
+				}
+				m_data[m_size++] = item;
+			}
+
+			T pop() { return m_data[--m_size]; }
+		};
+
+		// the distance along the ray where it enters the box, or FLT_MAX if it misses within t_max
+		float slab(const aabb &b, vec3 origin, vec3 inv_direction, float t_max) {
+			vec3 t0 = (b.min - origin) * inv_direction;
+			vec3 t1 = (b.max - origin) * inv_direction;
+			vec3 lo = min(t0, t1), hi = max(t0, t1);
+			float enter = max(max(lo.x, lo.y), max(lo.z, 0.0f));
+			float exit = min(min(hi.x, hi.y), min(hi.z, t_max));
+			return enter <= exit ? enter : FLT_MAX;
+		}
+
+		// builds nodes over items with the given bounds, leaving order as the items of each leaf
+		void build_sah(const std::vector<aabb> &item_bounds, std::vector<uint32_t> &order, std::vector<bvh_node> &nodes) {
+			const uint32_t n = uint32_t(item_bounds.size());
+			order.resize(n);
+			for (uint32_t i = 0; i < n; i++) order[i] = i;
+			nodes.clear();
+			if (n == 0) return;
+			nodes.reserve(2 * n);
+
+			std::vector<vec3> centroids(n);
+			for (uint32_t i = 0; i < n; i++) centroids[i] = (item_bounds[i].min + item_bounds[i].max) * 0.5f;
+
+			nodes.push_back({ aabb(), 0, n });
+			std::vector<uint32_t> stack = { 0 };
+			while (!stack.empty()) {
+				bvh_node &node = nodes[stack.back()];
+				stack.pop_back();
+				const uint32_t first = node.first, count = node.count;
+
+				aabb centre_bounds;
+				for (uint32_t i = first; i < first + count; i++) {
+					node.bounds.grow(item_bounds[order[i]]);
+					centre_bounds.grow(centroids[order[i]]);
+				}
+				if (count <= 1) continue;
+
+				// the cheapest split between bins along any axis
+				float best_cost = FLT_MAX;
+				int best_axis = -1, best_split = 0;
+				for (int axis = 0; axis < 3; axis++) {
+					float lo = centre_bounds.min[axis], extent = centre_bounds.max[axis] - lo;
+					if (extent <= 0) continue;
+					aabb bins[g_sah_bins];
+					uint32_t counts[g_sah_bins] = {};
+					for (uint32_t i = first; i < first + count; i++) {
+						int b = std::min(int((centroids[order[i]][axis] - lo) / extent * g_sah_bins), g_sah_bins - 1);
+						bins[b].grow(item_bounds[order[i]]);
+						counts[b]++;
+					}
+
+					// areas and counts of everything right of each split, then sweep from the left
+					float right_area[g_sah_bins];
+					uint32_t right_count[g_sah_bins];
+					aabb right;
+					uint32_t rc = 0;
+					for (int b = g_sah_bins - 1; b > 0; b--) {
+						right.grow(bins[b]);
+						rc += counts[b];
+						right_area[b] = right.empty() ? 0 : right.surface_area();
+						right_count[b] = rc;
+					}
+					aabb left;
+					uint32_t lc = 0;
+					for (int b = 1; b < g_sah_bins; b++) {
+						left.grow(bins[b - 1]);
+						lc += counts[b - 1];
+						if (lc == 0 || right_count[b] == 0) continue;
+						float cost = left.surface_area() * lc + right_area[b] * right_count[b];
+						if (cost < best_cost) {
+							best_cost = cost;
+							best_axis = axis;
+							best_split = b;
+						}
+					}
+				}
+
+				// stay a leaf when splitting isn't expected to pay for the extra node
+				float leaf_cost = node.bounds.surface_area() * count;
+				if (best_axis < 0 || (count <= g_max_leaf_size && g_traversal_cost * node.bounds.surface_area() + best_cost >= leaf_cost)) continue;
+
+				float lo = centre_bounds.min[best_axis], extent = centre_bounds.max[best_axis] - lo;
+				uint32_t *mid = std::partition(order.data() + first, order.data() + first + count, [&](uint32_t i) {
+					return std::min(int((centroids[i][best_axis] - lo) / extent * g_sah_bins), g_sah_bins - 1) < best_split;
+				});
+				uint32_t left_count = uint32_t(mid - (order.data() + first));
+
+				// the children go next to each other, so a node only needs the index of the first
+				uint32_t child = uint32_t(nodes.size());
+				node.first = child;
+				node.count = 0;
+				nodes.push_back({ aabb(), first, left_count });
+				nodes.push_back({ aabb(), first + left_count, count - left_count });
+				stack.push_back(child);
+				stack.push_back(child + 1);
+			}
+		}
+
+		// cheap well mixed random numbers from a counter, so every thread can make its own rays
+		uint32_t mix_bits(uint32_t x) {
+			x ^= x >> 16; x *= 0x7feb352dU;
+			x ^= x >> 15; x *= 0x846ca68bU;
+			x ^= x >> 16;
+			return x;
+		}
+
+		float random(uint32_t &state) {
+			state = mix_bits(state + 0x9e3779b9U);
+			return float(state >> 8) / float(1 << 24);
+		}
+	}
+
+
+	float aabb::surface_area() const {
+		vec3 d = max - min;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+
+	aabb aabb::transformed(const mat4 &transform) const {
+		aabb b;
+		if (empty()) return b;
+		for (int i = 0; i < 8; i++) {
+			vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+			b.grow(vec3(transform * vec4(corner, 1)));
+		}
+		return b;
+	}
+
+
+	triangle_bvh::triangle_bvh(const mesh_builder &mb) {
+		CGRA_TRACE_ZONE("triangle_bvh::triangle_bvh");
+		if (mb.mode != GL_TRIANGLES) return;
+
+		const size_t triangle_count = mb.indices.size() / 3;
+		std::vector<aabb> bounds(triangle_count);
+		for (size_t t = 0; t < triangle_count; t++) {
+			for (int k = 0; k < 3; k++) bounds[t].grow(mb.vertices[mb.indices[t * 3 + k]].pos);
+		}
+		build_sah(bounds, m_ids, m_nodes);
+
+		// the triangles are stored in leaf order, ready for Moller-Trumbore
+		m_triangles.resize(triangle_count);
+		for (size_t i = 0; i < triangle_count; i++) {
+			uint32_t t = m_ids[i];
+			vec3 v0 = mb.vertices[mb.indices[t * 3]].pos;
+			m_triangles[i] = { v0, mb.vertices[mb.indices[t * 3 + 1]].pos - v0, mb.vertices[mb.indices[t * 3 + 2]].pos - v0 };
+		}
+	}
+
+
+	bool triangle_bvh::intersect(const ray &r, ray_hit &hit) const {
+		if (m_nodes.empty()) return false;
+		const vec3 inv_direction = 1.0f / r.direction;
+		float t_max = std::min(r.t_max, hit.t);
+		bool found = false;
+
+		// nodes to visit with where the ray enters them, which may be past a hit found since they were pushed
+		struct pending {
+			uint32_t node;
+			float entry;
+		};
+		traversal_stack<pending> stack;
+		stack.push({ 0, slab(m_nodes[0].bounds, r.origin, inv_direction, t_max) });
+		while (!stack.empty()) {
+			pending next = stack.pop();
+			if (next.entry >= t_max) continue;
+			const bvh_node &node = m_nodes[next.node];
+			if (node.count > 0) {
+				for (uint32_t i = node.first; i < node.first + node.count; i++) {
+					const triangle &tri = m_triangles[i];
+					vec3 p = cross(r.direction, tri.e2);
+					float det = dot(tri.e1, p);
+					if (det == 0) continue;
+					float inv_det = 1.0f / det;
+					vec3 s = r.origin - tri.v0;
+					float u = dot(s, p) * inv_det;
+					if (u < 0 || u > 1) continue;
+					vec3 q = cross(s, tri.e1);
+					float v = dot(r.direction, q) * inv_det;
+					if (v < 0 || u + v > 1) continue;
+					float t = dot(tri.e2, q) * inv_det;
+					if (t < 0 || t >= t_max) continue;
+					t_max = t;
+					hit.t = t;
+					hit.triangle = m_ids[i];
+					hit.barycentric = vec2(u, v);
+					found = true;
+				}
+				continue;
+			}
+
+			// visit the nearer child first, so the further one is more likely to be skipped
+			float t_near = slab(m_nodes[node.first].bounds, r.origin, inv_direction, t_max);
+			float t_far = slab(m_nodes[node.first + 1].bounds, r.origin, inv_direction, t_max);
+			uint32_t near_child = node.first, far_child = node.first + 1;
+			if (t_far < t_near) {
+				std::swap(t_near, t_far);
+				std::swap(near_child, far_child);
+			}
+			if (t_far != FLT_MAX) stack.push({ far_child, t_far });
+			if (t_near != FLT_MAX) stack.push({ near_child, t_near });
+		}
+		return found;
+	}
+
+
+	uint32_t scene_bvh::add(const triangle_bvh &mesh, const mat4 &transform) {
+		m_instances.push_back({ &mesh, transform, inverse(transform), mesh.bounds().transformed(transform) });
+		return uint32_t(m_instances.size() - 1);
+	}
+
+
+	void scene_bvh::clear() {
+		m_instances.clear();
+		m_order.clear();
+		m_nodes.clear();
+	}
+
+
+	void scene_bvh::build() {
+		std::vector<aabb> bounds(m_instances.size());
+		for (size_t i = 0; i < m_instances.size(); i++) bounds[i] = m_instances[i].bounds;
+		build_sah(bounds, m_order, m_nodes);
+	}
+
+
+	bool scene_bvh::intersect(const ray &r, ray_hit &hit) const {
+		if (m_nodes.empty()) return false;
+		const vec3 inv_direction = 1.0f / r.direction;
+		bool found = false;
+
+		traversal_stack<uint32_t> stack;
+		stack.push(0);
+		while (!stack.empty()) {
+			const bvh_node &node = m_nodes[stack.pop()];
+			if (slab(node.bounds, r.origin, inv_direction, std::min(r.t_max, hit.t)) == FLT_MAX) continue;
+			if (node.count == 0) {
+				stack.push(node.first);
+				stack.push(node.first + 1);
+				continue;
+			}
+
+			// into the instance's model space, without normalizing so t means the same thing
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				const instance &inst = m_instances[m_order[i]];
+				ray local;
+				local.origin = vec3(inst.inverse * vec4(r.origin, 1));
+				local.direction = mat3(inst.inverse) * r.direction;
+				local.t_max = r.t_max;
+				if (inst.mesh->intersect(local, hit)) {
+					hit.instance = m_order[i];
+					found = true;
+				}
+			}
+		}
+		return found;
+	}
+
+
+	void scene_bvh::cull(const mat4 &view_proj, std::vector<uint32_t> &visible) const {
+		visible.clear();
+		if (m_nodes.empty()) return;
+
+		// the six clip planes of the frustum, pointing inwards (Gribb and Hartmann)
+		mat4 m = transpose(view_proj);
+		vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+
+		std::vector<uint32_t> stack = { 0 };
+		while (!stack.empty()) {
+			const bvh_node &node = m_nodes[stack.back()];
+			stack.pop_back();
+
+			// outside if the corner furthest along any plane's normal is behind it
+			bool outside = false;
+			for (const vec4 &p : planes) {
+				vec3 corner = mix(node.bounds.min, node.bounds.max, greaterThan(vec3(p), vec3(0)));
+				if (dot(vec3(p), corner) + p.w < 0) {
+					outside = true;
+					break;
+				}
+			}
+			if (outside) continue;
+
+			if (node.count == 0) {
+				stack.push_back(node.first);
+				stack.push_back(node.first + 1);
+			} else {
+				visible.insert(visible.end(), m_order.begin() + node.first, m_order.begin() + node.first + node.count);
+			}
+		}
+	}
+
+
+	ray screen_ray(vec2 pixel, vec2 viewport_size, const mat4 &view, const mat4 &proj) {
+		vec2 ndc(2.0f * pixel.x / viewport_size.x - 1.0f, 1.0f - 2.0f * pixel.y / viewport_size.y);
+		mat4 inv = inverse(proj * view);
+		vec4 near_point = inv * vec4(ndc, -1, 1);
+		vec4 far_point = inv * vec4(ndc, 1, 1);
+		ray r;
+		r.origin = vec3(near_point) / near_point.w;
+		r.direction = vec3(far_point) / far_point.w - r.origin;
+		r.t_max = 1.0f; // the far plane
+		return r;
+	}
+
+
+	void benchmark_bvh(const std::string &filename, size_t ray_count) {
+		CGRA_TRACE_ZONE("benchmark_bvh");
+		mesh_builder mb;
+		try {
+			mb = load_wavefront_data(filename);
+		} catch (std::runtime_error &e) {
+			std::cerr << "Warning: BVH benchmark could not load " << filename << ": " << e.what() << std::endl;
+			return;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		triangle_bvh bvh(mb);
+		auto built = std::chrono::steady_clock::now();
+
+		// rays from a sphere around the mesh towards random points in its bounds, so most of them hit
+		const aabb bounds = bvh.bounds();
+		const vec3 centre = (bounds.min + bounds.max) * 0.5f;
+		const float radius = length(bounds.max - bounds.min);
+		const int64_t count = int64_t(ray_count);
+		int64_t hits = 0;
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic, 4096) reduction(+:hits)
+#endif
+		for (int64_t i = 0; i < count; i++) {
+			uint32_t state = uint32_t(i);
+			float z = 2.0f * random(state) - 1.0f, a = 6.2831853f * random(state);
+			float s = std::sqrt(1.0f - z * z);
+			ray r;
+			r.origin = centre + radius * vec3(s * std::cos(a), s * std::sin(a), z);
+			r.direction = mix(bounds.min, bounds.max, vec3(random(state), random(state), random(state))) - r.origin;
+			ray_hit hit;
+			if (bvh.intersect(r, hit)) hits++;
+		}
+		auto traced = std::chrono::steady_clock::now();
+
+		int threads = 1;
+#ifdef CGRA_HAVE_OPENMP
+		threads = omp_get_max_threads();
+#endif
+		double build_ms = std::chrono::duration<double, std::milli>(built - start).count();
+		double trace_s = std::chrono::duration<double>(traced - built).count();
+		std::cout << "BVH benchmark " << filename << ": " << bvh.triangle_count() << " triangles, " << bvh.node_count()
+			<< " nodes, built in " << build_ms << "ms, " << (ray_count / trace_s / 1e6) << " Mrays/s on " << threads
+			<< " threads (" << (100.0 * hits / std::max<size_t>(ray_count, 1)) << "% hit)" << std::endl;
+	}
+}
@@ -0,0 +1,111 @@
+
+#pragma once
+
+// std
+#include <cfloat>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "cgra_mesh.hpp"
+
+
+namespace cgra {
+
+	struct ray {
+		glm::vec3 origin{0};
+		glm::vec3 direction{0, 0, -1}; // not necessarily normalized, t is in multiples of it
+		float t_max = FLT_MAX;
+	};
+
+	struct ray_hit {
+		float t = FLT_MAX;
+		uint32_t triangle = ~uint32_t(0); // index of the triangle in its mesh builder
+		uint32_t instance = ~uint32_t(0); // from scene_bvh::add
+		glm::vec2 barycentric{0}; // weights of the triangle's second and third vertices
+
+		bool valid() const { return triangle != ~uint32_t(0); }
+	};
+
+	struct aabb {
+		glm::vec3 min{FLT_MAX};
+		glm::vec3 max{-FLT_MAX};
+
+		void grow(glm::vec3 p) { min = glm::min(min, p); max = glm::max(max, p); }
+		void grow(const aabb &b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+		bool empty() const { return min.x > max.x; }
+		float surface_area() const;
+
+		// the bounds of this box after a transform
+		aabb transformed(const glm::mat4 &transform) const;
+	};
+
+	struct bvh_node {
+		aabb bounds;
+		uint32_t first; // first child (the second follows it), or the first item of a leaf
+		uint32_t count; // items in a leaf, 0 for an inner node
+	};
+
+
+	// A bounding volume hierarchy over the triangles of a mesh builder, for casting rays against it on the CPU.
+	// Nodes are split where the surface area heuristic says rays will be cheapest, from 16 bins per axis
+	class triangle_bvh {
+	private:
+		struct triangle {
+			glm::vec3 v0, e1, e2;
+		};
+		std::vector<bvh_node> m_nodes;
+		std::vector<triangle> m_triangles; // in leaf order
+		std::vector<uint32_t> m_ids; // the mesh triangle each of m_triangles came from
+
+	public:
+		triangle_bvh() {}
+		explicit triangle_bvh(const mesh_builder &mb); // GL_TRIANGLES only
+
+		// finds the closest hit nearer than both r.t_max and hit.t, updating hit and returning true if there is one
+		bool intersect(const ray &r, ray_hit &hit) const;
+
+		aabb bounds() const { return m_nodes.empty() ? aabb() : m_nodes[0].bounds; }
+		size_t node_count() const { return m_nodes.size(); }
+		size_t triangle_count() const { return m_triangles.size(); }
+	};
+
+
+	// A bounding volume hierarchy over transformed triangle_bvhs, for picking objects in a scene
+	// and culling them against the view frustum. Call build() after adding instances
+	class scene_bvh {
+	private:
+		struct instance {
+			const triangle_bvh *mesh;
+			glm::mat4 transform;
+			glm::mat4 inverse;
+			aabb bounds; // world space
+		};
+		std::vector<instance> m_instances;
+		std::vector<uint32_t> m_order; // instances in leaf order
+		std::vector<bvh_node> m_nodes;
+
+	public:
+		// returns the id of the instance, which hits and culling report. the mesh has to outlive this
+		uint32_t add(const triangle_bvh &mesh, const glm::mat4 &transform);
+		void clear();
+		void build();
+
+		// finds the closest hit of the ray (in world space) with any instance
+		bool intersect(const ray &r, ray_hit &hit) const;
+
+		// the instances whose bounds are at least partly inside the frustum of a view projection matrix
+		void cull(const glm::mat4 &view_proj, std::vector<uint32_t> &visible) const;
+	};
+
+
+	// the world space ray through a pixel (with y down, as from glfw) of the viewport
+	ray screen_ray(glm::vec2 pixel, glm::vec2 viewport_size, const glm::mat4 &view, const glm::mat4 &proj);
+
+	// loads an OBJ, builds its BVH and casts rays at it on every thread, printing the rays per second
+	void benchmark_bvh(const std::string &filename, size_t ray_count = 4000000);
+}
@@ -0,0 +1,88 @@
+
+// std
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// project
+#include "cgra_cache.hpp"
+
+
+namespace cgra {
+
+	uint64_t hash_file(const std::string &filename) {
+		std::ifstream file(filename, std::ios::binary);
+		if (!file) return 0;
+		uint64_t hash = hash_bytes(nullptr, 0);
+		std::vector<char> buffer(1 << 16);
+		while (file) {
+			file.read(buffer.data(), std::streamsize(buffer.size()));
+			hash = hash_bytes(buffer.data(), size_t(file.gcount()), hash);
+		}
+		return hash;
+	}
+
+
+	namespace {
+		std::string g_cache_directory;
+	}
+
+
+	std::string cache_directory() {
+		if (g_cache_directory.empty()) {
+			const char *env = std::getenv("CGRA_CACHE_DIR");
+			set_cache_directory(env ? env : CGRA_SRCDIR + std::string("/res/cache"));
+		}
+		return g_cache_directory;
+	}
+
+
+	void set_cache_directory(const std::string &dir) {
+		g_cache_directory = dir;
+		std::error_code ec;
+		std::filesystem::create_directories(dir, ec);
+		if (ec) std::cerr << "Warning: Could not create cache directory " << dir << " (" << ec.message() << ")" << std::endl;
+	}
+
+
+	std::string cache_path(const std::string &category, uint64_t key, const std::string &extension) {
+		std::string dir = cache_directory() + "/" + category;
+		std::error_code ec;
+		std::filesystem::create_directories(dir, ec);
+
+		char name[17];
+		std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+		return dir + "/" + name + extension;
+	}
+
+
+	bool read_binary_file(const std::string &filename, std::vector<char> &data) {
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		if (!file) return false;
+		std::streamoff size = file.tellg();
+		if (size < 0) return false;
+		data.resize(size_t(size));
+		file.seekg(0);
+		return bool(file.read(data.data(), size));
+	}
+
+
+	bool write_binary_file(const std::string &filename, const void *data, size_t size) {
+		std::string temp = filename + ".tmp";
+		{
+			std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+			if (!file) return false;
+			file.write(static_cast<const char *>(data), std::streamsize(size));
+			if (!file) return false;
+		}
+		std::error_code ec;
+		std::filesystem::rename(temp, filename, ec);
+		if (ec) {
+			std::filesystem::remove(temp, ec);
+			return false;
+		}
+		return true;
+	}
+}
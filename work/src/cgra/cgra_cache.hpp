@@ -0,0 +1,47 @@
+
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace cgra {
+
+	// 64-bit FNV-1a hash, used to key on-disk caches
+	// chain calls by passing the previous result as the seed
+	inline uint64_t hash_bytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ull) {
+		const unsigned char *p = static_cast<const unsigned char *>(data);
+		uint64_t h = seed;
+		for (size_t i = 0; i < size; i++) {
+			h ^= p[i];
+			h *= 1099511628211ull;
+		}
+		return h;
+	}
+
+	inline uint64_t hash_string(const std::string &s, uint64_t seed = 14695981039346656037ull) {
+		return hash_bytes(s.data(), s.size(), seed);
+	}
+
+	// hashes the contents of a file, returns 0 if it could not be read
+	uint64_t hash_file(const std::string &filename);
+
+	// returns the directory used for on-disk caches, creating it if needed
+	// defaults to res/cache, but can be overridden with the CGRA_CACHE_DIR environment variable
+	std::string cache_directory();
+
+	// overrides the cache directory (before or after it is first used)
+	void set_cache_directory(const std::string &dir);
+
+	// returns the path of a cache file, eg. <cache>/<category>/<16 hex digits of key><extension>
+	std::string cache_path(const std::string &category, uint64_t key, const std::string &extension);
+
+	// reads a whole file into memory, returns false if it could not be read
+	bool read_binary_file(const std::string &filename, std::vector<char> &data);
+
+	// writes a file through a temporary file and a rename, so a crash (or a
+	// concurrent reader) never sees a half written cache entry
+	bool write_binary_file(const std::string &filename, const void *data, size_t size);
+}
@@ -3,16 +3,13 @@
 
 namespace cgra {
 	
-	// creates a mesh for a unit sphere (radius of 1)
-	// immediately draws the sphere mesh, assuming the shader is set up
+	// immediately draws the shared unit sphere (radius of 1, see cgra_primitives.hpp), assuming the shader is set up
 	void drawSphere();
 
-	// creates a mesh for a unit cylinder (radius and hieght of 1) along the z-axis
-	// immediately draws the sphere mesh, assuming the shader is set up
+	// immediately draws the shared unit cylinder (radius and hieght of 1) along the z-axis, assuming the shader is set up
 	void drawCylinder();
 	
-	// creates a mesh for a unit cone (radius and hieght of 1) along the z-axis
-	// immediately draws the sphere mesh, assuming the shader is set up
+	// immediately draws the shared unit cone (radius and hieght of 1) along the z-axis, assuming the shader is set up
 	void drawCone();
 
 	// sets up a shader and draws an axis straight to the current framebuffer
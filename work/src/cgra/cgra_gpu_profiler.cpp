@@ -0,0 +1,224 @@
+
+// std
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+// imgui
+#include <imgui.h>
+
+// project
+#include "cgra_gpu_profiler.hpp"
+
+
+namespace cgra {
+
+	namespace {
+
+		using profiler_clock = std::chrono::steady_clock;
+
+		// number of frames recorded before a frame's queries are read back
+		// (the GPU is usually 1-2 frames behind, so 3 slots avoids stalling)
+		constexpr int frame_latency = 3;
+
+		// number of samples kept per pass for the rolling average and graph
+		constexpr int history_size = 120;
+
+		struct pass_record {
+			const char *name;
+			GLuint query; // zero if this pass was nested and only has CPU timings
+			double cpu_ms;
+		};
+
+		struct frame_slot {
+			std::vector<GLuint> query_pool; // grows as needed, never shrinks
+			size_t queries_used = 0;
+			std::vector<pass_record> passes;
+			double cpu_frame_ms = 0;
+			int frame_id = 0;
+			bool pending = false;
+		};
+
+		struct pass_history {
+			const char *name = nullptr;
+			float gpu_ms[history_size] = {};
+			float cpu_ms[history_size] = {};
+			int offset = 0; // index the next sample is written to
+			int count = 0;
+			int last_frame = -1;
+
+			void push(int frame_id, float gpu, float cpu) {
+				if (frame_id == last_frame) {
+					// pass ran more than once this frame, accumulate
+					int i = (offset + history_size - 1) % history_size;
+					gpu_ms[i] += gpu;
+					cpu_ms[i] += cpu;
+					return;
+				}
+				gpu_ms[offset] = gpu;
+				cpu_ms[offset] = cpu;
+				offset = (offset + 1) % history_size;
+				if (count < history_size) count++;
+				last_frame = frame_id;
+			}
+
+			float average(const float *samples) const {
+				if (count == 0) return 0;
+				float sum = 0;
+				for (int i = 0; i < count; i++) sum += samples[i];
+				return sum / count;
+			}
+		};
+
+		// internal data
+		frame_slot g_frames[frame_latency];
+		std::vector<pass_history> g_passes;
+		pass_history g_frame_total;
+		int g_frame_id = 0;
+		bool g_in_frame = false;
+		profiler_clock::time_point g_frame_start;
+
+		// currently open passes (index into the current frame's records)
+		struct open_pass {
+			size_t record;
+			profiler_clock::time_point start;
+		};
+		std::vector<open_pass> g_open;
+
+
+		double elapsed_ms(profiler_clock::time_point start) {
+			return std::chrono::duration<double, std::milli>(profiler_clock::now() - start).count();
+		}
+
+
+		pass_history & find_history(const char *name) {
+			for (pass_history &h : g_passes) {
+				if (h.name == name || std::strcmp(h.name, name) == 0) return h;
+			}
+			g_passes.emplace_back();
+			g_passes.back().name = name;
+			return g_passes.back();
+		}
+
+
+		// reads back a frame's queries if they are ready, otherwise drops them
+		void collect(frame_slot &slot) {
+			if (!slot.pending) return;
+			slot.pending = false;
+
+			// queries complete in order, so checking the last one is enough
+			if (slot.queries_used > 0) {
+				GLint available = 0;
+				glGetQueryObjectiv(slot.query_pool[slot.queries_used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available) return; // GPU is too far behind, skip rather than stall
+			}
+
+			float gpu_total = 0;
+			for (const pass_record &p : slot.passes) {
+				float gpu_ms = 0;
+				if (p.query) {
+					GLuint64 ns = 0;
+					glGetQueryObjectui64v(p.query, GL_QUERY_RESULT, &ns);
+					gpu_ms = float(ns / 1e6);
+					gpu_total += gpu_ms;
+				}
+				find_history(p.name).push(slot.frame_id, gpu_ms, float(p.cpu_ms));
+			}
+			g_frame_total.push(slot.frame_id, gpu_total, float(slot.cpu_frame_ms));
+		}
+	}
+
+
+	namespace gpu_profiler {
+
+		void begin_frame() {
+			frame_slot &slot = g_frames[g_frame_id % frame_latency];
+			collect(slot);
+
+			slot.passes.clear();
+			slot.queries_used = 0;
+			slot.frame_id = g_frame_id;
+			g_open.clear();
+			g_in_frame = true;
+			g_frame_start = profiler_clock::now();
+		}
+
+
+		void end_frame() {
+			if (!g_in_frame) return;
+			frame_slot &slot = g_frames[g_frame_id % frame_latency];
+			slot.cpu_frame_ms = elapsed_ms(g_frame_start);
+			slot.pending = true;
+			g_in_frame = false;
+			g_frame_id++;
+		}
+
+
+		void begin(const char *name) {
+			if (!g_in_frame) return;
+			frame_slot &slot = g_frames[g_frame_id % frame_latency];
+
+			GLuint query = 0;
+			if (g_open.empty()) {
+				if (slot.queries_used == slot.query_pool.size()) {
+					slot.query_pool.push_back(0);
+					glGenQueries(1, &slot.query_pool.back());
+				}
+				query = slot.query_pool[slot.queries_used++];
+				glBeginQuery(GL_TIME_ELAPSED, query);
+			}
+
+			slot.passes.push_back({ name, query, 0.0 });
+			g_open.push_back({ slot.passes.size() - 1, profiler_clock::now() });
+		}
+
+
+		void end() {
+			if (!g_in_frame || g_open.empty()) return;
+			frame_slot &slot = g_frames[g_frame_id % frame_latency];
+
+			open_pass p = g_open.back();
+			g_open.pop_back();
+			if (slot.passes[p.record].query) glEndQuery(GL_TIME_ELAPSED);
+			slot.passes[p.record].cpu_ms = elapsed_ms(p.start);
+		}
+
+
+		void renderGUI(bool *p_open) {
+			ImGui::SetNextWindowPos(ImVec2(815, 5), ImGuiSetCond_Once);
+			ImGui::SetNextWindowSize(ImVec2(360, 300), ImGuiSetCond_Once);
+			if (!ImGui::Begin("GPU Profiler", p_open)) {
+				ImGui::End();
+				return;
+			}
+
+			ImGui::Text("Averaged over the last %d frames", g_frame_total.count);
+			ImGui::Separator();
+
+			ImGui::Columns(3, "gpu_profiler_passes");
+			ImGui::Text("Pass"); ImGui::NextColumn();
+			ImGui::Text("GPU ms"); ImGui::NextColumn();
+			ImGui::Text("CPU ms"); ImGui::NextColumn();
+			ImGui::Separator();
+			for (const pass_history &h : g_passes) {
+				// hide passes that have not run recently (eg. toggled off in the GUI)
+				if (g_frame_id - h.last_frame > frame_latency + history_size) continue;
+				ImGui::Text("%s", h.name); ImGui::NextColumn();
+				ImGui::Text("%.3f", h.average(h.gpu_ms)); ImGui::NextColumn();
+				ImGui::Text("%.3f", h.average(h.cpu_ms)); ImGui::NextColumn();
+			}
+			ImGui::Separator();
+			ImGui::Text("Frame"); ImGui::NextColumn();
+			ImGui::Text("%.3f", g_frame_total.average(g_frame_total.gpu_ms)); ImGui::NextColumn();
+			ImGui::Text("%.3f", g_frame_total.average(g_frame_total.cpu_ms)); ImGui::NextColumn();
+			ImGui::Columns(1);
+			ImGui::Separator();
+
+			// rolling graph of the summed GPU pass times
+			ImGui::PlotLines("GPU", g_frame_total.gpu_ms, history_size, g_frame_total.offset, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+			ImGui::PlotLines("CPU", g_frame_total.cpu_ms, history_size, g_frame_total.offset, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+
+			ImGui::End();
+		}
+	}
+}
@@ -0,0 +1,33 @@
+
+#pragma once
+
+// project
+#include <opengl.hpp>
+
+
+namespace cgra {
+	namespace gpu_profiler {
+
+		// marks the start and end of a frame. results are read back a few frames
+		// later (the query pools are buffered) so reading them never stalls the GPU
+		void begin_frame();
+		void end_frame();
+
+		// times a single render pass with a GL_TIME_ELAPSED query and a CPU timestamp
+		// GL_TIME_ELAPSED queries cannot nest, so nested passes only get CPU timings
+		// the name must be a string literal (or otherwise outlive the profiler)
+		void begin(const char *name);
+		void end();
+
+		// helper object that times the pass for the lifetime of the scope
+		struct scope {
+			explicit scope(const char *name) { begin(name); }
+			~scope() { end(); }
+			scope(const scope &) = delete;
+			scope & operator=(const scope &) = delete;
+		};
+
+		// draws an ImGui window with the rolling per-pass timings
+		void renderGUI(bool *p_open = nullptr);
+	}
+}
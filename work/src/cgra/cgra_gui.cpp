@@ -4,6 +4,7 @@
 
 // project
 #include "cgra_gui.hpp"
+#include "cgra_shader.hpp"
 
 
 using namespace std;
@@ -19,7 +20,7 @@ namespace cgra {
 		bool         g_mousePressed[3] = { false, false, false };
 		float        g_mouseWheel = 0.0f;
 		GLuint       g_fontTexture = 0;
-		int          g_shaderHandle = 0, g_vertHandle = 0, g_fragHandle = 0;
+		GLuint       g_shaderHandle = 0;
 		int          g_attribLocationTex = 0, g_attribLocationProjMtx = 0;
 		int          g_attribLocationPosition = 0, g_attribLocationUV = 0, g_attribLocationColor = 0;
 		unsigned int g_vboHandle = 0, g_vaoHandle = 0, g_elementsHandle = 0;
@@ -84,16 +85,11 @@ namespace cgra {
 				"   Out_Color = Frag_Color * texture( Texture, Frag_UV.st);\n"
 				"}\n";
 
-			g_shaderHandle = glCreateProgram();
-			g_vertHandle = glCreateShader(GL_VERTEX_SHADER);
-			g_fragHandle = glCreateShader(GL_FRAGMENT_SHADER);
-			glShaderSource(g_vertHandle, 1, &vertex_shader, 0);
-			glShaderSource(g_fragHandle, 1, &fragment_shader, 0);
-			glCompileShader(g_vertHandle);
-			glCompileShader(g_fragHandle);
-			glAttachShader(g_shaderHandle, g_vertHandle);
-			glAttachShader(g_shaderHandle, g_fragHandle);
-			glLinkProgram(g_shaderHandle);
+			// built through shader_builder so it goes through the program binary cache
+			shader_builder sb;
+			sb.set_shader_source(GL_VERTEX_SHADER, vertex_shader);
+			sb.set_shader_source(GL_FRAGMENT_SHADER, fragment_shader);
+			g_shaderHandle = sb.build();
 
 			g_attribLocationTex = glGetUniformLocation(g_shaderHandle, "Texture");
 			g_attribLocationProjMtx = glGetUniformLocation(g_shaderHandle, "uProjectionMatrix");
@@ -134,14 +130,6 @@ namespace cgra {
 			if (g_elementsHandle) glDeleteBuffers(1, &g_elementsHandle);
 			g_vaoHandle = g_vboHandle = g_elementsHandle = 0;
 
-			if (g_shaderHandle && g_vertHandle) glDetachShader(g_shaderHandle, g_vertHandle);
-			if (g_vertHandle) glDeleteShader(g_vertHandle);
-			g_vertHandle = 0;
-
-			if (g_shaderHandle && g_fragHandle) glDetachShader(g_shaderHandle, g_fragHandle);
-			if (g_fragHandle) glDeleteShader(g_fragHandle);
-			g_fragHandle = 0;
-
 			if (g_shaderHandle) glDeleteProgram(g_shaderHandle);
 			g_shaderHandle = 0;
 
@@ -0,0 +1,288 @@
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// sse2 and f16c (the f16c functions are compiled for it separately and only called if the CPU has it)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CGRA_TARGET_F16C
+#else
+#include <cpuid.h>
+#define CGRA_TARGET_F16C __attribute__((target("f16c")))
+#endif
+
+// project
+#include "cgra_cache.hpp"
+#include "cgra_hdr.hpp"
+#include "cgra_trace.hpp"
+
+
+namespace cgra {
+
+	namespace {
+
+		const float g_half_max = 65504.0f;
+
+		bool has_f16c() {
+			static const bool supported = [] {
+				// F16C, plus AVX and OSXSAVE since the instructions are VEX encoded
+				const unsigned int bits = (1u << 29) | (1u << 28) | (1u << 27);
+#if defined(_MSC_VER)
+				int info[4];
+				__cpuid(info, 1);
+				if ((unsigned(info[2]) & bits) != bits) return false;
+				unsigned long long xcr0 = _xgetbv(0);
+#else
+				unsigned int eax, ebx, ecx, edx;
+				if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || (ecx & bits) != bits) return false;
+				unsigned int xcr0_lo, xcr0_hi;
+				__asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+				unsigned long long xcr0 = (unsigned long long)(xcr0_hi) << 32 | xcr0_lo;
+#endif
+				// and the OS has to save the XMM and YMM registers, or VEX instructions fault
+				return (xcr0 & 0x6) == 0x6;
+			}();
+			return supported;
+		}
+
+
+		// round to nearest even, for values already clamped to the half range
+		uint16_t to_half(float f) {
+			uint32_t x;
+			std::memcpy(&x, &f, sizeof(x));
+			uint16_t sign = uint16_t((x >> 16) & 0x8000);
+			x &= 0x7fffffff;
+			if (x < 0x38800000) {
+				// subnormal (or zero), in units of 2^-24
+				float a;
+				std::memcpy(&a, &x, sizeof(a));
+				return uint16_t(sign | uint16_t(std::nearbyint(a * 16777216.0f)));
+			}
+			// rebias the exponent (127 -> 15) and round the mantissa
+			x += 0xc8000fff + ((x >> 13) & 1);
+			return uint16_t(sign | (x >> 13));
+		}
+
+		float from_half(uint16_t h) {
+			uint32_t sign = uint32_t(h & 0x8000) << 16;
+			uint32_t exponent = (h >> 10) & 0x1f;
+			uint32_t mantissa = h & 0x3ff;
+			uint32_t x;
+			if (exponent == 0) {
+				float f = float(mantissa) / 16777216.0f;
+				std::memcpy(&x, &f, sizeof(x));
+				x |= sign;
+			} else if (exponent == 31) {
+				x = sign | 0x7f800000 | (mantissa << 13);
+			} else {
+				x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+			}
+			float f;
+			std::memcpy(&f, &x, sizeof(f));
+			return f;
+		}
+
+
+		// four RGBE pixels to twelve RGB floats, m * 2^(e - 136) like stb (exponents too small for a float are black)
+		inline void rgbe4_to_rgb(const unsigned char *rgbe, __m128 rgb[3]) {
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i bias = _mm_set1_epi32(9); // 136 - 127
+			const __m128 half_max = _mm_set1_ps(g_half_max);
+
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgbe));
+			__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+			__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+			__m128i pixels[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero), _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+
+			__m128 p[4];
+			for (int i = 0; i < 4; i++) {
+				__m128i e = _mm_shuffle_epi32(pixels[i], _MM_SHUFFLE(3, 3, 3, 3));
+				__m128i valid = _mm_cmpgt_epi32(e, bias);
+				__m128 scale = _mm_castsi128_ps(_mm_and_si128(valid, _mm_slli_epi32(_mm_sub_epi32(e, bias), 23)));
+				p[i] = _mm_min_ps(_mm_mul_ps(_mm_cvtepi32_ps(pixels[i]), scale), half_max);
+			}
+
+			// r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+			__m128 b0r1 = _mm_shuffle_ps(p[0], p[1], _MM_SHUFFLE(0, 0, 2, 2));
+			__m128 b2r3 = _mm_shuffle_ps(p[2], p[3], _MM_SHUFFLE(0, 0, 2, 2));
+			rgb[0] = _mm_shuffle_ps(p[0], b0r1, _MM_SHUFFLE(2, 0, 1, 0));
+			rgb[1] = _mm_shuffle_ps(p[1], p[2], _MM_SHUFFLE(1, 0, 2, 1));
+			rgb[2] = _mm_shuffle_ps(b2r3, p[3], _MM_SHUFFLE(2, 1, 2, 0));
+		}
+
+		CGRA_TARGET_F16C void rgbe4_to_half_f16c(const unsigned char *rgbe, uint16_t *rgb) {
+			__m128 v[3];
+			rgbe4_to_rgb(rgbe, v);
+			for (int k = 0; k < 3; k++) {
+				_mm_storel_epi64(reinterpret_cast<__m128i *>(rgb + k * 4), _mm_cvtps_ph(v[k], _MM_FROUND_TO_NEAREST_INT));
+			}
+		}
+
+		void rgbe4_to_half_sse2(const unsigned char *rgbe, uint16_t *rgb) {
+			__m128 v[3];
+			rgbe4_to_rgb(rgbe, v);
+			alignas(16) float f[12];
+			for (int k = 0; k < 3; k++) _mm_store_ps(f + k * 4, v[k]);
+			for (int i = 0; i < 12; i++) rgb[i] = to_half(f[i]);
+		}
+
+		CGRA_TARGET_F16C void half_to_float_f16c(const uint16_t *half, float *out, size_t count) {
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				_mm_storeu_ps(out + i, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(half + i))));
+			}
+			for (; i < count; i++) out[i] = from_half(half[i]);
+		}
+
+
+		// decodes one new-style RLE scanline (each channel run length encoded separately) to RGBE
+		void decode_rle_scanline(const unsigned char *p, int width, unsigned char *rgbe) {
+			p += 4;
+			for (int c = 0; c < 4; c++) {
+				for (int x = 0; x < width;) {
+					int n = *p++;
+					if (n > 128) {
+						n -= 128;
+						unsigned char v = *p++;
+						for (int k = 0; k < n; k++) rgbe[(x + k) * 4 + c] = v;
+					} else {
+						for (int k = 0; k < n; k++) rgbe[(x + k) * 4 + c] = *p++;
+					}
+					x += n;
+				}
+			}
+		}
+
+		// whether the scanline at p starts with an RLE header. only asked of the first scanline, which decides
+		// for the whole file (as Radiance and stb_image do), since flat pixels can start with the same bytes
+		bool is_rle_scanline(const unsigned char *p, size_t available, int width) {
+			return width >= 8 && width < 32768 && available >= 4 && p[0] == 2 && p[1] == 2 && !(p[2] & 0x80);
+		}
+
+		// the length in bytes of the scanline starting at p, 0 if it is malformed or truncated
+		size_t scanline_size(const unsigned char *p, size_t available, int width, bool rle) {
+			if (!rle) {
+				return available >= size_t(width) * 4 ? size_t(width) * 4 : 0;
+			}
+			if (available < 4 || p[0] != 2 || p[1] != 2 || ((p[2] << 8) | p[3]) != width) return 0;
+			size_t pos = 4;
+			for (int c = 0; c < 4; c++) {
+				for (int x = 0; x < width;) {
+					if (pos >= available) return 0;
+					int n = p[pos++];
+					if (n > 128) {
+						n -= 128;
+						pos += 1;
+					} else {
+						if (n == 0) return 0;
+						pos += n;
+					}
+					x += n;
+					if (x > width) return 0;
+				}
+			}
+			return pos <= available ? pos : 0;
+		}
+	}
+
+
+	void rgbe_to_half(const unsigned char *rgbe, uint16_t *rgb, size_t count) {
+		void (*convert4)(const unsigned char *, uint16_t *) = has_f16c() ? rgbe4_to_half_f16c : rgbe4_to_half_sse2;
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) convert4(rgbe + i * 4, rgb + i * 3);
+
+		// the last few pixels go through a padded copy, so nothing is read or written past the ends
+		if (i < count) {
+			unsigned char in[16] = {};
+			uint16_t out[12];
+			std::memcpy(in, rgbe + i * 4, (count - i) * 4);
+			convert4(in, out);
+			std::memcpy(rgb + i * 3, out, (count - i) * 3 * sizeof(uint16_t));
+		}
+	}
+
+
+	void half_to_float(const uint16_t *half, float *out, size_t count) {
+		if (has_f16c()) {
+			half_to_float_f16c(half, out, count);
+		} else {
+			for (size_t i = 0; i < count; i++) out[i] = from_half(half[i]);
+		}
+	}
+
+
+	bool load_hdr(const std::string &filename, hdr_image &image, bool flip) {
+		CGRA_TRACE_ZONE("load_hdr");
+
+		std::vector<char> file;
+		if (!read_binary_file(filename, file)) {
+			std::cerr << "Error: Could not open " << filename << std::endl;
+			return false;
+		}
+		const unsigned char *data = reinterpret_cast<const unsigned char *>(file.data());
+		const size_t size = file.size();
+		size_t pos = 0;
+
+		auto fail = [&](const char *reason) {
+			std::cerr << "Error: " << reason << " in " << filename << std::endl;
+			return false;
+		};
+		auto read_line = [&](std::string &line) {
+			line.clear();
+			while (pos < size && data[pos] != '\n') line += char(data[pos++]);
+			if (pos >= size) return false;
+			pos++;
+			return true;
+		};
+
+		// header lines until a blank one, then the resolution
+		std::string line;
+		if (!read_line(line) || (line.compare(0, 10, "#?RADIANCE") != 0 && line.compare(0, 6, "#?RGBE") != 0)) return fail("Not a Radiance file");
+		bool rgbe = false;
+		while (read_line(line) && !line.empty()) {
+			if (line == "FORMAT=32-bit_rle_rgbe") rgbe = true;
+		}
+		if (!rgbe) return fail("Unsupported format (only 32-bit_rle_rgbe)");
+
+		int width, height;
+		if (!read_line(line) || std::sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2) return fail("Unsupported orientation (only -Y +X)");
+		if (width <= 0 || height <= 0 || width > (1 << 16) || height > (1 << 16)) return fail("Bad resolution");
+
+		// RLE scanlines have no fixed size, so find where each starts before decoding them in parallel
+		const bool rle = is_rle_scanline(data + pos, size - pos, width);
+		std::vector<size_t> starts(size_t(height) + 1);
+		for (int y = 0; y < height; y++) {
+			starts[y] = pos;
+			size_t n = scanline_size(data + pos, size - pos, width, rle);
+			if (!n) return fail("Malformed or truncated scanline");
+			pos += n;
+		}
+
+		image.width = width;
+		image.height = height;
+		image.pixels.resize(size_t(width) * height * 3);
+
+		const int block = 32;
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int first = 0; first < height; first += block) {
+			std::vector<unsigned char> row(size_t(width) * 4);
+			for (int y = first; y < std::min(first + block, height); y++) {
+				const unsigned char *src = data + starts[y];
+				if (rle) {
+					decode_rle_scanline(src, width, row.data());
+					src = row.data();
+				}
+				int dst = flip ? height - 1 - y : y;
+				rgbe_to_half(src, &image.pixels[size_t(dst) * width * 3], size_t(width));
+			}
+		}
+		return true;
+	}
+}
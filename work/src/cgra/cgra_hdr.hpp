@@ -0,0 +1,30 @@
+
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace cgra {
+
+	// a Radiance image as RGB half floats, ready to upload as GL_RGB16F from GL_HALF_FLOAT
+	struct hdr_image {
+		int width = 0;
+		int height = 0;
+		std::vector<uint16_t> pixels;
+	};
+
+	// decodes a Radiance .hdr (32-bit_rle_rgbe, flat or new-style RLE scanlines) straight to
+	// half floats, with the scanlines decoded in parallel. rows are bottom to top (what GL
+	// expects, same as stb with the flip flag set) unless flip is false. values above the
+	// half float range are clamped. returns false if the file can't be read or isn't supported
+	bool load_hdr(const std::string &filename, hdr_image &image, bool flip = true);
+
+	// converts count RGBE pixels to RGB half floats, using F16C when the CPU has it
+	void rgbe_to_half(const unsigned char *rgbe, uint16_t *rgb, size_t count);
+
+	// converts count half floats to floats, using F16C when the CPU has it
+	void half_to_float(const uint16_t *half, float *out, size_t count);
+}
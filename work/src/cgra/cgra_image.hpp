@@ -16,6 +16,7 @@
 
 // project
 #include <opengl.hpp>
+#include "cgra_mipmap.hpp"
 
 
 namespace cgra {
@@ -25,6 +26,7 @@ namespace cgra {
 		glm::ivec2 size;
 		std::vector<unsigned char> data;
 		glm::vec<2, GLenum> wrap{GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE};
+		std::string source; // the file this was loaded from, empty for images made at runtime
 
 		rgba_image() : size(0, 0) { }
 
@@ -32,7 +34,7 @@ namespace cgra {
 
 		explicit rgba_image(glm::ivec2 size_) : size(size_), data(size.x * size.y * 4, 0) { }
 
-		explicit rgba_image(const std::string &filename) {
+		explicit rgba_image(const std::string &filename) : source(filename) {
 			stbi_set_flip_vertically_on_load(true); // gl expects image origin at lower left
 			unsigned char *raw_stb_data = stbi_load(filename.c_str(), &size.x, &size.y, nullptr, 4);
 			if (!raw_stb_data) {
@@ -54,11 +56,18 @@ namespace cgra {
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap.x);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap.y);
-			glTexImage2D(
-				GL_TEXTURE_2D, 0, format, size.x, size.y, 0,
-				GL_RGBA, GL_UNSIGNED_BYTE, data.data()
-			);
-			glGenerateMipmap(GL_TEXTURE_2D);
+
+			// mips are filtered on the CPU (in linear space for sRGB formats). only images loaded from a
+			// file are cached, so generated and transient images don't fill res/cache with one-off chains
+			mip_options options;
+			options.srgb = format == GL_SRGB8_ALPHA8 || format == GL_SRGB8;
+			options.wrap = wrap.x == GL_REPEAT;
+			if (source.empty()) {
+				upload_mipmaps(GL_TEXTURE_2D, format, GL_RGBA, build_mipmaps(data.data(), size.x, size.y, 4, options));
+			}
+			else {
+				upload_mipmaps(GL_TEXTURE_2D, format, GL_RGBA, cached_mipmaps(data.data(), size.x, size.y, 4, options));
+			}
 			return tex;
 		}
 
@@ -0,0 +1,170 @@
+
+// std
+#include <algorithm>
+#include <cmath>
+
+// glm
+#include <glm/gtc/constants.hpp>
+
+// project
+#include "cgra_lathe.hpp"
+#include "cgra_trace.hpp"
+
+
+using namespace glm;
+
+namespace cgra {
+
+	namespace {
+
+		// spans are split at most this many times while following a spline
+		const int g_max_depth = 10;
+
+		vec2 catmull_rom(vec2 p0, vec2 p1, vec2 p2, vec2 p3, float t) {
+			return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t * t + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t * t * t);
+		}
+
+		// distance from p to the segment ab
+		float segment_distance(vec2 p, vec2 a, vec2 b) {
+			vec2 ab = b - a;
+			float l = dot(ab, ab);
+			float t = l > 0 ? clamp(dot(p - a, ab) / l, 0.0f, 1.0f) : 0.0f;
+			return length(p - (a + t * ab));
+		}
+
+		// appends the points after t0 up to t1 of one span, split until each chord is within tolerance of the curve
+		void subdivide(vec2 p0, vec2 p1, vec2 p2, vec2 p3, float t0, float t1, vec2 a, vec2 b, float tolerance, int depth, std::vector<vec2> &out) {
+			float tm = (t0 + t1) * 0.5f;
+			vec2 m = catmull_rom(p0, p1, p2, p3, tm);
+
+			// the quarter points catch S bends where the midpoint happens to be on the chord
+			bool split = depth < g_max_depth && (segment_distance(m, a, b) > tolerance
+				|| segment_distance(catmull_rom(p0, p1, p2, p3, (t0 + tm) * 0.5f), a, b) > tolerance
+				|| segment_distance(catmull_rom(p0, p1, p2, p3, (tm + t1) * 0.5f), a, b) > tolerance);
+			if (split) {
+				subdivide(p0, p1, p2, p3, t0, tm, a, m, tolerance, depth + 1, out);
+				subdivide(p0, p1, p2, p3, tm, t1, m, b, tolerance, depth + 1, out);
+			} else {
+				out.push_back(b);
+			}
+		}
+
+		// the profile as a polyline within tolerance of the curve, as (radius, height)
+		std::vector<vec2> sample_profile(const std::vector<lathe_point> &points, lathe_curve curve, float tolerance) {
+			std::vector<vec2> p;
+			for (const lathe_point &lp : points) p.emplace_back(max(lp.radius, 0.0f), lp.height);
+			if (curve == lathe_curve::polyline || p.size() < 3) return p;
+
+			// the ends are extended in a straight line so the spline passes through every point
+			std::vector<vec2> out = { p[0] };
+			for (size_t i = 0; i + 1 < p.size(); i++) {
+				vec2 p0 = i > 0 ? p[i - 1] : 2.0f * p[0] - p[1];
+				vec2 p3 = i + 2 < p.size() ? p[i + 2] : 2.0f * p[i + 1] - p[i];
+				subdivide(p0, p[i], p[i + 1], p3, 0, 1, p[i], p[i + 1], tolerance, 0, out);
+			}
+			return out;
+		}
+
+		// the chord of a circle of radius r split into n segments is at most r (1 - cos(pi / n)) from the circle
+		int angular_segments(float radius, float tolerance) {
+			if (radius <= tolerance) return 3;
+			int n = int(std::ceil(pi<float>() / std::acos(1.0f - tolerance / radius)));
+			return clamp(n, 3, 1024);
+		}
+
+		void build_profile(const std::vector<vec2> &samples, float crease_angle, float tolerance, mesh_builder &mb) {
+			if (samples.size() < 2) return;
+
+			// outward normal (in the profile plane) and length of each segment
+			const size_t segment_count = samples.size() - 1;
+			std::vector<vec2> normals(segment_count);
+			std::vector<float> lengths(segment_count);
+			float total_length = 0;
+			float max_radius = 0;
+			for (size_t s = 0; s < segment_count; s++) {
+				vec2 d = samples[s + 1] - samples[s];
+				lengths[s] = length(d);
+				normals[s] = lengths[s] > 0 ? vec2(d.y, -d.x) / lengths[s] : vec2(1, 0);
+				total_length += lengths[s];
+			}
+			for (vec2 p : samples) max_radius = max(max_radius, p.x);
+			const int n = angular_segments(max_radius, tolerance);
+
+			// one ring of vertices per sample, or two at a crease so each side keeps its own normal
+			std::vector<GLuint> ring_below(samples.size()), ring_above(samples.size());
+			auto push_ring = [&](vec2 p, vec2 normal, float v) {
+				GLuint first = GLuint(mb.vertices.size());
+				for (int i = 0; i <= n; i++) {
+					// the last vertex is at exactly the same place as the first, so the seam can be welded
+					float angle = 2.0f * pi<float>() * (i % n) / n;
+					float c = std::cos(angle), s = std::sin(angle);
+					mesh_vertex vertex;
+					vertex.pos = vec3(p.x * c, p.y, p.x * s);
+					vertex.norm = normalize(vec3(normal.x * c, normal.y, normal.x * s));
+					vertex.uv = vec2(float(i) / n, v);
+					mb.push_vertex(vertex);
+				}
+				return first;
+			};
+
+			const float crease_cos = std::cos(crease_angle);
+			float arc = 0;
+			for (size_t k = 0; k < samples.size(); k++) {
+				float v = total_length > 0 ? arc / total_length : 0;
+				if (k == 0) {
+					ring_above[k] = push_ring(samples[k], normals[0], v);
+				} else if (k == samples.size() - 1) {
+					ring_below[k] = push_ring(samples[k], normals[k - 1], v);
+				} else if (dot(normals[k - 1], normals[k]) < crease_cos) {
+					ring_below[k] = push_ring(samples[k], normals[k - 1], v);
+					ring_above[k] = push_ring(samples[k], normals[k], v);
+				} else {
+					ring_below[k] = ring_above[k] = push_ring(samples[k], normalize(normals[k - 1] + normals[k]), v);
+				}
+				if (k < segment_count) arc += lengths[k];
+			}
+
+			// quads between consecutive rings, without the degenerate triangles of rings on the axis
+			for (size_t s = 0; s < segment_count; s++) {
+				GLuint a = ring_above[s], b = ring_below[s + 1];
+				for (int i = 0; i < n; i++) {
+					if (samples[s].x > 0) mb.push_indices({ a + i, b + i, a + i + 1 });
+					if (samples[s + 1].x > 0) mb.push_indices({ a + i + 1, b + i, b + i + 1 });
+				}
+			}
+		}
+	}
+
+
+	void lathe_builder::add_profile(const std::vector<lathe_point> &points, lathe_curve curve) {
+		m_profiles.push_back({ points, curve });
+	}
+
+
+	std::vector<mesh_builder> lathe_builder::build(const std::vector<float> &tolerances) const {
+		CGRA_TRACE_ZONE("lathe_builder::build");
+		std::vector<mesh_builder> lods(tolerances.size());
+		for (size_t l = 0; l < tolerances.size(); l++) {
+			float tolerance = max(tolerances[l], 1e-6f);
+			for (const profile &p : m_profiles) {
+				build_profile(sample_profile(p.points, p.curve, tolerance), crease_angle, tolerance, lods[l]);
+			}
+		}
+		return lods;
+	}
+
+
+	float screen_space_tolerance(float pixels, float distance, const mat4 &proj, float viewport_height) {
+		// proj[1][1] is 1 / tan(fovy / 2), so a pixel covers 2 distance / (proj[1][1] height) at that distance
+		return pixels * 2.0f * max(distance, 0.0f) / (proj[1][1] * max(viewport_height, 1.0f));
+	}
+
+
+	size_t select_lod(const std::vector<float> &tolerances, float allowed) {
+		size_t lod = 0;
+		for (size_t l = 0; l < tolerances.size(); l++) {
+			if (tolerances[l] <= allowed) lod = l;
+		}
+		return lod;
+	}
+}
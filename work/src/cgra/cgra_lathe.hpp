@@ -0,0 +1,56 @@
+
+#pragma once
+
+// std
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "cgra_mesh.hpp"
+
+
+namespace cgra {
+
+	// a point on a lathe profile, in the plane through the y axis
+	struct lathe_point {
+		float radius = 0; // distance from the y axis
+		float height = 0;
+	};
+
+	enum class lathe_curve {
+		polyline, // straight segments between the points
+		spline    // a Catmull-Rom spline through the points
+	};
+
+
+	// Builds surfaces of revolution about the y axis from profile curves.
+	// A profile runs from the bottom of its surface to the top, and the surface faces to the right of the
+	// direction of travel (outwards for a profile going up the outside). Points on the axis close it with a cap.
+	// Each level of detail is tessellated from a tolerance, the largest distance allowed between the triangles
+	// and the true surface: around the axis from the widest radius, along splines from their curvature.
+	class lathe_builder {
+	private:
+		struct profile {
+			std::vector<lathe_point> points;
+			lathe_curve curve;
+		};
+		std::vector<profile> m_profiles;
+
+	public:
+		// profile points that turn by more than this (in radians) get a hard edge instead of a smoothed normal
+		float crease_angle = glm::radians(30.0f);
+
+		void add_profile(const std::vector<lathe_point> &points, lathe_curve curve = lathe_curve::polyline);
+
+		// builds one mesh per tolerance, in the same order, each with every profile
+		std::vector<mesh_builder> build(const std::vector<float> &tolerances) const;
+	};
+
+	// the tolerance in model units that projects to a number of pixels at a distance from the camera
+	float screen_space_tolerance(float pixels, float distance, const glm::mat4 &proj, float viewport_height);
+
+	// the coarsest level of detail (with tolerances from finest to coarsest) within the allowed tolerance, 0 if none are
+	size_t select_lod(const std::vector<float> &tolerances, float allowed);
+}
@@ -0,0 +1,104 @@
+
+// std
+#include <utility>
+
+// platform
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// project
+#include "cgra_mapped_file.hpp"
+
+
+namespace cgra {
+
+#ifdef _WIN32
+
+	mapped_file::mapped_file(const std::string &filename) {
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+		m_file = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size)) { close(); return; }
+		m_size = size_t(size.QuadPart);
+		m_open = true;
+		if (m_size == 0) return; // empty files can't be mapped
+
+		m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping) m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!m_data) close();
+	}
+
+	void mapped_file::close() {
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		if (m_file) CloseHandle(m_file);
+		m_data = nullptr;
+		m_mapping = nullptr;
+		m_file = nullptr;
+		m_size = 0;
+		m_open = false;
+	}
+
+#else
+
+	mapped_file::mapped_file(const std::string &filename) {
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0) return;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0) {
+			m_size = size_t(st.st_size);
+			m_open = true;
+			if (m_size > 0) {
+				void *p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (p == MAP_FAILED) {
+					m_size = 0;
+					m_open = false;
+				} else {
+					m_data = static_cast<const char *>(p);
+					// the whole file is usually about to be read
+					madvise(p, m_size, MADV_WILLNEED);
+				}
+			}
+		}
+		// the mapping stays valid after the descriptor is closed
+		::close(fd);
+	}
+
+	void mapped_file::close() {
+		if (m_data) munmap(const_cast<char *>(m_data), m_size);
+		m_data = nullptr;
+		m_size = 0;
+		m_open = false;
+	}
+
+#endif
+
+	mapped_file::mapped_file(mapped_file &&other) noexcept {
+		*this = std::move(other);
+	}
+
+	mapped_file & mapped_file::operator=(mapped_file &&other) noexcept {
+		if (this != &other) {
+			close();
+			std::swap(m_data, other.m_data);
+			std::swap(m_size, other.m_size);
+			std::swap(m_open, other.m_open);
+#ifdef _WIN32
+			std::swap(m_file, other.m_file);
+			std::swap(m_mapping, other.m_mapping);
+#endif
+		}
+		return *this;
+	}
+}
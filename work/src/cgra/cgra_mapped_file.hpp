@@ -0,0 +1,40 @@
+
+#pragma once
+
+// std
+#include <cstddef>
+#include <string>
+
+
+namespace cgra {
+
+	// a read-only memory mapping of a whole file, unmapped when destroyed
+	// pages are only read from disk as they are touched, so large files open instantly
+	class mapped_file {
+	private:
+		const char *m_data = nullptr;
+		size_t m_size = 0;
+		bool m_open = false;
+#ifdef _WIN32
+		void *m_file = nullptr;
+		void *m_mapping = nullptr;
+#endif
+
+		void close();
+
+	public:
+		mapped_file() { }
+		explicit mapped_file(const std::string &filename);
+		~mapped_file() { close(); }
+
+		mapped_file(const mapped_file &) = delete;
+		mapped_file & operator=(const mapped_file &) = delete;
+		mapped_file(mapped_file &&other) noexcept;
+		mapped_file & operator=(mapped_file &&other) noexcept;
+
+		// false if the file could not be opened or mapped (an empty file is open, with no data)
+		bool is_open() const { return m_open; }
+		const char * data() const { return m_data; }
+		size_t size() const { return m_size; }
+	};
+}
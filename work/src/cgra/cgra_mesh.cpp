@@ -1,9 +1,18 @@
 
 // std
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
 
+// glm
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
 // project
 #include "cgra_mesh.hpp"
+#include "cgra_mesh_optimise.hpp"
+#include "cgra_trace.hpp"
 
 
 
@@ -11,12 +20,36 @@ using namespace glm;
 
 namespace cgra {
 
-	void gl_mesh::draw() {
+	namespace {
+
+		struct packed_vertex {
+			int16_t pos[4]; // w is padding
+			uint32_t norm;
+			uint32_t uv;
+		};
+		static_assert(sizeof(packed_vertex) == 16, "packed vertices should be 16 bytes");
+
+		// the angle between the edges from a to b and a to c, 0 if either has no length
+		float corner_angle(vec3 a, vec3 b, vec3 c) {
+			vec3 e1 = b - a, e2 = c - a;
+			float l = length(e1) * length(e2);
+			return l > 0 ? std::acos(clamp(dot(e1, e2) / l, -1.0f, 1.0f)) : 0.0f;
+		}
+	}
+
+
+	void gl_mesh::draw() const {
 		if (vao == 0) return;
 		// bind our VAO which sets up all our buffers and data for us
 		glBindVertexArray(vao);
 		// tell opengl to draw our VAO using the draw mode and how many verticies to render
-		glDrawElements(mode, index_count, GL_UNSIGNED_INT, 0);
+		glDrawElements(mode, index_count, index_type, 0);
+	}
+
+	void gl_mesh::draw_instanced(int instance_count) const {
+		if (vao == 0 || instance_count <= 0) return;
+		glBindVertexArray(vao);
+		glDrawElementsInstanced(mode, index_count, index_type, 0, instance_count);
 	}
 
 	void gl_mesh::destroy() {
@@ -27,6 +60,84 @@ namespace cgra {
 	}
 
 
+	void mesh_builder::generate_tangents() {
+		CGRA_TRACE_ZONE("mesh_builder::generate_tangents");
+		if (mode != GL_TRIANGLES) return;
+
+		// the directions of +u and +v on each triangle, and whether its uvs are mirrored
+		const size_t triangle_count = indices.size() / 3;
+		std::vector<vec3> face_tangents(triangle_count), face_bitangents(triangle_count);
+		std::vector<bool> mirrored(triangle_count);
+		for (size_t t = 0; t < triangle_count; t++) {
+			const mesh_vertex &v0 = vertices[indices[t * 3]], &v1 = vertices[indices[t * 3 + 1]], &v2 = vertices[indices[t * 3 + 2]];
+			vec3 e1 = v1.pos - v0.pos, e2 = v2.pos - v0.pos;
+			vec2 d1 = v1.uv - v0.uv, d2 = v2.uv - v0.uv;
+			float det = d1.x * d2.y - d2.x * d1.y;
+			float sign = det < 0 ? -1.0f : 1.0f;
+			face_tangents[t] = sign * (e1 * d2.y - e2 * d1.y);
+			face_bitangents[t] = sign * (e2 * d1.x - e1 * d2.x);
+			mirrored[t] = det < 0;
+		}
+
+		// a vertex used by both mirrored and unmirrored triangles is split, the mirrored ones get a copy
+		const GLuint none = ~GLuint(0);
+		std::vector<GLuint> mirrored_copy(vertices.size(), none);
+		std::vector<bool> used_unmirrored(vertices.size(), false);
+		for (size_t i = 0; i < triangle_count * 3; i++) {
+			if (!mirrored[i / 3]) used_unmirrored[indices[i]] = true;
+		}
+		for (size_t i = 0; i < triangle_count * 3; i++) {
+			GLuint v = indices[i];
+			if (!mirrored[i / 3] || !used_unmirrored[v]) continue;
+			if (mirrored_copy[v] == none) mirrored_copy[v] = push_vertex(vertices[v]);
+			indices[i] = mirrored_copy[v];
+		}
+
+		// sum the triangle frames around each vertex, in the plane of its normal
+		std::vector<vec3> tangent_sums(vertices.size(), vec3(0)), bitangent_sums(vertices.size(), vec3(0));
+		for (size_t t = 0; t < triangle_count; t++) {
+			for (int k = 0; k < 3; k++) {
+				GLuint v = indices[t * 3 + k];
+				vec3 n = vertices[v].norm;
+				float angle = corner_angle(vertices[v].pos, vertices[indices[t * 3 + (k + 1) % 3]].pos, vertices[indices[t * 3 + (k + 2) % 3]].pos);
+				vec3 ft = face_tangents[t] - n * dot(n, face_tangents[t]);
+				vec3 fb = face_bitangents[t] - n * dot(n, face_bitangents[t]);
+				if (dot(ft, ft) > 0) tangent_sums[v] += angle * normalize(ft);
+				if (dot(fb, fb) > 0) bitangent_sums[v] += angle * normalize(fb);
+			}
+		}
+
+		tangents.assign(vertices.size(), vec4(0));
+		for (size_t v = 0; v < vertices.size(); v++) {
+			vec3 n = vertices[v].norm;
+			vec3 t = tangent_sums[v];
+
+			// with no usable uvs any direction in the tangent plane will do
+			if (dot(t, t) == 0) t = cross(n, std::abs(n.x) < 0.9f ? vec3(1, 0, 0) : vec3(0, 1, 0));
+			if (dot(t, t) == 0) t = vec3(1, 0, 0);
+			t = normalize(t);
+			float w = dot(cross(n, t), bitangent_sums[v]) < 0 ? -1.0f : 1.0f;
+			tangents[v] = vec4(t, w);
+		}
+		has_tangents = true;
+	}
+
+
+	void mesh_builder::optimise(const std::string &name) {
+		CGRA_TRACE_ZONE("mesh_builder::optimise");
+		if (mode != GL_TRIANGLES || indices.size() < 3) return;
+
+		float before = mesh_acmr(indices, vertices.size());
+		std::vector<size_t> clusters = optimise_vertex_cache(indices, vertices.size());
+		optimise_overdraw(indices, vertices, clusters);
+		optimise_vertex_fetch(vertices, indices, has_tangents ? &tangents : nullptr);
+		float after = mesh_acmr(indices, vertices.size());
+
+		std::cout << "Optimised " << name << ": " << indices.size() / 3 << " triangles, " << clusters.size()
+			<< " clusters, ACMR " << before << " -> " << after << std::endl;
+	}
+
+
 	gl_mesh mesh_builder::build() const {
 
 		gl_mesh m;
@@ -43,37 +154,108 @@ namespace cgra {
 		// VBO (single buffer, interleaved)
 		//
 		glBindBuffer(GL_ARRAY_BUFFER, m.vbo);
-		// upload ALL the vertex data in one buffer
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(mesh_vertex), &vertices[0], GL_STATIC_DRAW);
 
-		// this buffer will use location=0 when we use our VAO
-		glEnableVertexAttribArray(0);
-		// tell opengl how to treat data in location=0 - the data is treated in lots of 3 (3 floats = vec3)
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void *)(offsetof(mesh_vertex, pos)));
+		// bounds, with the sphere around the centre of the box (not the smallest sphere, but close for most meshes)
+		vec3 lo(0), hi(0);
+		if (!vertices.empty()) lo = hi = vertices[0].pos;
+		for (const mesh_vertex &v : vertices) {
+			lo = min(lo, v.pos);
+			hi = max(hi, v.pos);
+		}
+		m.bounds_min = lo;
+		m.bounds_max = hi;
+		m.sphere_centre = (lo + hi) * 0.5f;
+		for (const mesh_vertex &v : vertices) m.sphere_radius = max(m.sphere_radius, distance(v.pos, m.sphere_centre));
+
+		if (format == vertex_format::packed) {
+			// positions are stored relative to the centre of the bounds, scaled to fit in [-1, 1]
+			vec3 centre = m.sphere_centre;
+			vec3 extent = max((hi - lo) * 0.5f, vec3(1e-20f));
+			m.position_transform = translate(mat4(1), centre) * scale(mat4(1), extent);
+
+			// tangents, when there are any, follow each packed vertex (the sign fits in the 2 bit w)
+			const size_t stride = sizeof(packed_vertex) + (has_tangents ? sizeof(uint32_t) : 0);
+			std::vector<char> packed(vertices.size() * stride);
+			for (size_t i = 0; i < vertices.size(); i++) {
+				packed_vertex pv = {};
+				vec3 p = clamp((vertices[i].pos - centre) / extent, vec3(-1), vec3(1));
+				for (int k = 0; k < 3; k++) pv.pos[k] = int16_t(std::round(p[k] * 32767.0f));
+				pv.norm = packSnorm3x10_1x2(vec4(vertices[i].norm, 0));
+				pv.uv = packHalf2x16(vertices[i].uv);
+				std::memcpy(packed.data() + i * stride, &pv, sizeof(pv));
+				if (has_tangents) {
+					uint32_t tangent = packSnorm3x10_1x2(tangents[i]);
+					std::memcpy(packed.data() + i * stride + sizeof(pv), &tangent, sizeof(tangent));
+				}
+			}
+			glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);
+
+			// the shaders still see vec3 positions and normals and vec2 uvs, the attribute formats decode them
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, GLsizei(stride), (void *)(offsetof(packed_vertex, pos)));
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, GLsizei(stride), (void *)(offsetof(packed_vertex, norm)));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, GLsizei(stride), (void *)(offsetof(packed_vertex, uv)));
+			if (has_tangents) {
+				glEnableVertexAttribArray(3);
+				glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, GLsizei(stride), (void *)(sizeof(packed_vertex)));
+			}
+		} else {
+			// upload ALL the vertex data in one buffer, interleaving the tangents only if they were generated
+			GLsizei stride = sizeof(mesh_vertex);
+			if (has_tangents) {
+				std::vector<mesh_vertex_tangent> interleaved(vertices.size());
+				for (size_t i = 0; i < vertices.size(); i++) interleaved[i] = { vertices[i], tangents[i] };
+				stride = sizeof(mesh_vertex_tangent);
+				glBufferData(GL_ARRAY_BUFFER, interleaved.size() * stride, interleaved.data(), GL_STATIC_DRAW);
+			} else {
+				glBufferData(GL_ARRAY_BUFFER, vertices.size() * stride, vertices.data(), GL_STATIC_DRAW);
+			}
+
+			// this buffer will use location=0 when we use our VAO
+			glEnableVertexAttribArray(0);
+			// tell opengl how to treat data in location=0 - the data is treated in lots of 3 (3 floats = vec3)
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void *)(offsetof(mesh_vertex, pos)));
+
+			// do the same thing for Normals but bind it to location=1
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void *)(offsetof(mesh_vertex, norm)));
 
-		// do the same thing for Normals but bind it to location=1
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void *)(offsetof(mesh_vertex, norm)));
+			// do the same thing for UVs but bind it to location=2 - the data is treated in lots of 2 (2 floats = vec2)
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void *)(offsetof(mesh_vertex, uv)));
 
-		// do the same thing for UVs but bind it to location=2 - the data is treated in lots of 2 (2 floats = vec2)
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void *)(offsetof(mesh_vertex, uv)));
+			// and tangents to location=3 after each vertex
+			if (has_tangents) {
+				glEnableVertexAttribArray(3);
+				glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void *)(offsetof(mesh_vertex_tangent, tangent)));
+			}
+		}
 
 
 		// IBO
 		//
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ibo);
-		// upload the indices for drawing primitives
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+		// upload the indices for drawing primitives, as 16 bit when every vertex can be reached with them
+		if (vertices.size() <= 65536) {
+			std::vector<uint16_t> short_indices(indices.begin(), indices.end());
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * short_indices.size(), short_indices.data(), GL_STATIC_DRAW);
+			m.index_type = GL_UNSIGNED_SHORT;
+		} else {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), indices.data(), GL_STATIC_DRAW);
+			m.index_type = GL_UNSIGNED_INT;
+		}
 
 
 		// set the index count and draw modes
 		m.index_count = indices.size();
 		m.mode = mode;
+		m.has_tangents = has_tangents;
 
 		// clean up by binding VAO 0 (good practice)
 		glBindVertexArray(0);
 
 		return m;
 	}
-}
\ No newline at end of file
+}
@@ -3,6 +3,7 @@
 
 // std
 #include <iostream>
+#include <string>
 #include <vector>
 
 // glm
@@ -17,18 +18,34 @@ namespace cgra {
 
 	// A data structure for holding buffer IDs and other information related to drawing.
 	// Also has a helper functions for drawing the mesh and deleting the gl buffers.
-	// location 1 : positions (vec3)
-	// location 2 : normals (vec3)
-	// location 3 : uv (vec2)
+	// location 0 : positions (vec3)
+	// location 1 : normals (vec3)
+	// location 2 : uv (vec2)
+	// location 3 : tangents (vec4), only if has_tangents
 	struct gl_mesh {
 		GLuint vao = 0;
 		GLuint vbo = 0;
 		GLuint ibo = 0;
 		GLenum mode = 0; // mode to draw in, eg: GL_TRIANGLES
+		GLenum index_type = GL_UNSIGNED_INT; // GL_UNSIGNED_SHORT when there are few enough vertices
 		int index_count = 0; // how many indicies to draw (no primitives)
+		bool has_tangents = false; // draw with a shader permutation that reads location 3 (eg. HAS_TANGENTS in pbr.vs)
+
+		// maps the positions in the vertex buffer to model space, only not identity for packed positions.
+		// multiply the model matrix by it for positions (normals are not affected)
+		glm::mat4 position_transform{1};
+
+		// model space bounds (before position_transform), for culling and picking
+		glm::vec3 bounds_min{0};
+		glm::vec3 bounds_max{0};
+		glm::vec3 sphere_centre{0};
+		float sphere_radius = 0;
 
 		// calls the draw function on mesh data
-		void draw();
+		void draw() const;
+
+		// draws instance_count copies in one call, which the shader tells apart by gl_InstanceID
+		void draw_instanced(int instance_count) const;
 
 		// deletes the gl buffers (cleans up all the data)
 		void destroy();
@@ -42,14 +59,35 @@ namespace cgra {
 	};
 
 
+	// a mesh_vertex with its tangent after it, the full layout of meshes that have tangents
+	struct mesh_vertex_tangent {
+		mesh_vertex vertex;
+		glm::vec4 tangent{0};
+	};
+
+
+	// vertex layouts the mesh builder can upload
+	enum class vertex_format {
+		full,   // mesh_vertex as it is, 32 bytes (48 with tangents, as mesh_vertex_tangent)
+		packed  // 16 bytes: positions as normalized int16 within the bounds (see gl_mesh::position_transform),
+		        // normals as snorm 2_10_10_10 and uvs as half floats, plus tangents as snorm 2_10_10_10 if there are any
+	};
+
+
 	// Mesh builder object used to create an mesh by taking vertex and index information
 	// and uploading them to OpenGL.
 	struct mesh_builder {
 
 		GLenum mode = GL_TRIANGLES;
+		vertex_format format = vertex_format::full;
+		bool has_tangents = false; // set by generate_tangents, uploads the tangents to location 3
 		std::vector<mesh_vertex> vertices;
 		std::vector<unsigned int> indices;
 
+		// one per vertex when has_tangents, otherwise empty. xyz is along +u and w is the sign of the bitangent
+		// (w * cross(norm, tangent) is along +v). kept apart so meshes without them stay 32 bytes a vertex
+		std::vector<glm::vec4> tangents;
+
 		mesh_builder() {}
 
 		mesh_builder(GLenum mode_) : mode(mode_) {}
@@ -73,6 +111,15 @@ namespace cgra {
 			indices.insert(indices.end(), inds);
 		}
 
+		// fills in the vertex tangents from the uvs the way MikkTSpace does: each triangle's tangent is projected
+		// into the plane of each corner's normal and summed, weighted by the corner angle, and vertices are split
+		// where triangles with mirrored uvs meet. only GL_TRIANGLES meshes with uvs get useful tangents
+		void generate_tangents();
+
+		// reorders the triangles for the vertex cache and overdraw, then the vertices for fetching,
+		// and prints the ACMR before and after (only GL_TRIANGLES meshes are changed)
+		void optimise(const std::string &name);
+
 		gl_mesh build() const;
 
 		void print() const {
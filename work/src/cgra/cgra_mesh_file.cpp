@@ -0,0 +1,150 @@
+
+// std
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// project
+#include "cgra_cache.hpp"
+#include "cgra_mapped_file.hpp"
+#include "cgra_mesh_file.hpp"
+#include "cgra_trace.hpp"
+
+
+namespace cgra {
+
+	namespace {
+
+		const char g_mesh_magic[4] = { 'C', 'M', 'S', 'H' };
+		const uint32_t g_mesh_version = 4;
+		const uint64_t g_mesh_alignment = 64;
+
+		uint64_t align(uint64_t offset) {
+			return (offset + g_mesh_alignment - 1) / g_mesh_alignment * g_mesh_alignment;
+		}
+
+		uint64_t index_size(uint32_t index_type) {
+			return index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+		}
+	}
+
+
+	bool write_mesh_file(const std::string &filename, const mesh_builder &mb, uint64_t key) {
+		CGRA_TRACE_ZONE("write_mesh_file");
+
+		mesh_file_header header = {};
+		std::memcpy(header.magic, g_mesh_magic, sizeof(header.magic));
+		header.version = g_mesh_version;
+		header.key = key;
+		header.mode = mb.mode;
+		header.index_type = mb.vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		header.vertex_count = uint32_t(mb.vertices.size());
+		header.index_count = uint32_t(mb.indices.size());
+		header.vertex_stride = mb.has_tangents ? sizeof(mesh_vertex_tangent) : sizeof(mesh_vertex);
+		header.attribute_count = 3;
+		header.attributes[0] = { 0, 3, GL_FLOAT, GL_FALSE, uint32_t(offsetof(mesh_vertex, pos)) };
+		header.attributes[1] = { 1, 3, GL_FLOAT, GL_FALSE, uint32_t(offsetof(mesh_vertex, norm)) };
+		header.attributes[2] = { 2, 2, GL_FLOAT, GL_FALSE, uint32_t(offsetof(mesh_vertex, uv)) };
+		if (mb.has_tangents) {
+			header.attributes[header.attribute_count++] = { 3, 4, GL_FLOAT, GL_FALSE, uint32_t(offsetof(mesh_vertex_tangent, tangent)) };
+		}
+
+		glm::vec3 lo(0), hi(0);
+		if (!mb.vertices.empty()) lo = hi = mb.vertices[0].pos;
+		for (const mesh_vertex &v : mb.vertices) {
+			lo = min(lo, v.pos);
+			hi = max(hi, v.pos);
+		}
+		for (int i = 0; i < 3; i++) {
+			header.bounds_min[i] = lo[i];
+			header.bounds_max[i] = hi[i];
+		}
+
+		header.vertex_offset = align(sizeof(header));
+		header.vertex_size = mb.vertices.size() * header.vertex_stride;
+		header.index_offset = align(header.vertex_offset + header.vertex_size);
+		header.index_size = mb.indices.size() * index_size(header.index_type);
+
+		std::vector<char> out(header.index_offset + header.index_size, 0);
+		std::memcpy(out.data(), &header, sizeof(header));
+		if (mb.has_tangents) {
+			mesh_vertex_tangent *vertices = reinterpret_cast<mesh_vertex_tangent *>(out.data() + header.vertex_offset);
+			for (size_t i = 0; i < mb.vertices.size(); i++) vertices[i] = { mb.vertices[i], mb.tangents[i] };
+		} else if (header.vertex_size) {
+			std::memcpy(out.data() + header.vertex_offset, mb.vertices.data(), header.vertex_size);
+		}
+		if (header.index_type == GL_UNSIGNED_SHORT) {
+			uint16_t *indices = reinterpret_cast<uint16_t *>(out.data() + header.index_offset);
+			for (size_t i = 0; i < mb.indices.size(); i++) indices[i] = uint16_t(mb.indices[i]);
+		} else if (header.index_size) {
+			std::memcpy(out.data() + header.index_offset, mb.indices.data(), header.index_size);
+		}
+		return write_binary_file(filename, out.data(), out.size());
+	}
+
+
+	bool load_mesh_file(const std::string &filename, uint64_t key, gl_mesh &mesh) {
+		CGRA_TRACE_ZONE("load_mesh_file");
+
+		mapped_file file(filename);
+		if (!file.is_open() || file.size() < sizeof(mesh_file_header)) return false;
+
+		mesh_file_header header;
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (std::memcmp(header.magic, g_mesh_magic, sizeof(header.magic)) != 0 || header.version != g_mesh_version || header.key != key) return false;
+
+		// everything the header points to has to be inside the file
+		bool valid = (header.index_type == GL_UNSIGNED_SHORT || header.index_type == GL_UNSIGNED_INT)
+			&& header.vertex_stride > 0
+			&& header.attribute_count <= 8
+			&& header.vertex_size == uint64_t(header.vertex_count) * header.vertex_stride
+			&& header.index_size == uint64_t(header.index_count) * index_size(header.index_type)
+			&& header.vertex_offset <= file.size() && header.vertex_size <= file.size() - header.vertex_offset
+			&& header.index_offset <= file.size() && header.index_size <= file.size() - header.index_offset;
+		for (uint32_t i = 0; valid && i < header.attribute_count; i++) {
+			valid = header.attributes[i].offset < header.vertex_stride && header.attributes[i].components <= 4;
+		}
+		if (!valid) {
+			std::cerr << "Warning: Ignoring malformed mesh file " << filename << std::endl;
+			return false;
+		}
+
+		gl_mesh m;
+		glGenVertexArrays(1, &m.vao);
+		glGenBuffers(1, &m.vbo);
+		glGenBuffers(1, &m.ibo);
+		glBindVertexArray(m.vao);
+
+		// the mapped pages are given to the driver directly
+		glBindBuffer(GL_ARRAY_BUFFER, m.vbo);
+		glBufferData(GL_ARRAY_BUFFER, header.vertex_size, file.data() + header.vertex_offset, GL_STATIC_DRAW);
+		for (uint32_t i = 0; i < header.attribute_count; i++) {
+			const mesh_attribute &a = header.attributes[i];
+			glEnableVertexAttribArray(a.location);
+			glVertexAttribPointer(a.location, a.components, a.type, GLboolean(a.normalized), header.vertex_stride, (void *)(size_t(a.offset)));
+			if (a.location == 3) m.has_tangents = true;
+		}
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, header.index_size, file.data() + header.index_offset, GL_STATIC_DRAW);
+
+		// the file only has the box, so the sphere is the one around it
+		for (int i = 0; i < 3; i++) {
+			m.bounds_min[i] = header.bounds_min[i];
+			m.bounds_max[i] = header.bounds_max[i];
+		}
+		m.sphere_centre = (m.bounds_min + m.bounds_max) * 0.5f;
+		m.sphere_radius = glm::distance(m.bounds_min, m.bounds_max) * 0.5f;
+
+		m.index_type = header.index_type;
+		m.index_count = header.index_count;
+		m.mode = header.mode;
+
+		glBindVertexArray(0);
+
+		mesh = m;
+		return true;
+	}
+}
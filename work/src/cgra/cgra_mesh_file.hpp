@@ -0,0 +1,50 @@
+
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+
+// project
+#include "cgra_mesh.hpp"
+
+
+namespace cgra {
+
+	// one vertex attribute of a mesh file, given straight to glVertexAttribPointer
+	struct mesh_attribute {
+		uint32_t location;
+		uint32_t components;
+		uint32_t type; // eg. GL_FLOAT
+		uint32_t normalized;
+		uint32_t offset; // from the start of a vertex
+	};
+
+	// the fixed size header at the start of a .cmesh file
+	// the interleaved vertices and the indices follow it, each 64 byte aligned in the file
+	struct mesh_file_header {
+		char magic[4]; // CMSH
+		uint32_t version;
+		uint64_t key; // identifies what the mesh was made from, eg. a hash of the source asset
+		uint32_t mode; // eg. GL_TRIANGLES
+		uint32_t index_type; // GL_UNSIGNED_SHORT when there are at most 65536 vertices, otherwise GL_UNSIGNED_INT
+		uint32_t vertex_count;
+		uint32_t index_count;
+		uint32_t vertex_stride;
+		uint32_t attribute_count;
+		mesh_attribute attributes[8];
+		float bounds_min[3];
+		float bounds_max[3];
+		uint64_t vertex_offset;
+		uint64_t vertex_size;
+		uint64_t index_offset;
+		uint64_t index_size;
+	};
+
+	// writes the vertices (as mesh_vertex, or mesh_vertex_tangent if it has tangents) and indices of a mesh builder to a mesh file
+	bool write_mesh_file(const std::string &filename, const mesh_builder &mb, uint64_t key);
+
+	// memory maps a mesh file and uploads its vertex and index blobs from the mapping, with no copies
+	// returns false (leaving mesh untouched) if the file is missing, malformed or was written with another key
+	bool load_mesh_file(const std::string &filename, uint64_t key, gl_mesh &mesh);
+}
@@ -0,0 +1,180 @@
+
+// std
+#include <algorithm>
+#include <cstdint>
+
+// project
+#include "cgra_mesh_optimise.hpp"
+#include "cgra_trace.hpp"
+
+
+using namespace glm;
+
+namespace cgra {
+
+	float mesh_acmr(const std::vector<GLuint> &indices, size_t vertex_count, int cache_size) {
+		if (indices.size() < 3) return 0;
+
+		// a vertex is in the cache if fewer than cache_size misses happened since it was loaded
+		std::vector<int64_t> loaded(vertex_count, -int64_t(cache_size) - 1);
+		int64_t misses = 0;
+		for (GLuint v : indices) {
+			if (misses - loaded[v] > cache_size) {
+				loaded[v] = misses;
+				misses++;
+			}
+		}
+		return float(misses) / float(indices.size() / 3);
+	}
+
+
+	std::vector<size_t> optimise_vertex_cache(std::vector<GLuint> &indices, size_t vertex_count, int cache_size) {
+		CGRA_TRACE_ZONE("optimise_vertex_cache");
+		const size_t triangle_count = indices.size() / 3;
+		std::vector<size_t> clusters = { 0 };
+		if (triangle_count == 0) return clusters;
+
+		// the triangles around each vertex, and how many of them are still to be emitted
+		std::vector<uint32_t> live(vertex_count, 0);
+		for (size_t i = 0; i < triangle_count * 3; i++) live[indices[i]]++;
+		std::vector<size_t> offsets(vertex_count + 1, 0);
+		for (size_t v = 0; v < vertex_count; v++) offsets[v + 1] = offsets[v] + live[v];
+		std::vector<uint32_t> adjacency(offsets[vertex_count]);
+		std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangle_count; t++) {
+			for (int k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = uint32_t(t);
+		}
+
+		// when each vertex last went into the cache, in cache insertions
+		std::vector<int64_t> stamp(vertex_count, 0);
+		int64_t time = cache_size + 1;
+
+		std::vector<uint8_t> emitted(triangle_count, 0);
+		std::vector<GLuint> dead_ends, candidates, out;
+		out.reserve(triangle_count * 3);
+		size_t cursor = 0;
+
+		auto next_unfinished = [&]() -> int64_t {
+			while (cursor < vertex_count && live[cursor] == 0) cursor++;
+			return cursor < vertex_count ? int64_t(cursor) : -1;
+		};
+
+		// emit every triangle around the fanning vertex, then move to the candidate that will still
+		// be in the cache after its own triangles are emitted (the oldest such one)
+		for (int64_t fan = next_unfinished(); fan >= 0;) {
+			candidates.clear();
+			for (size_t j = offsets[fan]; j < offsets[fan + 1]; j++) {
+				uint32_t t = adjacency[j];
+				if (emitted[t]) continue;
+				emitted[t] = 1;
+				for (int k = 0; k < 3; k++) {
+					GLuint v = indices[t * 3 + k];
+					out.push_back(v);
+					dead_ends.push_back(v);
+					candidates.push_back(v);
+					live[v]--;
+					if (time - stamp[v] > cache_size) stamp[v] = time++;
+				}
+			}
+
+			int64_t best = -1, best_priority = -1;
+			for (GLuint v : candidates) {
+				if (live[v] == 0) continue;
+				int64_t priority = time - stamp[v] + 2 * int64_t(live[v]) <= cache_size ? time - stamp[v] : 0;
+				if (priority > best_priority) {
+					best = v;
+					best_priority = priority;
+				}
+			}
+
+			// dead end, go back to a recent vertex with triangles left, or jump to the next unfinished one.
+			// if that vertex has left the cache the order starts again from nothing, so a cluster ends
+			if (best < 0) {
+				while (best < 0 && !dead_ends.empty()) {
+					GLuint v = dead_ends.back();
+					dead_ends.pop_back();
+					if (live[v] > 0) best = v;
+				}
+				if (best < 0) best = next_unfinished();
+				if (best >= 0 && time - stamp[best] > cache_size) clusters.push_back(out.size() / 3);
+			}
+			fan = best;
+		}
+
+		indices.swap(out);
+		return clusters;
+	}
+
+
+	void optimise_overdraw(std::vector<GLuint> &indices, const std::vector<mesh_vertex> &vertices, const std::vector<size_t> &clusters) {
+		CGRA_TRACE_ZONE("optimise_overdraw");
+		const size_t triangle_count = indices.size() / 3;
+		if (clusters.size() < 2) return;
+
+		// area weighted centroid and normal of each cluster, and of the whole mesh
+		struct cluster {
+			size_t first, last;
+			vec3 centroid{0};
+			vec3 normal{0};
+			float area = 0;
+			float sort_key = 0;
+		};
+		std::vector<cluster> sorted(clusters.size());
+		vec3 mesh_centroid(0);
+		float mesh_area = 0;
+		for (size_t c = 0; c < clusters.size(); c++) {
+			cluster &cl = sorted[c];
+			cl.first = clusters[c];
+			cl.last = c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+			for (size_t t = cl.first; t < cl.last; t++) {
+				vec3 a = vertices[indices[t * 3]].pos;
+				vec3 b = vertices[indices[t * 3 + 1]].pos;
+				vec3 d = vertices[indices[t * 3 + 2]].pos;
+				vec3 n = cross(b - a, d - a);
+				float area = length(n);
+				cl.centroid += area * (a + b + d) / 3.0f;
+				cl.normal += n;
+				cl.area += area;
+			}
+			mesh_centroid += cl.centroid;
+			mesh_area += cl.area;
+			if (cl.area > 0) cl.centroid /= cl.area;
+		}
+		if (mesh_area > 0) mesh_centroid /= mesh_area;
+
+		// clusters facing away from the middle are more likely to be in front of the others
+		for (cluster &cl : sorted) {
+			float l = length(cl.normal);
+			cl.sort_key = l > 0 ? dot(cl.centroid - mesh_centroid, cl.normal / l) : 0;
+		}
+		std::stable_sort(sorted.begin(), sorted.end(), [](const cluster &a, const cluster &b) { return a.sort_key > b.sort_key; });
+
+		std::vector<GLuint> out;
+		out.reserve(indices.size());
+		for (const cluster &cl : sorted) {
+			out.insert(out.end(), indices.begin() + cl.first * 3, indices.begin() + cl.last * 3);
+		}
+		indices.swap(out);
+	}
+
+
+	void optimise_vertex_fetch(std::vector<mesh_vertex> &vertices, std::vector<GLuint> &indices, std::vector<glm::vec4> *tangents) {
+		CGRA_TRACE_ZONE("optimise_vertex_fetch");
+		const GLuint unused = ~GLuint(0);
+		std::vector<GLuint> remap(vertices.size(), unused);
+		std::vector<mesh_vertex> out;
+		std::vector<glm::vec4> out_tangents;
+		out.reserve(vertices.size());
+		if (tangents) out_tangents.reserve(tangents->size());
+		for (GLuint &i : indices) {
+			if (remap[i] == unused) {
+				remap[i] = GLuint(out.size());
+				out.push_back(vertices[i]);
+				if (tangents) out_tangents.push_back((*tangents)[i]);
+			}
+			i = remap[i];
+		}
+		vertices.swap(out);
+		if (tangents) tangents->swap(out_tangents);
+	}
+}
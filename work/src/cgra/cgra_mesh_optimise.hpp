@@ -0,0 +1,32 @@
+
+#pragma once
+
+// std
+#include <vector>
+
+// project
+#include "cgra_mesh.hpp"
+
+
+namespace cgra {
+
+	// the post-transform cache is modelled as a FIFO of this many vertices
+	const int mesh_cache_size = 16;
+
+	// average cache miss ratio: vertices transformed per triangle with a FIFO cache of cache_size
+	// (3 when nothing is reused, 0.5 is the limit for large regular grids)
+	float mesh_acmr(const std::vector<GLuint> &indices, size_t vertex_count, int cache_size = mesh_cache_size);
+
+	// reorders triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007)
+	// returns the index of the first triangle of each cluster, split where the order has to jump
+	// to an unrelated part of the mesh, which is where reordering for overdraw costs no cache misses
+	std::vector<size_t> optimise_vertex_cache(std::vector<GLuint> &indices, size_t vertex_count, int cache_size = mesh_cache_size);
+
+	// sorts the clusters from optimise_vertex_cache so the ones facing out from the middle of the mesh
+	// are drawn first and occlude the rest, keeping the order of the triangles inside each cluster
+	void optimise_overdraw(std::vector<GLuint> &indices, const std::vector<mesh_vertex> &vertices, const std::vector<size_t> &clusters);
+
+	// reorders the vertices into the order they are first used (dropping unused ones) and remaps the indices,
+	// moving the tangents the same way if there are any
+	void optimise_vertex_fetch(std::vector<mesh_vertex> &vertices, std::vector<GLuint> &indices, std::vector<glm::vec4> *tangents = nullptr);
+}
@@ -0,0 +1,314 @@
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// sse2
+#include <emmintrin.h>
+
+// project
+#include "cgra_cache.hpp"
+#include "cgra_mipmap.hpp"
+#include "cgra_trace.hpp"
+
+
+namespace cgra {
+
+	namespace {
+
+		const char g_mip_magic[4] = { 'C', 'M', 'I', 'P' };
+		const uint32_t g_mip_version = 1;
+
+		// sRGB <-> linear tables, the encode table is indexed by linear * 4095
+		struct srgb_tables {
+			float to_linear[256];
+			unsigned char to_srgb[4096];
+
+			srgb_tables() {
+				for (int i = 0; i < 256; i++) {
+					float c = i / 255.0f;
+					to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+				for (int i = 0; i < 4096; i++) {
+					float l = i / 4095.0f;
+					float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1 / 2.4f) - 0.055f;
+					to_srgb[i] = (unsigned char)(std::min(255.0f, c * 255.0f + 0.5f));
+				}
+			}
+		};
+
+		const srgb_tables & tables() {
+			static const srgb_tables t;
+			return t;
+		}
+
+
+		// a level at float precision, always four floats per pixel so one pixel is one SSE register
+		struct float_level {
+			int width = 0;
+			int height = 0;
+			std::vector<float> pixels;
+		};
+
+
+		// for every output pixel along one axis, the source pixels (already wrapped
+		// or clamped) and normalised weights of the kernel
+		struct axis_taps {
+			int count = 0; // taps per output pixel
+			std::vector<int> index;
+			std::vector<float> weight;
+		};
+
+		float bessel_i0(float x) {
+			// power series, converges quickly for the small arguments used here
+			float sum = 1, term = 1;
+			for (int k = 1; k < 20; k++) {
+				term *= (x / (2 * k)) * (x / (2 * k));
+				sum += term;
+			}
+			return sum;
+		}
+
+		// d is the distance in output pixels, the kernel spans two of them either side
+		float kaiser(float d) {
+			const float alpha = 4.0f;
+			const float pi = 3.14159265359f;
+			if (std::abs(d) >= 2) return 0;
+			float sinc = d == 0 ? 1 : std::sin(pi * d) / (pi * d);
+			float t = d / 2;
+			return sinc * bessel_i0(alpha * std::sqrt(1 - t * t)) / bessel_i0(alpha);
+		}
+
+		axis_taps make_taps(int src, int dst, const mip_options &options) {
+			axis_taps taps;
+			if (src == dst) {
+				taps.count = 1;
+				for (int i = 0; i < dst; i++) {
+					taps.index.push_back(i);
+					taps.weight.push_back(1);
+				}
+				return taps;
+			}
+
+			// source pixel i covers [i, i+1], output pixel x covers scale source pixels around c
+			float scale = float(src) / float(dst);
+			float radius = options.filter == mip_filter::box ? scale / 2 : 2 * scale;
+			taps.count = int(std::ceil(2 * radius)) + 1;
+			for (int x = 0; x < dst; x++) {
+				float c = (x + 0.5f) * scale;
+				int first = int(std::floor(c - radius));
+				float sum = 0;
+				for (int k = 0; k < taps.count; k++) {
+					int i = first + k;
+					float w;
+					if (options.filter == mip_filter::box) {
+						w = std::max(0.0f, std::min(float(i + 1), c + radius) - std::max(float(i), c - radius));
+					} else {
+						w = kaiser((i + 0.5f - c) / scale);
+					}
+					sum += w;
+					i = options.wrap ? ((i % src) + src) % src : std::min(std::max(i, 0), src - 1);
+					taps.index.push_back(i);
+					taps.weight.push_back(w);
+				}
+				for (int k = 0; k < taps.count; k++) taps.weight[x * taps.count + k] /= sum;
+			}
+			return taps;
+		}
+
+
+		float_level downsample(const float_level &src, const mip_options &options) {
+			CGRA_TRACE_ZONE("downsample");
+			float_level dst;
+			dst.width = std::max(1, src.width / 2);
+			dst.height = std::max(1, src.height / 2);
+			dst.pixels.resize(size_t(dst.width) * dst.height * 4);
+
+			axis_taps tx = make_taps(src.width, dst.width, options);
+			axis_taps ty = make_taps(src.height, dst.height, options);
+
+			// horizontal pass, every source row to dst.width pixels
+			std::vector<float> rows(size_t(dst.width) * src.height * 4);
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+			for (int y = 0; y < src.height; y++) {
+				const float *in = &src.pixels[size_t(y) * src.width * 4];
+				float *out = &rows[size_t(y) * dst.width * 4];
+				for (int x = 0; x < dst.width; x++) {
+					const int *index = &tx.index[size_t(x) * tx.count];
+					const float *weight = &tx.weight[size_t(x) * tx.count];
+					__m128 sum = _mm_setzero_ps();
+					for (int k = 0; k < tx.count; k++) {
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(in + index[k] * 4)));
+					}
+					_mm_storeu_ps(out + x * 4, sum);
+				}
+			}
+
+			// vertical pass, whole rows at a time
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+			for (int y = 0; y < dst.height; y++) {
+				float *out = &dst.pixels[size_t(y) * dst.width * 4];
+				const int *index = &ty.index[size_t(y) * ty.count];
+				const float *weight = &ty.weight[size_t(y) * ty.count];
+				for (int k = 0; k < ty.count; k++) {
+					const float *in = &rows[size_t(index[k]) * dst.width * 4];
+					__m128 w = _mm_set1_ps(weight[k]);
+					for (int x = 0; x < dst.width; x++) {
+						__m128 acc = k == 0 ? _mm_setzero_ps() : _mm_loadu_ps(out + x * 4);
+						_mm_storeu_ps(out + x * 4, _mm_add_ps(acc, _mm_mul_ps(w, _mm_loadu_ps(in + x * 4))));
+					}
+				}
+			}
+			return dst;
+		}
+
+
+		float_level decode(const unsigned char *pixels, int width, int height, int channels, bool srgb) {
+			const srgb_tables &t = tables();
+			float_level level;
+			level.width = width;
+			level.height = height;
+			level.pixels.assign(size_t(width) * height * 4, 0.0f);
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+			for (int y = 0; y < height; y++) {
+				for (size_t i = size_t(y) * width; i < size_t(y + 1) * width; i++) {
+					for (int c = 0; c < channels; c++) {
+						unsigned char v = pixels[i * channels + c];
+						level.pixels[i * 4 + c] = srgb && c < 3 ? t.to_linear[v] : v / 255.0f;
+					}
+				}
+			}
+			return level;
+		}
+
+
+		mip_level encode(const float_level &level, int channels, bool srgb) {
+			const srgb_tables &t = tables();
+			mip_level out;
+			out.width = level.width;
+			out.height = level.height;
+			out.pixels.resize(size_t(level.width) * level.height * channels);
+
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+			// sRGB channels become indices into the encode table, alpha is always stored linearly
+			const __m128 scale = srgb ? _mm_set_ps(255.0f, 4095.0f, 4095.0f, 4095.0f) : _mm_set1_ps(255.0f);
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+			for (int y = 0; y < level.height; y++) {
+				alignas(16) int q[4];
+				for (size_t i = size_t(y) * level.width; i < size_t(y + 1) * level.width; i++) {
+					__m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&level.pixels[i * 4]), zero), one);
+					_mm_store_si128(reinterpret_cast<__m128i *>(q), _mm_cvtps_epi32(_mm_mul_ps(v, scale)));
+					for (int c = 0; c < channels; c++) {
+						out.pixels[i * channels + c] = srgb && c < 3 ? t.to_srgb[q[c]] : (unsigned char)q[c];
+					}
+				}
+			}
+			return out;
+		}
+
+
+		void append(std::vector<char> &out, const void *data, size_t size) {
+			const char *p = static_cast<const char *>(data);
+			out.insert(out.end(), p, p + size);
+		}
+
+		bool read(const std::vector<char> &in, size_t &offset, void *data, size_t size) {
+			if (offset + size > in.size()) return false;
+			std::memcpy(data, in.data() + offset, size);
+			offset += size;
+			return true;
+		}
+	}
+
+
+	std::vector<mip_level> build_mipmaps(const unsigned char *pixels, int width, int height, int channels, const mip_options &options) {
+		CGRA_TRACE_ZONE("build_mipmaps");
+		std::vector<mip_level> levels(1);
+		levels[0].width = width;
+		levels[0].height = height;
+		levels[0].pixels.assign(pixels, pixels + size_t(width) * height * channels);
+
+		float_level level = decode(pixels, width, height, channels, options.srgb);
+		while (level.width > 1 || level.height > 1) {
+			level = downsample(level, options);
+			levels.push_back(encode(level, channels, options.srgb));
+		}
+		return levels;
+	}
+
+
+	std::vector<mip_level> cached_mipmaps(const unsigned char *pixels, int width, int height, int channels, const mip_options &options) {
+		CGRA_TRACE_ZONE("cached_mipmaps");
+		std::string params = "mipmaps v1 " + std::to_string(width) + "x" + std::to_string(height) + "x" + std::to_string(channels)
+			+ (options.filter == mip_filter::box ? " box" : " kaiser") + (options.srgb ? " srgb" : "") + (options.wrap ? " wrap" : "");
+		uint64_t key = hash_bytes(pixels, size_t(width) * height * channels, hash_string(params));
+		std::string filename = cache_path("mipmaps", key, ".mip");
+
+		// the file holds levels 1 and up, level 0 is the input
+		std::vector<mip_level> levels(1);
+		levels[0].width = width;
+		levels[0].height = height;
+		levels[0].pixels.assign(pixels, pixels + size_t(width) * height * channels);
+
+		std::vector<char> in;
+		if (read_binary_file(filename, in)) {
+			size_t offset = 0;
+			char magic[4];
+			uint32_t version;
+			uint64_t stored_key;
+			bool ok = read(in, offset, magic, sizeof(magic)) && std::memcmp(magic, g_mip_magic, sizeof(magic)) == 0
+				&& read(in, offset, &version, sizeof(version)) && version == g_mip_version
+				&& read(in, offset, &stored_key, sizeof(stored_key)) && stored_key == key;
+			int w = width, h = height;
+			while (ok && (w > 1 || h > 1)) {
+				w = std::max(1, w / 2);
+				h = std::max(1, h / 2);
+				mip_level level;
+				level.width = w;
+				level.height = h;
+				level.pixels.resize(size_t(w) * h * channels);
+				ok = read(in, offset, level.pixels.data(), level.pixels.size());
+				levels.push_back(std::move(level));
+			}
+			if (ok && offset == in.size()) return levels;
+		}
+
+		levels = build_mipmaps(pixels, width, height, channels, options);
+
+		std::vector<char> out;
+		append(out, g_mip_magic, sizeof(g_mip_magic));
+		append(out, &g_mip_version, sizeof(g_mip_version));
+		append(out, &key, sizeof(key));
+		for (size_t i = 1; i < levels.size(); i++) append(out, levels[i].pixels.data(), levels[i].pixels.size());
+		if (!write_binary_file(filename, out.data(), out.size()))
+			std::cerr << "Warning: Failed to write mipmap cache " << filename << std::endl;
+		return levels;
+	}
+
+
+	void upload_mipmaps(GLenum target, GLenum internal_format, GLenum format, const std::vector<mip_level> &levels) {
+		// rows of 1 and 3 channel levels are not 4 byte aligned
+		GLint unpack_alignment;
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_alignment);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		for (size_t i = 0; i < levels.size(); i++) {
+			glTexImage2D(target, GLint(i), internal_format, levels[i].width, levels[i].height, 0, format, GL_UNSIGNED_BYTE, levels[i].pixels.data());
+		}
+		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, GLint(levels.size()) - 1);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment);
+	}
+}
@@ -0,0 +1,42 @@
+
+#pragma once
+
+// std
+#include <vector>
+
+// project
+#include <opengl.hpp>
+
+
+namespace cgra {
+
+	enum class mip_filter {
+		box,    // area average, what glGenerateMipmap does on most drivers
+		kaiser  // Kaiser windowed sinc, sharper mips without much ringing
+	};
+
+	struct mip_options {
+		mip_filter filter = mip_filter::box;
+		bool srgb = false; // the first three channels are sRGB encoded and filtered in linear space (alpha never is)
+		bool wrap = false; // the kernel wraps around the edges (repeating textures) instead of clamping
+	};
+
+	// one level of an 8 bit image with interleaved channels
+	struct mip_level {
+		int width = 0;
+		int height = 0;
+		std::vector<unsigned char> pixels;
+	};
+
+	// builds the whole mip chain of an 8 bit image with 1 to 4 channels, level 0 is a copy of the input.
+	// levels are filtered from the previous level at float precision (SSE, rows in parallel)
+	std::vector<mip_level> build_mipmaps(const unsigned char *pixels, int width, int height, int channels, const mip_options &options = {});
+
+	// same, but the levels are kept in res/cache/mipmaps keyed on the pixels and options,
+	// so loading the same image again skips the filtering
+	std::vector<mip_level> cached_mipmaps(const unsigned char *pixels, int width, int height, int channels, const mip_options &options = {});
+
+	// uploads every level to the texture bound to target and limits GL_TEXTURE_MAX_LEVEL to them
+	// format is the pixel format of the levels (GL_RED, GL_RG, GL_RGB or GL_RGBA)
+	void upload_mipmaps(GLenum target, GLenum internal_format, GLenum format, const std::vector<mip_level> &levels);
+}
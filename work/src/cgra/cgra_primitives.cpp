@@ -0,0 +1,276 @@
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+// glm
+#include <glm/gtc/constants.hpp>
+
+// project
+#include "cgra_primitives.hpp"
+#include "cgra_trace.hpp"
+
+
+using namespace glm;
+
+namespace cgra {
+
+	namespace {
+
+		enum class primitive { sphere, cylinder, cone, cube, quad };
+
+		// shared meshes by shape and level of detail. map nodes do not move, so references to them stay valid
+		std::map<std::tuple<primitive, int, int>, gl_mesh> g_primitives;
+		std::map<std::tuple<primitive, int, int, int>, gl_mesh_lods> g_primitive_lods; // also by level count
+		std::map<std::tuple<primitive, int, int>, triangle_bvh> g_primitive_bvhs;
+
+		template <typename Build>
+		const gl_mesh & shared_mesh(primitive shape, int a, int b, Build build) {
+			auto key = std::make_tuple(shape, a, b);
+			auto it = g_primitives.find(key);
+			if (it == g_primitives.end()) {
+				CGRA_TRACE_ZONE("cgra::shared_mesh build");
+				it = g_primitives.emplace(key, build().build()).first;
+			}
+			return it->second;
+		}
+
+		// the point at slice i of n around a unit circle, exactly the same for i = 0 and n so seams are welded
+		vec2 circle_point(int i, int n) {
+			float angle = float(i % n) / float(n) * two_pi<float>();
+			return vec2(std::cos(angle), std::sin(angle));
+		}
+
+		// a flat disc of radius 1 at z, facing down (-z) or up (+z)
+		void push_cap(mesh_builder &mb, int slices, float z, bool up) {
+			mesh_vertex centre;
+			centre.pos = vec3(0, 0, z);
+			centre.norm = vec3(0, 0, up ? 1 : -1);
+			centre.uv = vec2(0.5f);
+			GLuint c = mb.push_vertex(centre);
+			for (int i = 0; i < slices; i++) {
+				vec2 p = circle_point(i, slices);
+				mesh_vertex v = centre;
+				v.pos = vec3(p, z);
+				v.uv = 0.5f + 0.5f * p;
+				mb.push_vertex(v);
+			}
+			for (int i = 0; i < slices; i++) {
+				GLuint a = c + 1 + i, b = c + 1 + (i + 1) % slices;
+				if (up) mb.push_indices({ c, a, b });
+				else mb.push_indices({ c, b, a });
+			}
+		}
+	}
+
+
+	mesh_builder sphere_builder(int slices, int stacks) {
+		slices = std::max(slices, 3);
+		stacks = std::max(stacks, 2);
+		mesh_builder mb;
+
+		// rows of vertices around y from the top pole down, with the seam repeated for its uvs
+		for (int y = 0; y <= stacks; ++y) {
+			for (int x = 0; x <= slices; ++x) {
+				float xSegment = float(x) / float(slices);
+				float ySegment = float(y) / float(stacks);
+
+				// the seam and the poles land exactly on each other so the simplifier can tell they are joined
+				vec2 around = circle_point(x, slices);
+				float ring = (y == 0 || y == stacks) ? 0.0f : std::sin(ySegment * pi<float>());
+				float height = (y == 0) ? 1.0f : (y == stacks) ? -1.0f : std::cos(ySegment * pi<float>());
+
+				mesh_vertex v;
+				v.pos = vec3(around.x * ring, height, around.y * ring);
+				v.norm = v.pos;
+				v.uv = vec2(xSegment, ySegment);
+				mb.push_vertex(v);
+			}
+		}
+
+		// two triangles per quad between neighbouring slices
+		for (int y = 0; y < stacks; ++y) {
+			for (int x = 0; x < slices; ++x) {
+				GLuint a = y * (slices + 1) + x;
+				GLuint b = (y + 1) * (slices + 1) + x;
+				mb.push_indices({ a, a + 1, b });
+				mb.push_indices({ b, a + 1, b + 1 });
+			}
+		}
+
+		return mb;
+	}
+
+
+	mesh_builder cylinder_builder(int slices) {
+		slices = std::max(slices, 3);
+		mesh_builder mb;
+
+		// the side, a row of vertices around the bottom then the top with the seam repeated for its uvs
+		for (int z = 0; z <= 1; z++) {
+			for (int i = 0; i <= slices; i++) {
+				vec2 p = circle_point(i, slices);
+				mesh_vertex v;
+				v.pos = vec3(p, z);
+				v.norm = vec3(p, 0);
+				v.uv = vec2(float(i) / float(slices), z);
+				mb.push_vertex(v);
+			}
+		}
+		for (int i = 0; i < slices; i++) {
+			GLuint a = i, b = i + 1, c = slices + 2 + i, d = slices + 1 + i;
+			mb.push_indices({ a, b, c });
+			mb.push_indices({ a, c, d });
+		}
+
+		push_cap(mb, slices, 0, false);
+		push_cap(mb, slices, 1, true);
+		return mb;
+	}
+
+
+	mesh_builder cone_builder(int slices) {
+		slices = std::max(slices, 3);
+		mesh_builder mb;
+
+		// the normal of a cone as wide as it is high leans out at 45 degrees
+		const float lean = 1 / std::sqrt(2.0f);
+
+		// the base of the side, with the seam repeated for its uvs
+		for (int i = 0; i <= slices; i++) {
+			vec2 p = circle_point(i, slices);
+			mesh_vertex v;
+			v.pos = vec3(p, 0);
+			v.norm = vec3(p, 1) * lean;
+			v.uv = vec2(float(i) / float(slices), 0);
+			mb.push_vertex(v);
+		}
+
+		// a tip vertex for each slice, with the normal of the middle of that slice so it does not pinch
+		for (int i = 0; i < slices; i++) {
+			float angle = (i + 0.5f) / float(slices) * two_pi<float>();
+			mesh_vertex v;
+			v.pos = vec3(0, 0, 1);
+			v.norm = vec3(std::cos(angle), std::sin(angle), 1) * lean;
+			v.uv = vec2((i + 0.5f) / float(slices), 1);
+			mb.push_vertex(v);
+		}
+		for (int i = 0; i < slices; i++) {
+			mb.push_indices({ GLuint(i), GLuint(i + 1), GLuint(slices + 1 + i) });
+		}
+
+		push_cap(mb, slices, 0, false);
+		return mb;
+	}
+
+
+	mesh_builder cube_builder() {
+		mesh_builder mb;
+
+		// each face's normal, and the directions of +u and +v across it (counter-clockwise seen from outside)
+		const vec3 faces[6][3] = {
+			{ vec3( 1, 0, 0), vec3(0, 0, -1), vec3(0, 1,  0) },
+			{ vec3(-1, 0, 0), vec3(0, 0,  1), vec3(0, 1,  0) },
+			{ vec3(0,  1, 0), vec3(1, 0,  0), vec3(0, 0, -1) },
+			{ vec3(0, -1, 0), vec3(1, 0,  0), vec3(0, 0,  1) },
+			{ vec3(0, 0,  1), vec3(1, 0,  0), vec3(0, 1,  0) },
+			{ vec3(0, 0, -1), vec3(-1, 0, 0), vec3(0, 1,  0) }
+		};
+		const vec2 corners[4] = { vec2(-1, -1), vec2(1, -1), vec2(1, 1), vec2(-1, 1) };
+
+		for (const auto &f : faces) {
+			GLuint first = GLuint(mb.vertices.size());
+			for (vec2 c : corners) {
+				mesh_vertex v;
+				v.pos = f[0] + c.x * f[1] + c.y * f[2];
+				v.norm = f[0];
+				v.uv = 0.5f + 0.5f * c;
+				mb.push_vertex(v);
+			}
+			mb.push_indices({ first, first + 1, first + 2, first, first + 2, first + 3 });
+		}
+
+		return mb;
+	}
+
+
+	mesh_builder quad_builder() {
+		mesh_builder mb;
+		const vec2 corners[4] = { vec2(-1, -1), vec2(1, -1), vec2(1, 1), vec2(-1, 1) };
+		for (vec2 c : corners) {
+			mesh_vertex v;
+			v.pos = vec3(c, 0);
+			v.norm = vec3(0, 0, 1);
+			v.uv = 0.5f + 0.5f * c;
+			mb.push_vertex(v);
+		}
+		mb.push_indices({ 0, 1, 2, 0, 2, 3 });
+		return mb;
+	}
+
+
+	const gl_mesh & sphere_mesh(int slices, int stacks) {
+		slices = std::max(slices, 3);
+		stacks = std::max(stacks, 2);
+		return shared_mesh(primitive::sphere, slices, stacks, [=] { return sphere_builder(slices, stacks); });
+	}
+
+	const gl_mesh & cylinder_mesh(int slices) {
+		slices = std::max(slices, 3);
+		return shared_mesh(primitive::cylinder, slices, 0, [=] { return cylinder_builder(slices); });
+	}
+
+	const gl_mesh & cone_mesh(int slices) {
+		slices = std::max(slices, 3);
+		return shared_mesh(primitive::cone, slices, 0, [=] { return cone_builder(slices); });
+	}
+
+	const gl_mesh & cube_mesh() {
+		return shared_mesh(primitive::cube, 0, 0, cube_builder);
+	}
+
+	const gl_mesh & quad_mesh() {
+		return shared_mesh(primitive::quad, 0, 0, quad_builder);
+	}
+
+
+	const gl_mesh_lods & sphere_lods(int slices, int stacks, int level_count) {
+		slices = std::max(slices, 3);
+		stacks = std::max(stacks, 2);
+		auto key = std::make_tuple(primitive::sphere, slices, stacks, level_count);
+		auto it = g_primitive_lods.find(key);
+		if (it == g_primitive_lods.end()) {
+			CGRA_TRACE_ZONE("cgra::sphere_lods build");
+			mesh_builder mb = sphere_builder(slices, stacks);
+
+			// tangents for normal maps, packed, so each level's positions go through its position transform
+			mb.generate_tangents();
+			mb.format = vertex_format::packed;
+			it = g_primitive_lods.emplace(key, build_lods(mb, "sphere", level_count)).first;
+		}
+		return it->second;
+	}
+
+	const triangle_bvh & sphere_bvh(int slices, int stacks) {
+		slices = std::max(slices, 3);
+		stacks = std::max(stacks, 2);
+		auto key = std::make_tuple(primitive::sphere, slices, stacks);
+		auto it = g_primitive_bvhs.find(key);
+		if (it == g_primitive_bvhs.end()) {
+			CGRA_TRACE_ZONE("cgra::sphere_bvh build");
+			it = g_primitive_bvhs.emplace(key, triangle_bvh(sphere_builder(slices, stacks))).first;
+		}
+		return it->second;
+	}
+
+
+	void destroy_primitives() {
+		for (auto &p : g_primitives) p.second.destroy();
+		g_primitives.clear();
+		for (auto &p : g_primitive_lods) p.second.destroy();
+		g_primitive_lods.clear();
+		g_primitive_bvhs.clear();
+	}
+}
@@ -0,0 +1,48 @@
+
+#pragma once
+
+// project
+#include "cgra_bvh.hpp"
+#include "cgra_mesh.hpp"
+#include "cgra_simplify.hpp"
+
+
+namespace cgra {
+
+	// Unit primitives as indexed triangle meshes, with their level of detail as parameters
+
+	// radius of 1 with its poles along y, slices around y and stacks from pole to pole
+	mesh_builder sphere_builder(int slices = 64, int stacks = 64);
+
+	// radius and height of 1 along the z-axis (from z = 0 to 1), with capped ends
+	mesh_builder cylinder_builder(int slices = 20);
+
+	// base with a radius of 1 at z = 0 and its tip at z = 1, with a capped base
+	mesh_builder cone_builder(int slices = 20);
+
+	// from -1 to 1 on every axis, with 4 vertices per face so the normals and uvs are flat
+	mesh_builder cube_builder();
+
+	// from -1 to 1 in xy facing +z, with uvs from 0 to 1 (a fullscreen quad when drawn in clip space)
+	mesh_builder quad_builder();
+
+
+	// Shared gl_meshes of the primitives above. The first call with a set of parameters builds the mesh and
+	// every later call with the same parameters, from any module, returns the same one. They can be drawn
+	// with gl_mesh::draw, or gl_mesh::draw_instanced for many copies placed by the shader
+	const gl_mesh & sphere_mesh(int slices = 64, int stacks = 64);
+	const gl_mesh & cylinder_mesh(int slices = 20);
+	const gl_mesh & cone_mesh(int slices = 20);
+	const gl_mesh & cube_mesh();
+	const gl_mesh & quad_mesh();
+
+	// a shared level of detail chain of the sphere, with tangents and packed vertices (see build_lods)
+	const gl_mesh_lods & sphere_lods(int slices = 64, int stacks = 64, int level_count = 4);
+
+	// a shared BVH over the triangles of the sphere, for picking it
+	const triangle_bvh & sphere_bvh(int slices = 64, int stacks = 64);
+
+	// deletes the gl buffers of every shared primitive and level of detail chain and frees the BVHs,
+	// which are built again if they are asked for after. call it while the gl context is still current
+	void destroy_primitives();
+}
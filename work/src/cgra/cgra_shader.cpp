@@ -1,13 +1,21 @@
 
 // std
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 // project
+#include "cgra_cache.hpp"
 #include "cgra_shader.hpp"
+#include "cgra_trace.hpp"
 #include <opengl.hpp>
 
 
@@ -60,39 +68,117 @@ void printProgramInfoLog(GLuint obj) {
 }
 
 
-namespace cgra {
+namespace {
 
-	void shader_builder::set_shader(GLenum type, const std::string &filename) {
-		std::ifstream fileStream(filename);
+	// on-disk format of a cached program binary
+	struct program_binary_header {
+		char magic[4]; // "CGPB"
+		uint32_t version;
+		uint64_t driver_hash; // hash of the vendor/renderer/version strings
+		uint64_t source_hash; // hash of every stage's final source
+		uint32_t format; // GLenum binary format from glGetProgramBinary
+		uint32_t length; // size in bytes of the binary that follows
+	};
 
-		if (!fileStream) {
-			std::cerr << "Error: Could not locate and open file " << filename << std::endl;
-			throw std::runtime_error("Error: Could not locate and open file " + filename);
-		}
+	constexpr uint32_t program_binary_version = 1;
 
-		std::stringstream buffer;
-		buffer << fileStream.rdbuf();
+	cgra::program_cache_stats g_stats;
+	std::unordered_map<GLuint, std::unordered_map<std::string, GLint>> g_uniform_locations;
+	bool g_cache_enabled = !std::getenv("CGRA_NO_PROGRAM_CACHE");
 
-		try {
-			set_shader_source(type, buffer.str());
-		}
-		catch (shader_compile_error &e) {
-			std::cerr << "Error: Could not compile " << filename << std::endl;
-			throw e;
+
+	// true if the driver can give us program binaries
+	bool binaries_supported() {
+		static int supported = -1;
+		if (supported < 0) {
+			GLint formats = 0;
+			if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			supported = formats > 0;
 		}
+		return supported;
 	}
 
 
-	void shader_builder::set_shader_source(GLenum type, const std::string &source) {
+	// true if the driver claims to accept binaries of the given format
+	// (glProgramBinary raises GL_INVALID_ENUM otherwise, which our debug callback treats as fatal)
+	bool format_supported(GLenum format) {
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+		std::vector<GLint> formats(std::max(count, 1));
+		glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+		return std::find(formats.begin(), formats.begin() + count, GLint(format)) != formats.begin() + count;
+	}
 
-		// same as GLint shader = glCreateShader(type);
-		gl_object shader = gl_object::gen_shader(type);
 
-		// cgra specific extra (allows different shaders to be defined in a single source)
-		// Start of CGRA addition
-		//
-		const auto get_define = [](GLenum stype) {
-			switch (stype) {
+	// binaries are only valid for the exact driver that produced them
+	uint64_t driver_hash() {
+		static uint64_t hash = [] {
+			uint64_t h = cgra::hash_bytes(nullptr, 0);
+			for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION }) {
+				const char *str = reinterpret_cast<const char *>(glGetString(name));
+				if (str) h = cgra::hash_string(str, h);
+			}
+			return h;
+		}();
+		return hash;
+	}
+
+
+	bool load_program_binary(GLuint program, const std::string &filename, uint64_t source_hash) {
+		std::vector<char> data;
+		if (!cgra::read_binary_file(filename, data) || data.size() < sizeof(program_binary_header)) return false;
+
+		program_binary_header header;
+		std::memcpy(&header, data.data(), sizeof(header));
+		if (std::memcmp(header.magic, "CGPB", 4) != 0
+			|| header.version != program_binary_version
+			|| header.driver_hash != driver_hash()
+			|| header.source_hash != source_hash
+			|| data.size() != sizeof(header) + header.length
+			|| !format_supported(header.format)
+		) return false;
+
+		glProgramBinary(program, header.format, data.data() + sizeof(header), header.length);
+
+		// the driver may still reject the binary (eg. after an update), in which case we recompile
+		GLint link_status = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+		return link_status;
+	}
+
+
+	void save_program_binary(GLuint program, const std::string &filename, uint64_t source_hash) {
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) return;
+
+		std::vector<char> data(sizeof(program_binary_header) + length);
+		GLenum format = 0;
+		GLsizei written = 0;
+		glGetProgramBinary(program, length, &written, &format, data.data() + sizeof(program_binary_header));
+		if (written <= 0) return;
+
+		program_binary_header header;
+		std::memcpy(header.magic, "CGPB", 4);
+		header.version = program_binary_version;
+		header.driver_hash = driver_hash();
+		header.source_hash = source_hash;
+		header.format = format;
+		header.length = uint32_t(written);
+		std::memcpy(data.data(), &header, sizeof(header));
+
+		cgra::write_binary_file(filename, data.data(), sizeof(header) + written);
+	}
+}
+
+
+namespace cgra {
+
+	namespace {
+
+		const char * stage_define(GLenum type) {
+			switch (type) {
 			case GL_VERTEX_SHADER:
 				return "_VERTEX_";
 			case GL_GEOMETRY_SHADER:
@@ -106,42 +192,245 @@ namespace cgra {
 			default:
 				return "_INVALID_SHADER_TYPE_";
 			}
-		};
+		}
+
 
+		// returns the file named by an #include "file" line, or an empty string
+		std::string parse_include(const std::string &line) {
+			size_t first = line.find_first_not_of(" \t");
+			if (first == std::string::npos || line.compare(first, 8, "#include") != 0) return "";
+			size_t open = line.find('"', first + 8);
+			size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if (close == std::string::npos) return "";
+			return line.substr(open + 1, close - open - 1);
+		}
+
+
+		// copies the remaining lines of in to out, replacing #include "file" lines with
+		// the contents of that file (relative to the including file). files holds every
+		// file in the stage, its index is used as the #line source string number so
+		// compile errors can be traced back to the right file
+		void resolve_includes(std::istream &in, int line_number, int file_index, std::vector<std::string> &files, std::ostream &out) {
+			std::string line;
+			while (std::getline(in, line)) {
+				line_number++;
+				std::string include = parse_include(line);
+				if (include.empty()) {
+					out << line << '\n';
+					continue;
+				}
+
+				std::filesystem::path path = std::filesystem::path(files[file_index]).parent_path() / include;
+				std::string filename = path.lexically_normal().string();
+
+				// every file is included at most once per stage
+				if (std::find(files.begin(), files.end(), filename) != files.end()) {
+					out << '\n';
+					continue;
+				}
+
+				std::ifstream file(filename);
+				if (!file) {
+					std::cerr << "Error: Could not locate and open included file " << filename << std::endl;
+					throw std::runtime_error("Error: Could not locate and open included file " + filename);
+				}
+
+				files.push_back(filename);
+				int include_index = int(files.size()) - 1;
+				out << "#line 1 " << include_index << '\n';
+				resolve_includes(file, 0, include_index, files, out);
+				out << "#line " << (line_number + 1) << ' ' << file_index << '\n';
+			}
+		}
+
+
+		uint64_t hash_sources(const std::map<GLenum, std::string> &sources, uint64_t seed) {
+			uint64_t hash = seed;
+			for (auto &source_pair : sources) {
+				hash = hash_bytes(&source_pair.first, sizeof(source_pair.first), hash);
+				hash = hash_string(source_pair.second, hash);
+			}
+			return hash;
+		}
+
+
+		// programs built through shader_builder::build(defines), keyed on their final source
+		std::unordered_map<uint64_t, GLuint> g_permutations;
+	}
+
+
+	void shader_builder::set_shader(GLenum type, const std::string &filename) {
+		std::ifstream fileStream(filename);
+
+		if (!fileStream) {
+			std::cerr << "Error: Could not locate and open file " << filename << std::endl;
+			throw std::runtime_error("Error: Could not locate and open file " + filename);
+		}
+
+		std::stringstream buffer;
+		buffer << fileStream.rdbuf();
+
+		set_stage(type, buffer.str(), filename);
+	}
+
+
+	void shader_builder::set_shader_source(GLenum type, const std::string &source) {
+		set_stage(type, source, "");
+	}
+
+
+	void shader_builder::set_stage(GLenum type, const std::string &source, const std::string &filename) {
+		stage_source stage;
+		stage.filename = filename;
+		stage.source = source;
+		stage.files.push_back(filename);
+
+		// cgra specific extra (allows different shaders to be defined in a single source)
+		// the stage and permutation defines are inserted after the #version line in build()
 		std::istringstream iss(source);
-		std::ostringstream oss;
+		std::ostringstream header;
 		while (iss) {
 			std::string line;
 			std::getline(iss, line);
-			oss << line << std::endl;
+			header << line << std::endl;
+			stage.body_line++;
 			if (line.find("#version") < line.find("//"))
 				break;
 		}
-		oss << "#define " << get_define(type) << std::endl;
-		oss << iss.rdbuf();
-		std::string final_source = oss.str();
-		//
-		// End of CGRA addition
+		stage.header = header.str();
 
-		// upload and compile the shader
-		const char *text_c = final_source.c_str();
-		glShaderSource(shader, 1, &text_c, nullptr);
-		glCompileShader(shader);
+		std::ostringstream body;
+		resolve_includes(iss, stage.body_line, 0, stage.files, body);
+		stage.body = body.str();
+		stage.body_line++;
+
+		// compilation is deferred to build() so cached programs never compile
+		m_stages[type] = std::move(stage);
+	}
 
-		// check compilation status
-		GLint compile_status;
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
-		printShaderInfoLog(shader); // print warnings and errors
-		if (!compile_status) throw shader_compile_error();
 
-		m_shaders[type] = std::make_shared<gl_object>(std::move(shader));
+	void shader_builder::reload() {
+		// copy, as set_stage replaces the stages
+		std::map<GLenum, stage_source> stages = m_stages;
+		for (auto &stage_pair : stages) {
+			if (stage_pair.second.filename.empty())
+				set_stage(stage_pair.first, stage_pair.second.source, ""); // re-resolves includes
+			else
+				set_shader(stage_pair.first, stage_pair.second.filename);
+		}
+	}
+
+
+	std::vector<std::string> shader_builder::dependencies() const {
+		std::vector<std::string> files;
+		for (auto &stage_pair : m_stages) {
+			for (const std::string &file : stage_pair.second.files) {
+				if (!file.empty() && std::find(files.begin(), files.end(), file) == files.end())
+					files.push_back(file);
+			}
+		}
+		return files;
+	}
+
+
+	std::map<GLenum, std::string> shader_builder::assemble(const shader_defines &defines) const {
+		std::map<GLenum, std::string> sources;
+		for (auto &stage_pair : m_stages) {
+			const stage_source &stage = stage_pair.second;
+			std::ostringstream oss;
+			oss << stage.header;
+			oss << "#define " << stage_define(stage_pair.first) << '\n';
+			for (auto &define : defines) {
+				oss << "#define " << define.first << ' ' << define.second << '\n';
+			}
+			oss << "#line " << stage.body_line << " 0\n";
+			oss << stage.body;
+			sources[stage_pair.first] = oss.str();
+		}
+		return sources;
+	}
+
+
+	void shader_builder::compile_and_link(GLuint program, const std::map<GLenum, std::string> &sources) const {
+		std::vector<gl_object> shaders;
+
+		for (auto &source_pair : sources) {
+			CGRA_TRACE_ZONE("shader_builder::compile");
+
+			// same as GLint shader = glCreateShader(type);
+			gl_object shader = gl_object::gen_shader(source_pair.first);
+
+			// upload and compile the shader
+			const char *text_c = source_pair.second.c_str();
+			glShaderSource(shader, 1, &text_c, nullptr);
+			glCompileShader(shader);
+
+			// check compilation status
+			GLint compile_status;
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
+			printShaderInfoLog(shader); // print warnings and errors
+			if (!compile_status) {
+				// errors are reported as <source string>(<line>), list which file is which
+				const std::vector<std::string> &files = m_stages.at(source_pair.first).files;
+				for (size_t i = 0; i < files.size(); i++) {
+					std::cerr << "Error: Could not compile " << i << " = " << (files[i].empty() ? "<string>" : files[i]) << std::endl;
+				}
+				throw shader_compile_error();
+			}
+
+			shaders.push_back(std::move(shader));
+		}
+
+		// attach shaders
+		for (auto &shader : shaders) {
+			glAttachShader(program, shader);
+		}
+
+		// link the program (asking the driver to keep the binary around for the cache)
+		if (g_cache_enabled && binaries_supported())
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(program);
+
+		// the linked program no longer needs the shader objects
+		for (auto &shader : shaders) {
+			glDetachShader(program, shader);
+		}
+
+		// check link status
+		GLint link_status;
+		glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+		printProgramInfoLog(program); // print warnings and errors
+		if (!link_status) throw shader_link_error();
 	}
 
 
 	GLuint shader_builder::build(GLuint program) {
+		return build(shader_defines(), program);
+	}
+
+
+	GLuint shader_builder::build(const shader_defines &defines) {
+		uint64_t key = hash_sources(assemble(defines), hash_bytes(nullptr, 0));
+		auto it = g_permutations.find(key);
+		if (it != g_permutations.end()) return it->second;
+
+		GLuint program = build(defines, 0);
+		g_permutations[key] = program;
+		return program;
+	}
+
+
+	GLuint shader_builder::build(const shader_defines &defines, GLuint program) {
+		CGRA_TRACE_ZONE("shader_builder::build");
+		auto start = std::chrono::steady_clock::now();
+
+		std::map<GLenum, std::string> sources = assemble(defines);
 
 		// if the program exists get attached shaders and detach them
+		bool created = !program;
 		if (program) {
+			invalidate_uniform_locations(program);
+
 			int shader_count = 0;
 			glGetProgramiv(program, GL_ATTACHED_SHADERS, &shader_count);
 
@@ -155,24 +444,110 @@ namespace cgra {
 			}
 		}
 		else {
+			// the driver reuses the ids of deleted programs, so forget anything cached for a previous owner
 			program = glCreateProgram();
+			invalidate_uniform_locations(program);
 		}
 
-		// attach shaders
-		for (auto &shader_pair : m_shaders) {
-			glAttachShader(program, *(shader_pair.second));
+		// try the binary cache first (keyed on the exact source of every stage)
+		bool use_cache = g_cache_enabled && binaries_supported();
+		uint64_t source_hash = 0;
+		std::string cache_file;
+		bool cached = false;
+		if (use_cache) {
+			source_hash = hash_sources(sources, driver_hash());
+			cache_file = cache_path("programs", source_hash, ".bin");
+			CGRA_TRACE_ZONE("shader_builder::load_binary");
+			cached = load_program_binary(program, cache_file, source_hash);
 		}
 
-		// link the program
-		glLinkProgram(program);
+		if (cached) {
+			g_stats.hits++;
+		}
+		else {
+			try {
+				compile_and_link(program, sources);
+			}
+			catch (...) {
+				if (created) delete_program(program);
+				throw;
+			}
+			if (use_cache) save_program_binary(program, cache_file, source_hash);
+			g_stats.misses++;
+		}
 
-		// check link status
-		GLint link_status;
-		glGetProgramiv(program, GL_LINK_STATUS, &link_status);
-		printProgramInfoLog(program); // print warnings and errors
-		if (!link_status) throw shader_link_error();
+		// a relinked permutation is now keyed on its new source
+		if (!created) {
+			for (auto it = g_permutations.begin(); it != g_permutations.end(); ++it) {
+				if (it->second == program) {
+					g_permutations.erase(it);
+					g_permutations[hash_sources(sources, hash_bytes(nullptr, 0))] = program;
+					break;
+				}
+			}
+		}
 
+		g_stats.build_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 		return program;
 	}
 
-}
\ No newline at end of file
+
+	void shader_builder::validate(const shader_defines &defines) const {
+		std::map<GLenum, std::string> sources = assemble(defines);
+		GLuint program = glCreateProgram();
+		try {
+			compile_and_link(program, sources);
+		}
+		catch (...) {
+			delete_program(program);
+			throw;
+		}
+
+		// keep the result, so building the same source afterwards skips compilation
+		if (g_cache_enabled && binaries_supported()) {
+			uint64_t source_hash = hash_sources(sources, driver_hash());
+			save_program_binary(program, cache_path("programs", source_hash, ".bin"), source_hash);
+		}
+		delete_program(program);
+	}
+
+
+	const program_cache_stats & program_cache_statistics() {
+		return g_stats;
+	}
+
+
+	void set_program_cache_enabled(bool enabled) {
+		g_cache_enabled = enabled;
+	}
+
+
+	GLint uniform_location(GLuint program, const std::string &name) {
+		auto &locations = g_uniform_locations[program];
+		auto it = locations.find(name);
+		if (it != locations.end()) return it->second;
+		GLint location = glGetUniformLocation(program, name.c_str());
+		locations.emplace(name, location);
+		return location;
+	}
+
+
+	void invalidate_uniform_locations(GLuint program) {
+		g_uniform_locations.erase(program);
+	}
+
+
+	void delete_program(GLuint program) {
+		if (!program) return;
+		invalidate_uniform_locations(program);
+
+		// a cached permutation must not be handed out once it is gone
+		for (auto it = g_permutations.begin(); it != g_permutations.end(); ++it) {
+			if (it->second == program) {
+				g_permutations.erase(it);
+				break;
+			}
+		}
+		glDeleteProgram(program);
+	}
+}
@@ -1,10 +1,10 @@
-
 #pragma once
 
 // std
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 // project
 #include <opengl.hpp>
@@ -12,16 +12,85 @@
 
 namespace cgra {
 
+	// preprocessor defines used to build a permutation of a shader, eg. {{"MAX_BLOBS", "64"}}
+	using shader_defines = std::map<std::string, std::string>;
+
+
+	// Shader builder object used to compile and link shader programs.
+	// Sources are only compiled when build() is called. If the driver supports
+	// program binaries, linked programs are cached on disk (keyed on the final
+	// source and the driver) so later builds can skip compilation entirely.
+	// Sources can #include "file" (relative to the including file, each file is
+	// included at most once per stage), and can be built as specialised
+	// permutations by passing a set of defines to build().
 	class shader_builder {
 	private:
-		std::map<GLenum, std::shared_ptr<gl_object>> m_shaders;
+		struct stage_source {
+			std::string filename; // empty if set from a string
+			std::string source; // the source as given
+			std::string header; // up to and including the #version line
+			std::string body; // everything after the #version line, with includes resolved
+			int body_line = 0; // line number of the first line of body
+			std::vector<std::string> files; // #line source string numbers (0 is the stage itself)
+		};
+
+		std::map<GLenum, stage_source> m_stages;
+
+		void set_stage(GLenum type, const std::string &source, const std::string &filename);
+		std::map<GLenum, std::string> assemble(const shader_defines &defines) const;
+		void compile_and_link(GLuint program, const std::map<GLenum, std::string> &sources) const;
 
 	public:
 		shader_builder() { }
 		void set_shader(GLenum type, const std::string &filename);
 		void set_shader_source(GLenum type, const std::string &shadersource);
 
+		// re-reads every stage that was set from a file (and all included files)
+		void reload();
+
+		// the files this builder reads its sources from, including included files
+		std::vector<std::string> dependencies() const;
+
+		// builds a new program, or relinks into an existing one (which also
+		// invalidates its cached uniform locations)
 		GLuint build(GLuint program = 0);
+
+		// builds the permutation with the given defines (inserted after the #version
+		// line). permutations are cached, so building the same source and defines again
+		// returns the same program. these programs are owned by the cache
+		GLuint build(const shader_defines &defines);
+
+		// relinks an existing program as the permutation with the given defines
+		GLuint build(const shader_defines &defines, GLuint program);
+
+		// compiles and links the permutation into a temporary program, throwing on
+		// errors, without touching any existing program
+		void validate(const shader_defines &defines = shader_defines()) const;
 	};
 
-}
\ No newline at end of file
+
+	// cached glGetUniformLocation, avoiding a driver round trip (and string
+	// lookup inside the driver) for every uniform set each frame
+	GLint uniform_location(GLuint program, const std::string &name);
+
+	// forgets the cached locations for a program, called whenever it is created or relinked
+	void invalidate_uniform_locations(GLuint program);
+
+	// deletes a program and forgets its cached uniform locations (and permutation), so a later
+	// program given the same id by the driver does not see them. use instead of glDeleteProgram
+	void delete_program(GLuint program);
+
+
+	// statistics about the program binary cache for this run
+	struct program_cache_stats {
+		int hits = 0; // programs loaded from a cached binary
+		int misses = 0; // programs compiled from source
+		double build_ms = 0; // total time spent in shader_builder::build
+	};
+
+	const program_cache_stats & program_cache_statistics();
+
+	// the binary cache is enabled by default, it can be turned off for debugging
+	// drivers (or with the CGRA_NO_PROGRAM_CACHE environment variable)
+	void set_program_cache_enabled(bool enabled);
+}
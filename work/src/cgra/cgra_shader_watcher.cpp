@@ -0,0 +1,197 @@
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+// linux
+#ifdef __linux__
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// project
+#include "cgra_shader_watcher.hpp"
+#include "cgra_trace.hpp"
+
+
+namespace cgra {
+
+	namespace {
+
+		struct watched_program {
+			GLuint program;
+			shader_builder builder;
+			shader_defines defines;
+			std::function<void(GLuint)> on_reload;
+			std::vector<std::string> files; // normalised paths
+		};
+
+		std::vector<watched_program> g_programs;
+
+		std::string normalise(const std::string &filename) {
+			return std::filesystem::path(filename).lexically_normal().string();
+		}
+
+#ifdef __linux__
+
+		// a single inotify instance watching the directory of every source file
+		// (editors often save by renaming a temporary file, so watching the
+		// files themselves would lose the watch after the first save)
+		int g_inotify = -1;
+		std::map<int, std::string> g_directories; // watch descriptor -> directory
+
+		void watch_directories(const std::vector<std::string> &files) {
+			if (g_inotify < 0) {
+				g_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+				if (g_inotify < 0) {
+					std::cerr << "Warning: Could not initialise inotify, shader hot-reload disabled" << std::endl;
+					return;
+				}
+			}
+			for (const std::string &file : files) {
+				std::string dir = std::filesystem::path(file).parent_path().string();
+				int wd = inotify_add_watch(g_inotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+				if (wd < 0) std::cerr << "Warning: Could not watch " << dir << std::endl;
+				else g_directories[wd] = dir;
+			}
+		}
+
+		std::set<std::string> changed_files() {
+			std::set<std::string> changed;
+			if (g_inotify < 0) return changed;
+
+			alignas(inotify_event) char buffer[4096];
+			while (true) {
+				ssize_t length = read(g_inotify, buffer, sizeof(buffer));
+				if (length <= 0) break; // EAGAIN, nothing left to read
+
+				for (char *p = buffer; p < buffer + length; ) {
+					const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+					auto it = g_directories.find(event->wd);
+					if (event->len > 0 && it != g_directories.end())
+						changed.insert(normalise(it->second + "/" + event->name));
+					p += sizeof(inotify_event) + event->len;
+				}
+			}
+			return changed;
+		}
+
+#else
+
+		// no inotify, fall back to checking modification times a few times a second
+		std::map<std::string, std::filesystem::file_time_type> g_write_times;
+		std::chrono::steady_clock::time_point g_last_check;
+
+		std::filesystem::file_time_type write_time(const std::string &file) {
+			std::error_code ec;
+			return std::filesystem::last_write_time(file, ec);
+		}
+
+		void watch_directories(const std::vector<std::string> &files) {
+			for (const std::string &file : files) {
+				if (!g_write_times.count(file)) g_write_times[file] = write_time(file);
+			}
+		}
+
+		std::set<std::string> changed_files() {
+			std::set<std::string> changed;
+			auto now = std::chrono::steady_clock::now();
+			if (now - g_last_check < std::chrono::milliseconds(250)) return changed;
+			g_last_check = now;
+
+			for (auto &file_pair : g_write_times) {
+				auto time = write_time(file_pair.first);
+				if (time != file_pair.second) {
+					file_pair.second = time;
+					changed.insert(file_pair.first);
+				}
+			}
+			return changed;
+		}
+
+#endif
+
+		std::vector<std::string> normalised_dependencies(const shader_builder &builder) {
+			std::vector<std::string> files = builder.dependencies();
+			for (std::string &file : files) file = normalise(file);
+			return files;
+		}
+
+		bool rebuild(watched_program &w) {
+			CGRA_TRACE_ZONE("shader_watcher::rebuild");
+
+			// link into a scratch program first, so a broken shader never replaces
+			// a working one. the relink below then loads the binary cached by this build
+			shader_builder candidate = w.builder;
+			try {
+				candidate.reload();
+				candidate.validate(w.defines);
+				candidate.build(w.defines, w.program);
+			}
+			catch (std::exception &e) {
+				std::cerr << "Error: Shader reload failed, keeping the previous program (" << e.what() << ")" << std::endl;
+				return false;
+			}
+
+			w.builder = candidate;
+			w.files = normalised_dependencies(w.builder);
+			watch_directories(w.files);
+
+			// restore uniforms that are only set once
+			if (w.on_reload) {
+				GLint last_program = 0;
+				glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
+				glUseProgram(w.program);
+				w.on_reload(w.program);
+				glUseProgram(last_program);
+			}
+			return true;
+		}
+	}
+
+
+	namespace shader_watcher {
+
+		void watch(GLuint program, const shader_builder &builder, std::function<void(GLuint)> on_reload) {
+			watch(program, builder, shader_defines(), std::move(on_reload));
+		}
+
+
+		void watch(GLuint program, const shader_builder &builder, const shader_defines &defines, std::function<void(GLuint)> on_reload) {
+			unwatch(program);
+			watched_program w{ program, builder, defines, std::move(on_reload), normalised_dependencies(builder) };
+			watch_directories(w.files);
+			g_programs.push_back(std::move(w));
+		}
+
+
+		void unwatch(GLuint program) {
+			g_programs.erase(std::remove_if(g_programs.begin(), g_programs.end(), [=](const watched_program &w) {
+				return w.program == program;
+			}), g_programs.end());
+		}
+
+
+		int poll() {
+			std::set<std::string> changed = changed_files();
+			if (changed.empty()) return 0;
+
+			int rebuilt = 0;
+			for (watched_program &w : g_programs) {
+				bool affected = std::any_of(w.files.begin(), w.files.end(), [&](const std::string &file) {
+					return changed.count(file) > 0;
+				});
+				if (affected && rebuild(w)) rebuilt++;
+			}
+			if (rebuilt) std::cout << "Reloaded " << rebuilt << " shader program(s)" << std::endl;
+			return rebuilt;
+		}
+	}
+}
@@ -0,0 +1,32 @@
+
+#pragma once
+
+// std
+#include <functional>
+
+// project
+#include "cgra_shader.hpp"
+#include <opengl.hpp>
+
+
+namespace cgra {
+	namespace shader_watcher {
+
+		// watches the source files of a program, and relinks it in place when
+		// any of them change. uniform values are lost when a program is relinked,
+		// so anything set once (eg. sampler units) should be restored in on_reload
+		// (which is called with the program bound)
+		void watch(GLuint program, const shader_builder &builder, std::function<void(GLuint)> on_reload = nullptr);
+
+		// as above, for a program built as a permutation with the given defines
+		void watch(GLuint program, const shader_builder &builder, const shader_defines &defines, std::function<void(GLuint)> on_reload = nullptr);
+
+		// stops watching a program (eg. before deleting it)
+		void unwatch(GLuint program);
+
+		// checks for modified files and rebuilds the affected programs, call once
+		// per frame. a program that fails to compile or link keeps its old binary
+		// returns the number of programs that were rebuilt
+		int poll();
+	}
+}
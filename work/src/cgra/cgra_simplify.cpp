@@ -0,0 +1,582 @@
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <queue>
+#include <stdexcept>
+
+// project
+#include "cgra_primitives.hpp"
+#include "cgra_simplify.hpp"
+#include "cgra_trace.hpp"
+#include "cgra_wavefront.hpp"
+
+
+using namespace glm;
+
+namespace cgra {
+
+	namespace {
+
+		// border and seam edges add a plane through them, perpendicular to the surface, this many times
+		// stronger than the surface planes so they keep their shape
+		const double g_border_weight = 10.0;
+
+		// a collapse is not allowed to turn a triangle's normal by more than about 80 degrees
+		const float g_min_normal_dot = 0.2f;
+
+		const uint32_t g_none = ~uint32_t(0);
+
+		// sum of squared distances to a set of weighted planes, as the symmetric 4x4 matrix
+		// of Garland and Heckbert, with the total weight so the error can be given as a distance
+		struct quadric {
+			double a2 = 0, ab = 0, ac = 0, ad = 0;
+			double b2 = 0, bc = 0, bd = 0;
+			double c2 = 0, cd = 0;
+			double d2 = 0;
+			double weight = 0;
+
+			void add_plane(dvec3 n, double d, double w) {
+				a2 += w * n.x * n.x; ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+				b2 += w * n.y * n.y; bc += w * n.y * n.z; bd += w * n.y * d;
+				c2 += w * n.z * n.z; cd += w * n.z * d;
+				d2 += w * d * d;
+				weight += w;
+			}
+
+			quadric & operator+=(const quadric &q) {
+				a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+				b2 += q.b2; bc += q.bc; bd += q.bd;
+				c2 += q.c2; cd += q.cd;
+				d2 += q.d2;
+				weight += q.weight;
+				return *this;
+			}
+
+			// weighted sum of squared distances from p to the planes
+			double error(dvec3 p) const {
+				double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+					+ b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+					+ c2 * p.z * p.z + 2 * cd * p.z
+					+ d2;
+				return std::max(e, 0.0);
+			}
+
+			// the weighted mean of the squared distances, roughly the square of how far p is from the planes
+			double distance2(dvec3 p) const {
+				return weight > 0 ? error(p) / weight : 0;
+			}
+		};
+
+		struct collapse {
+			double cost; // the quadric error, which grows with the area a position stands in for
+			uint32_t from, to;
+			uint32_t version;
+			bool operator<(const collapse &c) const { return cost > c.cost; } // smallest cost first
+		};
+
+		// an edge from one position, with the triangles on it
+		struct edge {
+			uint32_t other;
+			uint32_t triangles[2];
+			int count;
+		};
+
+		class simplifier {
+		private:
+			const mesh_builder &m_mb;
+			std::vector<uint32_t> m_position; // of each vertex, with identical positions welded
+			std::vector<vec3> m_positions;
+			std::vector<quadric> m_quadrics; // of each position
+			std::vector<std::vector<uint32_t>> m_triangles; // around each position, pruned as they die
+			std::vector<uint32_t> m_indices; // vertices of each triangle
+			std::vector<uint8_t> m_alive;
+			std::vector<uint32_t> m_version; // of each position, bumped when its best collapse is outdated
+			std::priority_queue<collapse> m_queue;
+			size_t m_alive_count = 0;
+			double m_max_distance2 = DBL_MAX; // collapses moving the surface further than this are never queued
+
+			uint32_t pos(uint32_t t, int k) const { return m_position[m_indices[t * 3 + k]]; }
+
+			int corner(uint32_t t, uint32_t p) const {
+				for (int k = 0; k < 3; k++) if (pos(t, k) == p) return k;
+				return -1;
+			}
+
+			const std::vector<uint32_t> & triangles(uint32_t p) {
+				std::vector<uint32_t> &ts = m_triangles[p];
+				ts.erase(std::remove_if(ts.begin(), ts.end(), [&](uint32_t t) { return !m_alive[t]; }), ts.end());
+				return ts;
+			}
+
+			// the edges around p, each with up to two of its triangles (count says how many there really are)
+			void edges(uint32_t p, std::vector<edge> &out) {
+				out.clear();
+				for (uint32_t t : triangles(p)) {
+					int k = corner(t, p);
+					for (int j = 1; j <= 2; j++) {
+						uint32_t q = pos(t, (k + j) % 3);
+						auto it = std::find_if(out.begin(), out.end(), [&](const edge &e) { return e.other == q; });
+						if (it == out.end()) {
+							out.push_back({ q, { t, g_none }, 1 });
+						} else {
+							if (it->count < 2) it->triangles[it->count] = t;
+							it->count++;
+						}
+					}
+				}
+			}
+
+			// whether the two triangles on an edge from p to q use different vertices at either end
+			bool is_seam(const edge &e, uint32_t p) const {
+				uint32_t t0 = e.triangles[0], t1 = e.triangles[1];
+				return m_indices[t0 * 3 + corner(t0, p)] != m_indices[t1 * 3 + corner(t1, p)]
+					|| m_indices[t0 * 3 + corner(t0, e.other)] != m_indices[t1 * 3 + corner(t1, e.other)];
+			}
+
+			bool is_special(const edge &e, uint32_t p) const {
+				return e.count != 2 || is_seam(e, p);
+			}
+
+			void add_border_planes() {
+				std::vector<edge> es;
+				for (uint32_t p = 0; p < m_positions.size(); p++) {
+					edges(p, es);
+					for (const edge &e : es) {
+						if (!is_special(e, p)) continue;
+						dvec3 a = m_positions[p], b = m_positions[e.other];
+						for (int i = 0; i < std::min(e.count, 2); i++) {
+							uint32_t t = e.triangles[i];
+							dvec3 n = cross(dvec3(m_positions[pos(t, 1)]) - dvec3(m_positions[pos(t, 0)]), dvec3(m_positions[pos(t, 2)]) - dvec3(m_positions[pos(t, 0)]));
+							dvec3 side = cross(b - a, n);
+							double l = length(side);
+							if (l == 0) continue;
+							side /= l;
+							// each end of the edge gets it, so the edge's own planes are only added to p
+							m_quadrics[p].add_plane(side, -dot(side, a), g_border_weight * dot(b - a, b - a));
+						}
+					}
+				}
+			}
+
+			// the cheapest allowed collapse of p onto one of its neighbours within the error limit, or to == g_none
+			collapse best_collapse(uint32_t p) {
+				collapse best = { 0, p, g_none, m_version[p] };
+				std::vector<edge> es;
+				edges(p, es);
+
+				// on a border or seam p can only slide along it, and where they meet or branch it can't move
+				int special = 0;
+				for (const edge &e : es) if (is_special(e, p)) special++;
+				if (special != 0 && special != 2) return best;
+
+				std::vector<edge> other_edges;
+				for (const edge &e : es) {
+					if (special && !is_special(e, p)) continue;
+					if (e.count > 2) continue;
+
+					// the only neighbours p and q share are across the triangles on the edge, or the surface would fold
+					edges(e.other, other_edges);
+					int shared = 0;
+					for (const edge &oe : other_edges) {
+						if (oe.other != p && std::any_of(es.begin(), es.end(), [&](const edge &pe) { return pe.other == oe.other; })) shared++;
+					}
+					if (shared != e.count) continue;
+
+					quadric q = m_quadrics[p];
+					q += m_quadrics[e.other];
+					double cost = q.error(m_positions[e.other]);
+					if (best.to != g_none && cost >= best.cost) continue;
+					double distance2 = q.distance2(m_positions[e.other]);
+					if (distance2 > m_max_distance2 || flips(p, e.other)) continue;
+					best.cost = cost;
+					best.to = e.other;
+				}
+				return best;
+			}
+
+			// whether moving p onto q turns any triangle around p over
+			bool flips(uint32_t p, uint32_t q) {
+				for (uint32_t t : triangles(p)) {
+					if (corner(t, q) >= 0) continue;
+					vec3 before[3], after[3];
+					for (int k = 0; k < 3; k++) {
+						before[k] = m_positions[pos(t, k)];
+						after[k] = pos(t, k) == p ? m_positions[q] : before[k];
+					}
+					vec3 n0 = cross(before[1] - before[0], before[2] - before[0]);
+					vec3 n1 = cross(after[1] - after[0], after[2] - after[0]);
+					float l0 = length(n0), l1 = length(n1);
+					if (l1 == 0) return true;
+					if (l0 > 0 && dot(n0, n1) < g_min_normal_dot * l0 * l1) return true;
+				}
+				return false;
+			}
+
+			void push(uint32_t p) {
+				collapse c = best_collapse(p);
+				if (c.to != g_none) m_queue.push(c);
+			}
+
+			// moves position p onto q, keeping q's vertices and removing the triangles on the edge
+			void apply(uint32_t p, uint32_t q) {
+				const std::vector<uint32_t> &ps = triangles(p);
+
+				// each vertex of p becomes the vertex of q across one of the removed triangles, the one whose
+				// attributes are closest, so a seam stays on its own side
+				auto replacement = [&](uint32_t v) {
+					uint32_t best = g_none;
+					float best_distance = 0;
+					for (uint32_t t : ps) {
+						int kq = corner(t, q);
+						if (kq < 0) continue;
+						uint32_t w = m_indices[t * 3 + kq];
+						const mesh_vertex &a = m_mb.vertices[v], &b = m_mb.vertices[w];
+						float d = (m_indices[t * 3 + corner(t, p)] == v ? 0.0f : 1.0f) + distance(a.uv, b.uv) + distance(a.norm, b.norm);
+						if (best == g_none || d < best_distance) {
+							best = w;
+							best_distance = d;
+						}
+					}
+					return best;
+				};
+
+				std::vector<std::pair<uint32_t, uint32_t>> remap;
+				for (uint32_t t : ps) {
+					uint32_t &v = m_indices[t * 3 + corner(t, p)];
+					auto it = std::find_if(remap.begin(), remap.end(), [&](const std::pair<uint32_t, uint32_t> &r) { return r.first == v; });
+					if (it == remap.end()) {
+						remap.emplace_back(v, replacement(v));
+						it = remap.end() - 1;
+					}
+					if (corner(t, q) >= 0) {
+						m_alive[t] = 0;
+						m_alive_count--;
+					}
+				}
+				for (uint32_t t : ps) {
+					if (!m_alive[t]) continue;
+					uint32_t &v = m_indices[t * 3 + corner(t, p)];
+					v = std::find_if(remap.begin(), remap.end(), [&](const std::pair<uint32_t, uint32_t> &r) { return r.first == v; })->second;
+					m_triangles[q].push_back(t);
+				}
+				m_triangles[p].clear();
+				m_quadrics[q] += m_quadrics[p];
+				m_version[p]++;
+			}
+
+		public:
+			simplifier(const mesh_builder &mb) : m_mb(mb) {
+				// weld identical positions, so seams are edges between triangles with different vertices
+				std::vector<uint32_t> order(mb.vertices.size());
+				for (uint32_t v = 0; v < order.size(); v++) order[v] = v;
+				auto less = [&](uint32_t a, uint32_t b) {
+					const vec3 &pa = mb.vertices[a].pos, &pb = mb.vertices[b].pos;
+					return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+				};
+				std::sort(order.begin(), order.end(), less);
+				m_position.resize(mb.vertices.size());
+				for (size_t i = 0; i < order.size(); i++) {
+					if (i == 0 || less(order[i - 1], order[i])) m_positions.push_back(mb.vertices[order[i]].pos);
+					m_position[order[i]] = uint32_t(m_positions.size() - 1);
+				}
+
+				m_quadrics.resize(m_positions.size());
+				m_triangles.resize(m_positions.size());
+				m_version.resize(m_positions.size(), 0);
+
+				// degenerate triangles are dropped, the rest add their plane (weighted by area) to their corners
+				for (size_t i = 0; i + 2 < mb.indices.size(); i += 3) {
+					uint32_t v[3] = { mb.indices[i], mb.indices[i + 1], mb.indices[i + 2] };
+					uint32_t a = m_position[v[0]], b = m_position[v[1]], c = m_position[v[2]];
+					if (a == b || b == c || c == a) continue;
+					dvec3 pa = m_positions[a], pb = m_positions[b], pc = m_positions[c];
+					dvec3 n = cross(pb - pa, pc - pa);
+					double area = length(n);
+					if (area > 0) n /= area;
+					uint32_t t = uint32_t(m_indices.size() / 3);
+					for (int k = 0; k < 3; k++) {
+						m_indices.push_back(v[k]);
+						m_triangles[m_position[v[k]]].push_back(t);
+						if (area > 0) m_quadrics[m_position[v[k]]].add_plane(n, -dot(n, pa), area * 0.5);
+					}
+				}
+				m_alive.assign(m_indices.size() / 3, 1);
+				m_alive_count = m_alive.size();
+			}
+
+			void run(size_t target_triangles, float max_error) {
+				// over the limit collapses are left out of the queue rather than ending it, so it runs dry instead
+				m_max_distance2 = max_error < FLT_MAX ? double(max_error) * max_error : DBL_MAX;
+				add_border_planes();
+				for (uint32_t p = 0; p < m_positions.size(); p++) push(p);
+
+				std::vector<uint32_t> neighbours;
+				while (m_alive_count > target_triangles && !m_queue.empty()) {
+					collapse c = m_queue.top();
+					m_queue.pop();
+					if (c.version != m_version[c.from]) continue;
+
+					apply(c.from, c.to);
+
+					// every position whose neighbourhood changed needs its best collapse again
+					neighbours.clear();
+					neighbours.push_back(c.to);
+					for (uint32_t t : triangles(c.to)) {
+						for (int k = 0; k < 3; k++) neighbours.push_back(pos(t, k));
+					}
+					std::sort(neighbours.begin(), neighbours.end());
+					neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+					for (uint32_t p : neighbours) {
+						m_version[p]++;
+						push(p);
+					}
+				}
+			}
+
+			// the remaining triangles, with only the vertices they use in the order they use them
+			mesh_builder result() const {
+				mesh_builder out(m_mb.mode);
+				out.format = m_mb.format;
+				out.has_tangents = m_mb.has_tangents;
+				std::vector<uint32_t> remap(m_mb.vertices.size(), g_none);
+				for (size_t t = 0; t < m_alive.size(); t++) {
+					if (!m_alive[t]) continue;
+					for (int k = 0; k < 3; k++) {
+						uint32_t v = m_indices[t * 3 + k];
+						if (remap[v] == g_none) {
+							remap[v] = out.push_vertex(m_mb.vertices[v]);
+							if (out.has_tangents) out.tangents.push_back(m_mb.tangents[v]);
+						}
+						out.push_index(remap[v]);
+					}
+				}
+				return out;
+			}
+		};
+
+		// the closest point to p on the triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+		vec3 closest_on_triangle(vec3 p, vec3 a, vec3 b, vec3 c) {
+			vec3 ab = b - a, ac = c - a, ap = p - a;
+			float d1 = dot(ab, ap), d2 = dot(ac, ap);
+			if (d1 <= 0 && d2 <= 0) return a;
+			vec3 bp = p - b;
+			float d3 = dot(ab, bp), d4 = dot(ac, bp);
+			if (d3 >= 0 && d4 <= d3) return b;
+			float vc = d1 * d4 - d3 * d2;
+			if (vc <= 0 && d1 >= 0 && d3 <= 0) return a + d1 / (d1 - d3) * ab;
+			vec3 cp = p - c;
+			float d5 = dot(ab, cp), d6 = dot(ac, cp);
+			if (d6 >= 0 && d5 <= d6) return c;
+			float vb = d5 * d2 - d1 * d6;
+			if (vb <= 0 && d2 >= 0 && d6 <= 0) return a + d2 / (d2 - d6) * ac;
+			float va = d3 * d6 - d5 * d4;
+			if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+			float denom = 1 / (va + vb + vc);
+			return a + ab * (vb * denom) + ac * (vc * denom);
+		}
+
+		// the triangles of a mesh binned into a uniform grid, for finding the distance from a point to the surface
+		class triangle_grid {
+		private:
+			const mesh_builder &m_mesh;
+			vec3 m_min{FLT_MAX}, m_max{-FLT_MAX};
+			float m_cell = 1;
+			ivec3 m_dims{1};
+			std::vector<std::vector<uint32_t>> m_cells;
+
+			ivec3 cell_of(vec3 p) const {
+				return clamp(ivec3(floor((p - m_min) / m_cell)), ivec3(0), m_dims - 1);
+			}
+
+			size_t index(ivec3 c) const {
+				return (size_t(c.z) * m_dims.y + c.y) * m_dims.x + c.x;
+			}
+
+		public:
+			explicit triangle_grid(const mesh_builder &mb) : m_mesh(mb) {
+				const size_t triangle_count = mb.indices.size() / 3;
+				for (const mesh_vertex &v : mb.vertices) {
+					m_min = min(m_min, v.pos);
+					m_max = max(m_max, v.pos);
+				}
+
+				// about one triangle per cell, with at most 128 cells a side
+				vec3 extent = max(m_max - m_min, vec3(1e-6f));
+				float volume = std::max(extent.x * extent.y * extent.z, 1e-12f);
+				m_cell = std::max(std::cbrt(volume / float(std::max<size_t>(triangle_count, 1))), std::max(extent.x, std::max(extent.y, extent.z)) / 128.0f);
+				m_dims = clamp(ivec3(ceil(extent / m_cell)), ivec3(1), ivec3(128));
+				m_cells.resize(size_t(m_dims.x) * m_dims.y * m_dims.z);
+
+				for (size_t t = 0; t < triangle_count; t++) {
+					vec3 a = mb.vertices[mb.indices[t * 3]].pos, b = mb.vertices[mb.indices[t * 3 + 1]].pos, c = mb.vertices[mb.indices[t * 3 + 2]].pos;
+					ivec3 lo = cell_of(min(a, min(b, c))), hi = cell_of(max(a, max(b, c)));
+					for (int z = lo.z; z <= hi.z; z++)
+						for (int y = lo.y; y <= hi.y; y++)
+							for (int x = lo.x; x <= hi.x; x++)
+								m_cells[index(ivec3(x, y, z))].push_back(uint32_t(t));
+				}
+			}
+
+			// the distance from p to the nearest triangle, searching shells of cells outwards until
+			// nothing further out can be closer
+			float distance(vec3 p) const {
+				const ivec3 centre = cell_of(p);
+				const float outside = length(p - clamp(p, m_min, m_max));
+				const int max_ring = std::max(m_dims.x, std::max(m_dims.y, m_dims.z));
+				float best = FLT_MAX;
+				for (int r = 0; r <= max_ring; r++) {
+					ivec3 lo = max(centre - r, ivec3(0)), hi = min(centre + r, m_dims - 1);
+					for (int z = lo.z; z <= hi.z; z++) {
+						for (int y = lo.y; y <= hi.y; y++) {
+							for (int x = lo.x; x <= hi.x; x++) {
+								// only the shell, the inside was searched by the smaller rings
+								ivec3 c(x, y, z);
+								ivec3 offset = abs(c - centre);
+								if (std::max(offset.x, std::max(offset.y, offset.z)) != r) continue;
+								for (uint32_t t : m_cells[index(c)]) {
+									vec3 a = m_mesh.vertices[m_mesh.indices[t * 3]].pos;
+									vec3 b = m_mesh.vertices[m_mesh.indices[t * 3 + 1]].pos;
+									vec3 d = m_mesh.vertices[m_mesh.indices[t * 3 + 2]].pos;
+									best = std::min(best, glm::distance(p, closest_on_triangle(p, a, b, d)));
+								}
+							}
+						}
+					}
+					if (best <= r * m_cell - outside) break;
+				}
+				return best;
+			}
+		};
+
+		// the largest distance from the corners and centres of a's triangles to b's surface
+		float one_sided_hausdorff(const mesh_builder &a, const triangle_grid &b) {
+			const int64_t triangle_count = int64_t(a.indices.size() / 3);
+			float worst = 0;
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic, 256) reduction(max:worst)
+#endif
+			for (int64_t t = 0; t < triangle_count; t++) {
+				vec3 p0 = a.vertices[a.indices[t * 3]].pos, p1 = a.vertices[a.indices[t * 3 + 1]].pos, p2 = a.vertices[a.indices[t * 3 + 2]].pos;
+				for (vec3 p : { p0, p1, p2, (p0 + p1 + p2) / 3.0f }) worst = std::max(worst, b.distance(p));
+			}
+			return worst;
+		}
+	}
+
+
+	mesh_builder simplify(const mesh_builder &mb, size_t target_triangles, float max_error) {
+		CGRA_TRACE_ZONE("simplify");
+		if (mb.mode != GL_TRIANGLES) return mb;
+		simplifier s(mb);
+		s.run(target_triangles, max_error);
+		return s.result();
+	}
+
+
+	const gl_mesh & gl_mesh_lods::select(const mat4 &modelview, const mat4 &proj, float viewport_height, float full_detail_pixels) const {
+		assert(!levels.empty());
+		vec3 view_centre = vec3(modelview * vec4(centre, 1));
+		float scale = max(length(vec3(modelview[0])), max(length(vec3(modelview[1])), length(vec3(modelview[2]))));
+		float r = radius * scale;
+		float distance = -view_centre.z;
+		if (distance <= r) return levels[0];
+
+		// proj[1][1] is 1 / tan(fovy / 2), so the sphere is about this many pixels across
+		float pixels = r * proj[1][1] * viewport_height / distance;
+		if (pixels >= full_detail_pixels) return levels[0];
+		int level = int(std::log2(full_detail_pixels / max(pixels, 1e-6f)));
+		return levels[size_t(clamp(level, 0, int(levels.size()) - 1))];
+	}
+
+
+	void gl_mesh_lods::destroy() {
+		for (gl_mesh &m : levels) m.destroy();
+		levels.clear();
+		triangle_counts.clear();
+	}
+
+
+	std::vector<mesh_builder> simplify_lods(const mesh_builder &mb, int level_count, float ratio) {
+		CGRA_TRACE_ZONE("simplify_lods");
+		std::vector<mesh_builder> lods = { mb };
+		if (mb.mode != GL_TRIANGLES) return lods;
+
+		// each level is simplified from the one before, which is much faster than from the original every time
+		for (int l = 1; l < level_count; l++) {
+			size_t previous = lods.back().indices.size() / 3;
+			mesh_builder next = simplify(lods.back(), size_t(previous * ratio));
+			if (next.indices.size() / 3 >= previous) break;
+			lods.push_back(std::move(next));
+		}
+		return lods;
+	}
+
+
+	gl_mesh_lods build_lods(const mesh_builder &mb, const std::string &name, int level_count, float ratio) {
+		gl_mesh_lods lods;
+		std::vector<mesh_builder> levels = simplify_lods(mb, level_count, ratio);
+		for (size_t l = 0; l < levels.size(); l++) {
+			levels[l].optimise(name + " LOD " + std::to_string(l));
+			lods.levels.push_back(levels[l].build());
+			lods.triangle_counts.push_back(levels[l].indices.size() / 3);
+		}
+
+		// simplification only removes vertices, so the finest level's sphere holds every level
+		lods.centre = lods.levels[0].sphere_centre;
+		lods.radius = lods.levels[0].sphere_radius;
+		return lods;
+	}
+
+
+	float hausdorff_distance(const mesh_builder &a, const mesh_builder &b) {
+		CGRA_TRACE_ZONE("hausdorff_distance");
+		triangle_grid grid_a(a), grid_b(b);
+		return std::max(one_sided_hausdorff(a, grid_b), one_sided_hausdorff(b, grid_a));
+	}
+
+
+	bool report_lods(const mesh_builder &mb, const std::string &name, int level_count, float ratio, float max_error_ratio) {
+		CGRA_TRACE_ZONE("report_lods");
+		vec3 lo(FLT_MAX), hi(-FLT_MAX);
+		for (const mesh_vertex &v : mb.vertices) {
+			lo = min(lo, v.pos);
+			hi = max(hi, v.pos);
+		}
+		const float radius = mb.vertices.empty() ? 0.0f : length(hi - lo) * 0.5f;
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<mesh_builder> levels = simplify_lods(mb, level_count, ratio);
+		double simplify_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "LOD report " << name << ": " << levels.size() << " levels simplified in " << simplify_ms << "ms" << std::endl;
+
+		bool ok = true;
+		for (size_t l = 0; l < levels.size(); l++) {
+			float error = l ? hausdorff_distance(mb, levels[l]) : 0.0f;
+			float relative = radius > 0 ? error / radius : 0.0f;
+			std::cout << "  LOD " << l << ": " << (levels[l].indices.size() / 3) << " triangles, " << levels[l].vertices.size()
+				<< " vertices, Hausdorff error " << error << " (" << (100 * relative) << "% of the radius)" << std::endl;
+			if (relative > max_error_ratio) {
+				std::cerr << "Warning: LOD " << l << " of " << name << " is further than " << (100 * max_error_ratio) << "% of the radius from the original" << std::endl;
+				ok = false;
+			}
+		}
+		return ok;
+	}
+
+
+	bool report_lods(const std::string &filename) {
+		try {
+			mesh_builder mb = filename == "sphere" ? sphere_builder(64, 64) : load_wavefront_data(filename);
+			return report_lods(mb, filename);
+		} catch (std::runtime_error &e) {
+			std::cerr << "Warning: LOD report could not load " << filename << ": " << e.what() << std::endl;
+			return false;
+		}
+	}
+}
@@ -0,0 +1,58 @@
+
+#pragma once
+
+// std
+#include <cfloat>
+#include <string>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "cgra_mesh.hpp"
+
+
+namespace cgra {
+
+	// simplifies a GL_TRIANGLES mesh by collapsing edges in order of quadric error (Garland and Heckbert)
+	// until at most target_triangles are left, or every collapse left would move the surface more than max_error
+	// (measured as the root mean square distance to the planes of the original triangles it stands in for).
+	// vertices are collapsed onto their neighbours, so normals and uvs are kept as they are. uv and normal seams
+	// (a position with several vertices) and open borders only collapse along themselves, so they stay closed
+	mesh_builder simplify(const mesh_builder &mb, size_t target_triangles, float max_error = FLT_MAX);
+
+	// a mesh at several levels of detail, finest first, with a bounding sphere to choose between them.
+	// levels tessellated to known tolerances (like lathe_builder's) are better chosen with select_lod
+	struct gl_mesh_lods {
+		std::vector<gl_mesh> levels;
+		std::vector<size_t> triangle_counts;
+		glm::vec3 centre{0};
+		float radius = 0;
+
+		// the level for one draw: level 0 while the bounding sphere is at least full_detail_pixels across on screen,
+		// then one level coarser each time its projected size halves
+		const gl_mesh & select(const glm::mat4 &modelview, const glm::mat4 &proj, float viewport_height, float full_detail_pixels = 512) const;
+
+		// deletes the gl buffers of every level
+		void destroy();
+	};
+
+	// simplifies a mesh into a chain of levels, each with about ratio times the triangles of the one before
+	// levels stop early if simplification stops making progress
+	std::vector<mesh_builder> simplify_lods(const mesh_builder &mb, int level_count, float ratio = 0.5f);
+
+	// simplifies, optimises (printing as "name LOD n") and builds a chain of levels with the builder's vertex format.
+	// packed levels each have their own gl_mesh::position_transform
+	gl_mesh_lods build_lods(const mesh_builder &mb, const std::string &name, int level_count, float ratio = 0.5f);
+
+	// the largest distance from either mesh's surface to the other's, sampled at the corners and centre of every triangle
+	float hausdorff_distance(const mesh_builder &a, const mesh_builder &b);
+
+	// simplifies a mesh into levels like build_lods and prints each level's triangle count and Hausdorff error against
+	// the original. returns false (with a warning) if any level is further than max_error_ratio of the bounding radius
+	bool report_lods(const mesh_builder &mb, const std::string &name, int level_count = 5, float ratio = 0.5f, float max_error_ratio = 0.1f);
+
+	// the same for an OBJ file, or for the 64x64 unit sphere when the filename is "sphere"
+	bool report_lods(const std::string &filename);
+}
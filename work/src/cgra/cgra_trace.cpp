@@ -0,0 +1,209 @@
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// project
+#include "cgra_trace.hpp"
+
+
+namespace cgra {
+
+	namespace {
+
+		using trace_clock = std::chrono::steady_clock;
+
+		// events per thread, older events are overwritten once the ring is full
+		constexpr uint64_t ring_capacity = 1 << 16;
+
+		// the low bit of the packed timestamp marks begin (1) or end (0)
+		constexpr uint64_t begin_bit = 1;
+
+		// a single begin or end event. fields are atomics so the exporter can
+		// read a ring while its owning thread keeps writing (relaxed stores are
+		// free on x86, and torn slots are discarded by re-checking the head)
+		struct trace_event {
+			std::atomic<const char *> name{ nullptr };
+			std::atomic<uint64_t> packed{ 0 }; // nanoseconds << 1 | begin_bit
+		};
+
+		// single producer ring buffer owned by one thread
+		struct thread_buffer {
+			std::unique_ptr<trace_event[]> events{ new trace_event[ring_capacity] };
+			std::atomic<uint64_t> head{ 0 }; // total number of events ever written
+			std::string name;
+			int tid = 0;
+		};
+
+		const trace_clock::time_point g_epoch = trace_clock::now();
+
+		// registry of every thread that has recorded an event. buffers are
+		// never freed so traces still contain threads that have exited
+		std::mutex g_registry_mutex;
+		std::vector<std::unique_ptr<thread_buffer>> g_registry;
+
+		thread_buffer & local_buffer() {
+			thread_local thread_buffer *buffer = nullptr;
+			if (!buffer) {
+				std::lock_guard<std::mutex> lock(g_registry_mutex);
+				g_registry.emplace_back(new thread_buffer);
+				buffer = g_registry.back().get();
+				buffer->tid = int(g_registry.size());
+				buffer->name = "thread " + std::to_string(buffer->tid);
+			}
+			return *buffer;
+		}
+
+		uint64_t now_ns() {
+			return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(trace_clock::now() - g_epoch).count());
+		}
+
+		void record(const char *name, bool is_begin) {
+			thread_buffer &b = local_buffer();
+			uint64_t h = b.head.load(std::memory_order_relaxed);
+			trace_event &e = b.events[h % ring_capacity];
+			e.name.store(name, std::memory_order_relaxed);
+			e.packed.store((now_ns() << 1) | (is_begin ? begin_bit : 0), std::memory_order_relaxed);
+			b.head.store(h + 1, std::memory_order_release);
+		}
+
+
+		struct complete_zone {
+			const char *name;
+			uint64_t start_ns;
+			uint64_t end_ns;
+			int depth;
+		};
+
+		// copies a thread's ring and pairs begin/end events into complete zones
+		std::vector<complete_zone> collect_zones(thread_buffer &b, uint64_t window_start_ns, uint64_t now) {
+			uint64_t head = b.head.load(std::memory_order_acquire);
+			uint64_t first = head > ring_capacity ? head - ring_capacity : 0;
+
+			std::vector<std::pair<const char *, uint64_t>> events;
+			events.reserve(size_t(head - first));
+			for (uint64_t i = first; i < head; i++) {
+				const trace_event &e = b.events[i % ring_capacity];
+				events.emplace_back(e.name.load(std::memory_order_relaxed), e.packed.load(std::memory_order_relaxed));
+			}
+
+			// anything the writer may have overwritten while copying is dropped
+			// (including the slot of the event currently being written)
+			uint64_t new_head = b.head.load(std::memory_order_acquire);
+			uint64_t valid_first = new_head + 1 > ring_capacity ? new_head + 1 - ring_capacity : 0;
+			size_t skip = size_t(std::min(head, std::max(first, valid_first)) - first);
+
+			std::vector<complete_zone> zones;
+			std::vector<complete_zone> stack;
+			for (size_t i = skip; i < events.size(); i++) {
+				uint64_t ts = events[i].second >> 1;
+				if (events[i].second & begin_bit) {
+					stack.push_back({ events[i].first, ts, 0, int(stack.size()) });
+				}
+				else if (!stack.empty()) {
+					complete_zone z = stack.back();
+					stack.pop_back();
+					z.end_ns = ts;
+					if (z.end_ns >= window_start_ns) zones.push_back(z);
+				}
+				// an end without a begin lost its begin to the ring wrapping
+			}
+
+			// zones still open are clamped to the time of the capture
+			for (complete_zone z : stack) {
+				z.end_ns = now;
+				zones.push_back(z);
+			}
+
+			return zones;
+		}
+
+		void write_json_string(std::ostream &out, const std::string &s) {
+			out << '"';
+			for (char c : s) {
+				if (c == '"' || c == '\\') out << '\\' << c;
+				else if (c == '\n') out << "\\n";
+				else if (static_cast<unsigned char>(c) >= 0x20) out << c;
+			}
+			out << '"';
+		}
+	}
+
+
+	namespace trace {
+
+		namespace detail {
+			std::atomic<bool> enabled{ false };
+		}
+
+
+		void set_enabled(bool enable) {
+			detail::enabled.store(enable, std::memory_order_relaxed);
+		}
+
+
+		void set_thread_name(const std::string &name) {
+			thread_buffer &b = local_buffer();
+			std::lock_guard<std::mutex> lock(g_registry_mutex);
+			b.name = name;
+		}
+
+
+		void begin(const char *name) {
+			record(name, true);
+		}
+
+
+		void end() {
+			record(nullptr, false);
+		}
+
+
+		size_t write_chrome_json(const std::string &filename, double seconds) {
+			uint64_t now = now_ns();
+			uint64_t window = uint64_t(std::max(0.0, seconds) * 1e9);
+			uint64_t window_start = now > window ? now - window : 0;
+
+			std::ofstream out(filename);
+			if (!out) {
+				std::cerr << "Error: Could not write trace " << filename << std::endl;
+				return 0;
+			}
+
+			out << std::fixed << std::setprecision(3);
+			out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+			bool first = true;
+			size_t count = 0;
+
+			std::lock_guard<std::mutex> lock(g_registry_mutex);
+			for (auto &b : g_registry) {
+				// thread name metadata
+				if (!first) out << ',';
+				first = false;
+				out << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << b->tid << ",\"args\":{\"name\":";
+				write_json_string(out, b->name);
+				out << "}}";
+
+				for (const complete_zone &z : collect_zones(*b, window_start, now)) {
+					uint64_t start = std::max(z.start_ns, window_start);
+					out << ",\n{\"ph\":\"X\",\"cat\":\"cgra\",\"pid\":1,\"tid\":" << b->tid << ",\"name\":";
+					write_json_string(out, z.name ? z.name : "?");
+					out << ",\"ts\":" << (start / 1000.0) << ",\"dur\":" << ((z.end_ns - start) / 1000.0);
+					out << ",\"args\":{\"depth\":" << z.depth << "}}";
+					count++;
+				}
+			}
+			out << "\n]}\n";
+
+			std::cout << "Wrote trace " << filename << " (" << count << " zones)" << std::endl;
+			return count;
+		}
+	}
+}
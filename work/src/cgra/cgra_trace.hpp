@@ -0,0 +1,57 @@
+
+#pragma once
+
+// std
+#include <atomic>
+#include <string>
+
+
+namespace cgra {
+	namespace trace {
+
+		namespace detail {
+			extern std::atomic<bool> enabled;
+		}
+
+		// recording is off by default, a disabled zone costs a single relaxed load
+		inline bool enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+		void set_enabled(bool enable);
+
+		// names the calling thread in exported traces
+		void set_thread_name(const std::string &name);
+
+		// records a begin/end event into the calling thread's ring buffer
+		// zones must be properly nested per thread. the name must be a string
+		// literal (or otherwise outlive the trace) as only the pointer is stored
+		void begin(const char *name);
+		void end();
+
+		// helper object that records a zone for the lifetime of the scope
+		class zone {
+		private:
+			bool m_active;
+
+		public:
+			explicit zone(const char *name) : m_active(enabled()) { if (m_active) begin(name); }
+			~zone() { if (m_active) end(); }
+			zone(const zone &) = delete;
+			zone & operator=(const zone &) = delete;
+		};
+
+		// writes the zones from the last `seconds` of every thread to a chrome
+		// trace_event json file (viewable in chrome://tracing or perfetto)
+		// returns the number of zones written
+		size_t write_chrome_json(const std::string &filename, double seconds = 10.0);
+	}
+}
+
+
+// records a zone until the end of the enclosing scope
+// define CGRA_NO_TRACE to compile all zones out completely
+#ifdef CGRA_NO_TRACE
+#define CGRA_TRACE_ZONE(name) ((void)0)
+#else
+#define CGRA_TRACE_CONCAT_IMPL(a, b) a##b
+#define CGRA_TRACE_CONCAT(a, b) CGRA_TRACE_CONCAT_IMPL(a, b)
+#define CGRA_TRACE_ZONE(name) ::cgra::trace::zone CGRA_TRACE_CONCAT(cgra_trace_zone_, __LINE__)(name)
+#endif
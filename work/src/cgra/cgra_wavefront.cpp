@@ -0,0 +1,638 @@
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef CGRA_HAVE_OPENMP
+#include <omp.h>
+#endif
+
+// project
+#include "cgra_cache.hpp"
+#include "cgra_mapped_file.hpp"
+#include "cgra_mesh_file.hpp"
+#include "cgra_trace.hpp"
+#include "cgra_wavefront.hpp"
+
+
+using namespace glm;
+
+namespace cgra {
+
+	namespace {
+
+		// chunks are about this big, so small files are parsed on one thread
+		const size_t g_chunk_size = 1 << 20;
+
+		// the benchmark's loaders have to agree to within this on every position, normal and uv
+		const float g_benchmark_epsilon = 1e-5f;
+
+		// one face corner. indices are 0 based, -1 when missing, and relative (negative in the
+		// file) indices are counted from the chunk's own data until the chunks are merged
+		struct obj_corner {
+			int32_t p = -1, t = -1, n = -1;
+			uint8_t relative = 0; // bit 0 position, bit 1 uv, bit 2 normal
+		};
+
+		struct obj_chunk {
+			std::vector<vec3> positions;
+			std::vector<vec3> normals;
+			std::vector<vec2> uvs;
+			std::vector<obj_corner> corners; // the corners of every face, in order
+			std::vector<uint32_t> face_sizes;
+			std::vector<obj_corner> triangles; // the faces after triangulation, three corners each
+		};
+
+
+		inline bool is_space(char c) {
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		inline bool is_digit(char c) {
+			return c >= '0' && c <= '9';
+		}
+
+		inline const char * skip_space(const char *p, const char *end) {
+			while (p < end && is_space(*p)) p++;
+			return p;
+		}
+
+		// decimal floats like strtof (anything else, like inf or nan, goes to strtof), returns the end of the number
+		const char * parse_float(const char *p, const char *end, float &out) {
+			static const double powers[] = {
+				1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+				1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+			};
+
+			const char *start = p;
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+			// up to 18 significant digits fit in the mantissa, the rest only move the exponent
+			uint64_t mantissa = 0;
+			int exponent = 0;
+			bool digits = false;
+			for (; p < end && is_digit(*p); p++, digits = true) {
+				if (mantissa < 100000000000000000ull) mantissa = mantissa * 10 + (*p - '0');
+				else exponent++;
+			}
+			if (p < end && *p == '.') {
+				for (p++; p < end && is_digit(*p); p++, digits = true) {
+					if (mantissa < 100000000000000000ull) {
+						mantissa = mantissa * 10 + (*p - '0');
+						exponent--;
+					}
+				}
+			}
+
+			if (!digits) {
+				char buffer[64] = {};
+				std::memcpy(buffer, start, std::min<size_t>(end - start, sizeof(buffer) - 1));
+				char *parsed;
+				out = std::strtof(buffer, &parsed);
+				return start + (parsed - buffer);
+			}
+
+			if (p + 1 < end && (*p == 'e' || *p == 'E') && (is_digit(p[1]) || ((p[1] == '-' || p[1] == '+') && p + 2 < end && is_digit(p[2])))) {
+				p++;
+				bool negative_exponent = false;
+				if (*p == '-' || *p == '+') negative_exponent = *p++ == '-';
+				int e = 0;
+				for (; p < end && is_digit(*p); p++) e = std::min(e * 10 + (*p - '0'), 10000);
+				exponent += negative_exponent ? -e : e;
+			}
+
+			// exact powers of ten up to 1e22, so one multiply or divide is correctly rounded
+			double value = double(mantissa);
+			while (exponent > 22 && value != 0) { value *= 1e22; exponent -= 22; }
+			while (exponent < -22 && value != 0) { value /= 1e22; exponent += 22; }
+			value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+			out = float(negative ? -value : value);
+			return p;
+		}
+
+		// parses up to n floats, the rest are left at 0
+		const char * parse_floats(const char *p, const char *end, float *out, int n) {
+			for (int i = 0; i < n; i++) {
+				p = skip_space(p, end);
+				if (p >= end) break;
+				p = parse_float(p, end, out[i]);
+			}
+			return p;
+		}
+
+		// a face index, converted to 0 based (or chunk relative if negative), returns the end
+		const char * parse_index(const char *p, const char *end, size_t count, int bit, int32_t &index, uint8_t &relative) {
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+			int64_t value = 0;
+			bool digits = false;
+			for (; p < end && is_digit(*p); p++, digits = true) value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+			if (!digits || value == 0) return p;
+			if (negative) {
+				index = int32_t(int64_t(count) - value);
+				relative |= uint8_t(1 << bit);
+			} else {
+				index = int32_t(value - 1);
+			}
+			return p;
+		}
+
+		void parse_chunk(const char *p, const char *end, obj_chunk &chunk) {
+			CGRA_TRACE_ZONE("parse_chunk");
+			while (p < end) {
+				const char *line_end = static_cast<const char *>(std::memchr(p, '\n', end - p));
+				if (!line_end) line_end = end;
+
+				const char *q = skip_space(p, line_end);
+				if (line_end - q >= 2) {
+					if (q[0] == 'v' && is_space(q[1])) {
+						vec3 v(0);
+						parse_floats(q + 2, line_end, &v.x, 3);
+						chunk.positions.push_back(v);
+					} else if (q[0] == 'v' && q[1] == 'n' && line_end - q >= 3 && is_space(q[2])) {
+						vec3 vn(0);
+						parse_floats(q + 3, line_end, &vn.x, 3);
+						chunk.normals.push_back(vn);
+					} else if (q[0] == 'v' && q[1] == 't' && line_end - q >= 3 && is_space(q[2])) {
+						vec2 vt(0);
+						parse_floats(q + 3, line_end, &vt.x, 2);
+						chunk.uvs.push_back(vt);
+					} else if (q[0] == 'f' && is_space(q[1])) {
+						// p, p/t, p//n or p/t/n corners
+						size_t first = chunk.corners.size();
+						q += 2;
+						while ((q = skip_space(q, line_end)) < line_end) {
+							obj_corner c;
+							const char *start = q;
+							q = parse_index(q, line_end, chunk.positions.size(), 0, c.p, c.relative);
+							if (q < line_end && *q == '/') {
+								q++;
+								if (q < line_end && *q != '/') q = parse_index(q, line_end, chunk.uvs.size(), 1, c.t, c.relative);
+								if (q < line_end && *q == '/') q = parse_index(q + 1, line_end, chunk.normals.size(), 2, c.n, c.relative);
+							}
+							if (q == start) break; // not an index
+							chunk.corners.push_back(c);
+						}
+
+						// points and lines are skipped
+						size_t size = chunk.corners.size() - first;
+						if (size >= 3) chunk.face_sizes.push_back(uint32_t(size));
+						else chunk.corners.resize(first);
+					}
+				}
+				p = line_end + 1;
+			}
+		}
+
+		// resolves a chunk relative index against the data in the chunks before it
+		inline int32_t resolve(int32_t index, uint8_t relative, int bit, size_t offset, size_t count, bool &valid) {
+			if (index == -1 && !(relative & (1 << bit))) return -1;
+			int64_t i = (relative & (1 << bit)) ? int64_t(index) + int64_t(offset) : int64_t(index);
+			if (i < 0 || i >= int64_t(count)) valid = false;
+			return int32_t(i);
+		}
+
+		inline float cross2(vec2 a, vec2 b) {
+			return a.x * b.y - a.y * b.x;
+		}
+
+		// reused between the polygons triangulated on one thread
+		struct polygon_scratch {
+			std::vector<vec2> points;
+			std::vector<uint32_t> remaining;
+		};
+
+		// triangulates one polygon by ear clipping in the plane of its (Newell) normal, appending three
+		// corners per triangle. whatever is left when no ear can be found (self intersecting or degenerate
+		// polygons) becomes a fan
+		void triangulate(const obj_corner *face, size_t n, const std::vector<vec3> &positions, polygon_scratch &scratch, std::vector<obj_corner> &triangles) {
+			if (n == 3) {
+				triangles.insert(triangles.end(), face, face + 3);
+				return;
+			}
+
+			vec3 normal(0);
+			for (size_t i = 0; i < n; i++) {
+				normal += cross(positions[face[i].p], positions[face[(i + 1) % n].p]);
+			}
+
+			// drop the largest axis of the normal, picking the other two so the polygon winds counter-clockwise
+			vec3 an = abs(normal);
+			int axis = an.x > an.y ? (an.x > an.z ? 0 : 2) : (an.y > an.z ? 1 : 2);
+			int u = (axis + 1) % 3, v = (axis + 2) % 3;
+			if (normal[axis] < 0) std::swap(u, v);
+
+			std::vector<vec2> &points = scratch.points;
+			std::vector<uint32_t> &remaining = scratch.remaining;
+			points.resize(n);
+			remaining.resize(n);
+			for (size_t i = 0; i < n; i++) {
+				const vec3 &pos = positions[face[i].p];
+				points[i] = vec2(pos[u], pos[v]);
+				remaining[i] = uint32_t(i);
+			}
+
+			auto emit = [&](uint32_t a, uint32_t b, uint32_t c) {
+				triangles.push_back(face[a]);
+				triangles.push_back(face[b]);
+				triangles.push_back(face[c]);
+			};
+
+			size_t i = 0, attempts = 0;
+			while (remaining.size() > 3 && attempts < remaining.size()) {
+				size_t m = remaining.size();
+				uint32_t prev = remaining[(i + m - 1) % m], cur = remaining[i % m], next = remaining[(i + 1) % m];
+				vec2 a = points[prev], b = points[cur], c = points[next];
+
+				// an ear is convex with no other corner inside it
+				bool ear = cross2(b - a, c - b) > 0;
+				for (size_t k = 0; ear && k < m; k++) {
+					vec2 q = points[remaining[k]];
+					if (q == a || q == b || q == c) continue;
+					ear = !(cross2(b - a, q - a) >= 0 && cross2(c - b, q - b) >= 0 && cross2(a - c, q - c) >= 0);
+				}
+
+				if (ear) {
+					emit(prev, cur, next);
+					remaining.erase(remaining.begin() + (i % m));
+					attempts = 0;
+				} else {
+					i++;
+					attempts++;
+				}
+				i %= remaining.size();
+			}
+
+			for (size_t k = 1; k + 1 < remaining.size(); k++) {
+				emit(remaining[0], remaining[k], remaining[k + 1]);
+			}
+		}
+
+		// welds identical (position, uv, normal) corners into shared vertices, numbered in order of first use
+		void weld(const std::vector<obj_corner> &corners, std::vector<obj_corner> &unique, std::vector<GLuint> &indices) {
+			CGRA_TRACE_ZONE("weld");
+			const uint32_t empty = UINT32_MAX;
+			size_t capacity = 16;
+			while (capacity < corners.size() * 2) capacity *= 2;
+			const size_t mask = capacity - 1;
+
+			// open addressing with linear probing, the table holds indices into unique
+			std::vector<uint32_t> table(capacity, empty);
+			indices.resize(corners.size());
+			unique.clear();
+			unique.reserve(corners.size() / 4);
+			for (size_t i = 0; i < corners.size(); i++) {
+				const obj_corner &c = corners[i];
+				uint64_t h = uint64_t(uint32_t(c.p)) * 0x9e3779b97f4a7c15ull;
+				h ^= uint64_t(uint32_t(c.t)) * 0xc2b2ae3d27d4eb4full;
+				h ^= uint64_t(uint32_t(c.n)) * 0x165667b19e3779f9ull;
+				h ^= h >> 29;
+				for (size_t slot = size_t(h) & mask;; slot = (slot + 1) & mask) {
+					uint32_t v = table[slot];
+					if (v == empty) {
+						table[slot] = uint32_t(unique.size());
+						indices[i] = GLuint(unique.size());
+						unique.push_back(c);
+						break;
+					}
+					const obj_corner &u = unique[v];
+					if (u.p == c.p && u.t == c.t && u.n == c.n) {
+						indices[i] = GLuint(v);
+						break;
+					}
+				}
+			}
+		}
+
+		// the loader as it was before it parsed in parallel from a mapping (a line at a time through
+		// istringstream, triangles only, one vertex per corner), kept as the benchmark's baseline
+		mesh_builder load_wavefront_reference(const std::string &filename) {
+			CGRA_TRACE_ZONE("load_wavefront_reference");
+
+			struct wavefront_vertex {
+				int p = 0, n = 0, t = 0;
+			};
+			std::vector<vec3> positions;
+			std::vector<vec3> normals;
+			std::vector<vec2> uvs;
+			std::vector<wavefront_vertex> wv_vertices;
+
+			std::ifstream objFile(filename);
+			if (!objFile.is_open()) throw std::runtime_error("Error: could not open file " + filename);
+
+			while (objFile.good()) {
+				std::string line;
+				std::getline(objFile, line);
+				std::istringstream objLine(line);
+				std::string mode;
+				objLine >> mode;
+				if (!objLine.good()) continue;
+
+				if (mode == "v") {
+					vec3 v;
+					objLine >> v.x >> v.y >> v.z;
+					positions.push_back(v);
+				}
+				else if (mode == "vn") {
+					vec3 vn;
+					objLine >> vn.x >> vn.y >> vn.z;
+					normals.push_back(vn);
+				}
+				else if (mode == "vt") {
+					vec2 vt;
+					objLine >> vt.x >> vt.y;
+					uvs.push_back(vt);
+				}
+				else if (mode == "f") {
+					std::vector<wavefront_vertex> face;
+					while (objLine.good()) {
+						wavefront_vertex v;
+						objLine >> v.p;
+						if (objLine.fail()) break;
+						if (objLine.peek() == '/') {
+							objLine.ignore(1);
+							if (objLine.peek() != '/') objLine >> v.t;
+							if (objLine.peek() == '/') {
+								objLine.ignore(1);
+								objLine >> v.n;
+							}
+						}
+						v.p -= 1;
+						v.n -= 1;
+						v.t -= 1;
+						face.push_back(v);
+					}
+					if (face.size() == 3) wv_vertices.insert(wv_vertices.end(), face.begin(), face.end());
+				}
+			}
+
+			// the benchmark file has every attribute, so the reference doesn't need to make any up
+			mesh_builder mb;
+			for (size_t i = 0; i < wv_vertices.size(); ++i) {
+				const wavefront_vertex &w = wv_vertices[i];
+				if (w.p < 0 || size_t(w.p) >= positions.size() || w.n < 0 || size_t(w.n) >= normals.size() || w.t < 0 || size_t(w.t) >= uvs.size())
+					throw std::runtime_error("Error: the reference loader needs positions, uvs and normals for every corner in " + filename);
+				mb.push_index(GLuint(i));
+				mb.push_vertex(mesh_vertex{ positions[w.p], normals[w.n], uvs[w.t] });
+			}
+			return mb;
+		}
+	}
+
+
+	mesh_builder load_wavefront_data(const std::string &filename) {
+		CGRA_TRACE_ZONE("load_wavefront_data");
+
+		mapped_file file(filename);
+		if (!file.is_open()) {
+			std::cerr << "Error: could not open " << filename << std::endl;
+			throw std::runtime_error("Error: could not open file " + filename);
+		}
+
+		// newline aligned chunks, each starts after the newline that ends the previous one
+		const char *begin = file.data();
+		const char *end = file.data() + file.size();
+		std::vector<const char *> bounds = { begin };
+		while (bounds.back() < end) {
+			const char *split = std::min<const char *>(bounds.back() + g_chunk_size, end);
+			const char *newline = split < end ? static_cast<const char *>(std::memchr(split, '\n', end - split)) : nullptr;
+			bounds.push_back(newline ? newline + 1 : end);
+		}
+		const int chunk_count = int(bounds.size()) - 1;
+
+		std::vector<obj_chunk> chunks(chunk_count);
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int i = 0; i < chunk_count; i++) {
+			parse_chunk(bounds[i], bounds[i + 1], chunks[i]);
+		}
+
+		// prefix sums give where each chunk's data goes in the merged arrays
+		std::vector<size_t> position_offset(chunk_count + 1, 0), normal_offset(chunk_count + 1, 0);
+		std::vector<size_t> uv_offset(chunk_count + 1, 0);
+		for (int i = 0; i < chunk_count; i++) {
+			position_offset[i + 1] = position_offset[i] + chunks[i].positions.size();
+			normal_offset[i + 1] = normal_offset[i] + chunks[i].normals.size();
+			uv_offset[i + 1] = uv_offset[i] + chunks[i].uvs.size();
+		}
+
+		std::vector<vec3> positions(position_offset[chunk_count]);
+		std::vector<vec3> normals(normal_offset[chunk_count]);
+		std::vector<vec2> uvs(uv_offset[chunk_count]);
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int i = 0; i < chunk_count; i++) {
+			std::copy(chunks[i].positions.begin(), chunks[i].positions.end(), positions.begin() + position_offset[i]);
+			std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), normals.begin() + normal_offset[i]);
+			std::copy(chunks[i].uvs.begin(), chunks[i].uvs.end(), uvs.begin() + uv_offset[i]);
+		}
+
+		// faces can only be triangulated once every position they use is in place
+		bool valid = true;
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic) reduction(&&:valid)
+#endif
+		for (int i = 0; i < chunk_count; i++) {
+			obj_chunk &chunk = chunks[i];
+			bool chunk_valid = true;
+			for (obj_corner &c : chunk.corners) {
+				c.p = resolve(c.p, c.relative, 0, position_offset[i], positions.size(), chunk_valid);
+				c.t = resolve(c.t, c.relative, 1, uv_offset[i], uvs.size(), chunk_valid);
+				c.n = resolve(c.n, c.relative, 2, normal_offset[i], normals.size(), chunk_valid);
+				if (c.p < 0) chunk_valid = false;
+			}
+			if (chunk_valid) {
+				polygon_scratch scratch;
+				chunk.triangles.reserve(chunk.corners.size());
+				const obj_corner *face = chunk.corners.data();
+				for (uint32_t size : chunk.face_sizes) {
+					triangulate(face, size, positions, scratch, chunk.triangles);
+					face += size;
+				}
+			}
+			valid = valid && chunk_valid;
+		}
+		if (!valid) {
+			std::cerr << "Error: face refers to a missing vertex in " << filename << std::endl;
+			throw std::runtime_error("Error: face refers to a missing vertex in " + filename);
+		}
+
+		std::vector<size_t> triangle_offset(chunk_count + 1, 0);
+		for (int i = 0; i < chunk_count; i++) {
+			triangle_offset[i + 1] = triangle_offset[i] + chunks[i].triangles.size();
+		}
+		std::vector<obj_corner> corners(triangle_offset[chunk_count]);
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int i = 0; i < chunk_count; i++) {
+			std::copy(chunks[i].triangles.begin(), chunks[i].triangles.end(), corners.begin() + triangle_offset[i]);
+			chunks[i] = obj_chunk();
+		}
+
+		// corners without a normal use the area weighted normal at their position,
+		// stored after the normals from the file
+		bool missing_normals = std::any_of(corners.begin(), corners.end(), [](const obj_corner &c) { return c.n < 0; });
+		if (missing_normals) {
+			size_t base = normals.size();
+			normals.resize(base + positions.size(), vec3(0));
+			for (size_t i = 0; i + 2 < corners.size(); i += 3) {
+				const vec3 &a = positions[corners[i].p];
+				const vec3 &b = positions[corners[i + 1].p];
+				const vec3 &c = positions[corners[i + 2].p];
+				vec3 face_norm = cross(b - a, c - a); // length is twice the area
+				for (int k = 0; k < 3; k++) normals[base + corners[i + k].p] += face_norm;
+			}
+			for (size_t i = base; i < normals.size(); i++) {
+				float l = length(normals[i]);
+				if (l > 0) normals[i] /= l;
+			}
+			for (obj_corner &c : corners) {
+				if (c.n < 0) c.n = int32_t(base + c.p);
+			}
+		}
+
+		// create mesh data, corners with the same position, uv and normal share a vertex
+		std::vector<obj_corner> unique;
+		mesh_builder mb;
+		weld(corners, unique, mb.indices);
+		mb.vertices.resize(unique.size());
+		const int64_t vertex_count = int64_t(unique.size());
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int64_t i = 0; i < vertex_count; i++) {
+			const obj_corner &c = unique[i];
+			mb.vertices[i] = mesh_vertex{
+				positions[c.p],
+				normals[c.n],
+				c.t >= 0 ? uvs[c.t] : vec2(0)
+			};
+		}
+
+		return mb;
+	}
+
+
+	gl_mesh load_wavefront(const std::string &filename) {
+		CGRA_TRACE_ZONE("load_wavefront");
+
+		// keyed on the path, size and modified time of the .obj rather than its contents, since hashing
+		// a large .obj takes longer than loading the mesh file. bump the version when the loader's output changes
+		std::error_code ec;
+		uint64_t size = std::filesystem::file_size(filename, ec);
+		int64_t modified = ec ? 0 : int64_t(std::filesystem::last_write_time(filename, ec).time_since_epoch().count());
+		uint64_t key = hash_string(filename, hash_string("wavefront v2"));
+		key = hash_bytes(&size, sizeof(size), key);
+		key = hash_bytes(&modified, sizeof(modified), key);
+		std::string cache = cache_path("meshes", key, ".cmesh");
+
+		gl_mesh mesh;
+		if (!ec && load_mesh_file(cache, key, mesh)) return mesh;
+
+		mesh_builder mb = load_wavefront_data(filename);
+		mb.optimise(filename);
+		if (!write_mesh_file(cache, mb, key))
+			std::cerr << "Warning: Failed to write mesh cache " << cache << std::endl;
+		return mb.build();
+	}
+
+
+
+	void write_benchmark_wavefront(const std::string &filename, int segments) {
+		CGRA_TRACE_ZONE("write_benchmark_wavefront");
+		segments = std::max(segments, 3);
+		std::ofstream out(filename);
+		if (!out) throw std::runtime_error("Error: could not write " + filename);
+
+		// a torus around y with a ring radius of 1 and a tube radius of 0.4, seams repeated for the uvs
+		const int n = segments + 1;
+		char line[128];
+		for (int i = 0; i < n; i++) {
+			float u = float(i) / float(segments), a = u * 6.2831853f;
+			for (int j = 0; j < n; j++) {
+				float v = float(j) / float(segments), b = v * 6.2831853f;
+				vec3 normal(std::cos(a) * std::cos(b), std::sin(b), std::sin(a) * std::cos(b));
+				vec3 pos = vec3(std::cos(a), 0, std::sin(a)) + 0.4f * normal;
+				std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+					pos.x, pos.y, pos.z, u, v, normal.x, normal.y, normal.z);
+				out << line;
+			}
+		}
+		for (int i = 0; i < segments; i++) {
+			for (int j = 0; j < segments; j++) {
+				int a = i * n + j + 1, b = (i + 1) * n + j + 1;
+				std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, a + 1, a + 1, a + 1, b, b, b);
+				out << line;
+				std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", b, b, b, a + 1, a + 1, a + 1, b + 1, b + 1, b + 1);
+				out << line;
+			}
+		}
+		if (!out) throw std::runtime_error("Error: could not write " + filename);
+	}
+
+
+	bool benchmark_wavefront(const std::string &filename) {
+		CGRA_TRACE_ZONE("benchmark_wavefront");
+		try {
+			if (!std::filesystem::exists(filename)) {
+				std::cout << "OBJ benchmark: writing " << filename << std::endl;
+				write_benchmark_wavefront(filename);
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			mesh_builder reference = load_wavefront_reference(filename);
+			auto referenced = std::chrono::steady_clock::now();
+			mesh_builder mb = load_wavefront_data(filename);
+			auto loaded = std::chrono::steady_clock::now();
+
+			// the loader welds corners, so compare corner by corner
+			bool same = mb.indices.size() == reference.indices.size();
+			float max_position = 0, max_normal = 0, max_uv = 0;
+			for (size_t i = 0; same && i < mb.indices.size(); i++) {
+				const mesh_vertex &a = mb.vertices[mb.indices[i]], &b = reference.vertices[reference.indices[i]];
+				max_position = std::max(max_position, length(a.pos - b.pos));
+				max_normal = std::max(max_normal, length(a.norm - b.norm));
+				max_uv = std::max(max_uv, length(a.uv - b.uv));
+			}
+
+			int threads = 1;
+#ifdef CGRA_HAVE_OPENMP
+			threads = omp_get_max_threads();
+#endif
+			double reference_ms = std::chrono::duration<double, std::milli>(referenced - start).count();
+			double load_ms = std::chrono::duration<double, std::milli>(loaded - referenced).count();
+			std::cout << "OBJ benchmark " << filename << ": " << (mb.indices.size() / 3) << " triangles, previous loader "
+				<< reference_ms << "ms, load_wavefront_data " << load_ms << "ms (" << (reference_ms / std::max(load_ms, 1e-3))
+				<< "x) on " << threads << " threads" << std::endl;
+			if (!same) {
+				std::cerr << "Warning: OBJ benchmark loaders disagree on the triangle count (" << (reference.indices.size() / 3) << " before)" << std::endl;
+				return false;
+			}
+			std::cout << "OBJ benchmark: largest differences position " << max_position << ", normal " << max_normal << ", uv " << max_uv << std::endl;
+			if (max_position > g_benchmark_epsilon || max_normal > g_benchmark_epsilon || max_uv > g_benchmark_epsilon) {
+				std::cerr << "Warning: OBJ benchmark loaders disagree by more than " << g_benchmark_epsilon << std::endl;
+				return false;
+			}
+			return true;
+		} catch (std::runtime_error &e) {
+			std::cerr << "Warning: OBJ benchmark failed: " << e.what() << std::endl;
+			return false;
+		}
+	}
+}
@@ -10,7 +10,11 @@
 #include <glm/gtc/constants.hpp>
 
 // project
+#include "cgra/cgra_gpu_profiler.hpp"
+#include "cgra/cgra_primitives.hpp"
 #include "cgra/cgra_shader.hpp"
+#include "cgra/cgra_shader_watcher.hpp"
+#include "cgra/cgra_trace.hpp"
 #include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
 #include "matt/pbr.hpp"
@@ -87,6 +91,7 @@ void LavaLamp::initialize(int numBlobs) {
 }
 
 void LavaLamp::update(float deltaTime) {
+	CGRA_TRACE_ZONE("LavaLamp::update");
 	if (deltaTime <= 0.0f) return;
 
 	// Update anchor points (drift over time)
@@ -400,6 +405,7 @@ glm::vec3 LavaLamp::computeDensityGradient(const glm::vec3& point) const {
 }
 
 void LavaLamp::mergeBlobsIfClose() {
+	CGRA_TRACE_ZONE("LavaLamp::mergeBlobsIfClose");
 	for (size_t i = 0; i < m_blobs.size(); ++i) {
 		for (size_t j = i + 1; j < m_blobs.size(); ++j) {
 			float dist = glm::distance(m_blobs[i].position, m_blobs[j].position);
@@ -468,6 +474,7 @@ void LavaLamp::mergeBlobsIfClose() {
 }
 
 void LavaLamp::splitLargeBlobs() {
+	CGRA_TRACE_ZONE("LavaLamp::splitLargeBlobs");
 	// Lower threshold for splitting to counterbalance merging
 	const float maxRadius = 0.85f; // Was 1.0f - split earlier
 	size_t originalSize = m_blobs.size();
@@ -650,11 +657,20 @@ void LavaLamp::ensureDepthFBO(int width, int height) {
 }
 
 void LavaLamp::initialiseLavaLamp(const std::string& shader_vertex_path, const std::string& shader_fragment_path) {
-	// Build lava lamp shader
+	CGRA_TRACE_ZONE("LavaLamp::initialiseLavaLamp");
+
+	// Build lava lamp shader permutations (one branch-free variant per pass)
 	cgra::shader_builder lava_sb;
 	lava_sb.set_shader(GL_VERTEX_SHADER, shader_vertex_path);
 	lava_sb.set_shader(GL_FRAGMENT_SHADER, shader_fragment_path);
-	m_lavaShader = lava_sb.build();
+
+	cgra::shader_defines metaballDefines = { { "RENDER_MODE", "METABALL" }, { "MAX_BLOBS", std::to_string(m_maxBlobs) } };
+	m_lavaShader = lava_sb.build(metaballDefines);
+	cgra::shader_watcher::watch(m_lavaShader, lava_sb, metaballDefines);
+
+	cgra::shader_defines glassDefines = { { "RENDER_MODE", "GLASS" } };
+	m_lavaGlassShader = lava_sb.build(glassDefines);
+	cgra::shader_watcher::watch(m_lavaGlassShader, lava_sb, glassDefines);
 
 	// Initialize the lava lamp simulation with 5 blobs
 	initialize(5);
@@ -673,330 +689,40 @@ void LavaLamp::initialiseLavaLamp(const std::string& shader_vertex_path, const s
 	m_lastTime = static_cast<float>(glfwGetTime());
 
 	// Geometry
-	m_lampGlassMesh = createLampContainerGlass();
-	m_lampMetalMesh = createLampContainerMetal();
-	m_fullscreenQuadMesh = createFullscreenQuad();
+	m_lampGlassLods = createLampContainerGlass();
+	m_lampMetalLods = createLampContainerMetal();
 }
 
-cgra::gl_mesh LavaLamp::createFullscreenQuad() {
-	cgra::mesh_builder builder;
-
-	cgra::mesh_vertex v0, v1, v2, v3;
-	v0.pos = vec3(-1, -1, 0); v0.uv = vec2(0, 0);
-	v1.pos = vec3(1, -1, 0);  v1.uv = vec2(1, 0);
-	v2.pos = vec3(1, 1, 0);   v2.uv = vec2(1, 1);
-	v3.pos = vec3(-1, 1, 0);  v3.uv = vec2(0, 1);
-
-	builder.push_vertex(v0);
-	builder.push_vertex(v1);
-	builder.push_vertex(v2);
-	builder.push_vertex(v3);
-
-	builder.push_index(0); builder.push_index(1); builder.push_index(2);
-	builder.push_index(0); builder.push_index(2); builder.push_index(3);
-
-	return builder.build();
+std::vector<cgra::gl_mesh> LavaLamp::createLampContainerGlass() {
+	// Glass bulb between the metal base and cap, closed at both ends
+	cgra::lathe_builder lathe;
+	lathe.add_profile({ {0.0f, 1.7f}, {1.8f, 1.7f}, {1.0f, 10.0f}, {0.0f, 10.0f} });
+	return buildLampLods(lathe, "lamp glass", false, m_lampGlassBvh);
 }
 
-cgra::gl_mesh LavaLamp::createLampContainerGlass() {
-	cgra::mesh_builder builder;
-	const int segments = 64;
-
-	struct ProfilePoint {
-		float height;
-		float radius;
-	};
-
-	std::vector<ProfilePoint> profile = {
-		{1.7f, 1.8f},
-		{10.0f, 1.0f}
-	};
-
-	std::vector<int> ringStarts;
-	for (size_t p = 0; p < profile.size(); ++p) {
-		ringStarts.push_back(builder.vertices.size());
-		for (int i = 0; i <= segments; ++i) {
-			float angle = 2.0f * pi<float>() * i / segments;
-			float x = profile[p].radius * cos(angle);
-			float z = profile[p].radius * sin(angle);
-			float y = profile[p].height;
-
-			cgra::mesh_vertex v;
-			v.pos = vec3(x, y, z);
-			v.norm = normalize(vec3(x, 0.0f, z));
-			v.uv = vec2(float(i) / segments, float(p) / (profile.size() - 1));
-			builder.push_vertex(v);
-		}
-	}
+std::vector<cgra::gl_mesh> LavaLamp::createLampContainerMetal() {
+	cgra::lathe_builder lathe;
 
-	// Connect the two rings into quads
-	int currentRing = ringStarts[0];
-	int nextRing = ringStarts[1];
-	for (int i = 0; i < segments; ++i) {
-		int curr = currentRing + i;
-		int next = currentRing + i + 1;
-		int currAbove = nextRing + i;
-		int nextAbove = nextRing + i + 1;
-
-		builder.push_index(curr);
-		builder.push_index(currAbove);
-		builder.push_index(next);
-
-		builder.push_index(next);
-		builder.push_index(currAbove);
-		builder.push_index(nextAbove);
-	}
+	// Metal base (flat bottom, tapering up to the waist) and the lower third of the bulb
+	lathe.add_profile({ {0.0f, -1.5f}, {2.5f, -1.5f}, {1.2f, 0.0f}, {1.8f, 1.7f} });
 
-	// Glass bottom cap (at y=1.7f, radius=1.8f)
-	{
-		float capY = 1.7f;
-		float capRadius = 1.8f;
-
-		// Get the index of the first ring (bottom ring of the cylinder)
-		int bottomRingStart = 0; // This should be the first ring created
-
-		// Create center vertex
-		int centerIdx = builder.vertices.size();
-		cgra::mesh_vertex centerVert;
-		centerVert.pos = vec3(0, capY, 0);
-		centerVert.norm = vec3(0, -1, 0);
-		centerVert.uv = vec2(0.5f, 0.5f);
-		builder.push_vertex(centerVert);
-
-		// Create fan triangles from center to ring
-		for (int i = 0; i < segments; ++i) {
-			builder.push_index(centerIdx);
-			builder.push_index(bottomRingStart + i);
-			builder.push_index(bottomRingStart + i + 1);
-		}
-	}
+	// Tapered metal top cap, closed at the top
+	lathe.add_profile({ {1.0f, 10.0f}, {0.8f, 11.0f}, {0.0f, 11.0f} });
 
-	// Glass top cap (at y=10.0f, radius=1.0f)
-	{
-		float capY = 10.0f;
-		float capRadius = 1.0f;
-
-		// The second ring is the top of the cylinder
-		int topRingStart = segments + 1; // Second ring starts after first ring
-
-		// Create center vertex
-		int centerIdx = builder.vertices.size();
-		cgra::mesh_vertex centerVert;
-		centerVert.pos = vec3(0, capY, 0);
-		centerVert.norm = vec3(0, 1, 0);
-		centerVert.uv = vec2(0.5f, 0.5f);
-		builder.push_vertex(centerVert);
-
-		// Create fan triangles from center to ring
-		for (int i = 0; i < segments; ++i) {
-			builder.push_index(centerIdx);
-			builder.push_index(topRingStart + i + 1);
-			builder.push_index(topRingStart + i);
-		}
-	}
-
-	return builder.build();
+	return buildLampLods(lathe, "lamp metal", true, m_lampMetalBvh); // drawn with the pbr shader
 }
 
-cgra::gl_mesh LavaLamp::createLampContainerMetal() {
-	cgra::mesh_builder builder;
-	const int segments = 64;
-
-	// Lower third of bulb (metal)
-	{
-		struct ProfilePoint {
-			float height;
-			float radius;
-		};
-
-		std::vector<ProfilePoint> lowerBulb = {
-			{0.0f, 1.2f},
-			{1.7f, 1.8f}
-		};
-
-		std::vector<int> ringStarts;
-		for (size_t p = 0; p < lowerBulb.size(); ++p) {
-			ringStarts.push_back(builder.vertices.size());
-			for (int i = 0; i <= segments; ++i) {
-				float angle = 2.0f * pi<float>() * i / segments;
-				float x = lowerBulb[p].radius * cos(angle);
-				float z = lowerBulb[p].radius * sin(angle);
-				float y = lowerBulb[p].height;
-
-				cgra::mesh_vertex v;
-				v.pos = vec3(x, y, z);
-				v.norm = normalize(vec3(x, 0.0f, z));
-				v.uv = vec2(float(i) / segments, float(p) / (lowerBulb.size() - 1));
-				builder.push_vertex(v);
-			}
-		}
-
-		for (size_t p = 0; p < lowerBulb.size() - 1; ++p) {
-			int currentRing = ringStarts[p];
-			int nextRing = ringStarts[p + 1];
-			for (int i = 0; i < segments; ++i) {
-				int curr = currentRing + i;
-				int next = currentRing + i + 1;
-				int currAbove = nextRing + i;
-				int nextAbove = nextRing + i + 1;
-
-				builder.push_index(curr);
-				builder.push_index(currAbove);
-				builder.push_index(next);
-
-				builder.push_index(next);
-				builder.push_index(currAbove);
-				builder.push_index(nextAbove);
-			}
-		}
-	}
-
-	// Metal top cap
-	{
-		float capBottomY = 10.0f;
-		float capTopY = 11.0f;
-		float capRadiusBottom = 1.0f;
-		float capRadiusTop = 0.8f;
-		int capStart = builder.vertices.size();
-
-		// Calculate proper surface normal accounting for the taper
-		float radiusDiff = capRadiusBottom - capRadiusTop;
-		float height = capTopY - capBottomY;
-		vec3 slopeDir = normalize(vec3(radiusDiff, height, 0));
-
-		for (int i = 0; i <= segments; ++i) {
-			float angle = 2.0f * pi<float>() * i / segments;
-			float x1 = capRadiusBottom * cos(angle);
-			float z1 = capRadiusBottom * sin(angle);
-			float x2 = capRadiusTop * cos(angle);
-			float z2 = capRadiusTop * sin(angle);
-
-			// Calculate normal for tapered surface
-			vec3 radialDir = normalize(vec3(cos(angle), 0, sin(angle)));
-			vec3 surfaceNormal = normalize(vec3(
-				radialDir.x * slopeDir.y,
-				slopeDir.x,
-				radialDir.z * slopeDir.y
-			));
-
-			cgra::mesh_vertex v1, v2;
-			v1.pos = vec3(x1, capBottomY, z1);
-			v2.pos = vec3(x2, capTopY, z2);
-			v1.norm = surfaceNormal;
-			v2.norm = surfaceNormal;
-			v1.uv = vec2(float(i) / segments, 0.0f);
-			v2.uv = vec2(float(i) / segments, 1.0f);
-
-			builder.push_vertex(v1);
-			builder.push_vertex(v2);
-		}
-
-		for (int i = 0; i < segments; ++i) {
-			int i0 = capStart + i * 2;
-			int i1 = capStart + i * 2 + 1;
-			int i2 = capStart + (i + 1) * 2;
-			int i3 = capStart + (i + 1) * 2 + 1;
-
-			builder.push_index(i0);
-			builder.push_index(i2);
-			builder.push_index(i1);
-
-			builder.push_index(i1);
-			builder.push_index(i2);
-			builder.push_index(i3);
-		}
-
-		int topCenter = builder.vertices.size();
-		cgra::mesh_vertex vTopCenter;
-		vTopCenter.pos = vec3(0, capTopY, 0);
-		vTopCenter.norm = vec3(0, 1, 0);
-		vTopCenter.uv = vec2(0.5f, 0.5f);
-		builder.push_vertex(vTopCenter);
-
-		for (int i = 0; i < segments; ++i) {
-			int outer0 = capStart + i * 2 + 1;
-			int outer1 = capStart + (i + 1) * 2 + 1;
-			// Reversed winding order for correct front-face orientation
-			builder.push_index(topCenter);
-			builder.push_index(outer1);
-			builder.push_index(outer0);
-		}
-	}
-
-
-	// Metal base
-	{
-		float baseHeight = -1.5f;
-		float baseRadiusBottom = 2.5f;
-		float baseRadiusTop = 1.2f;
-		int baseStart = builder.vertices.size();
-
-		for (int i = 0; i <= segments; ++i) {
-			float angle = 2.0f * pi<float>() * i / segments;
-			float x1 = baseRadiusBottom * cos(angle);
-			float z1 = baseRadiusBottom * sin(angle);
-			float y1 = baseHeight;
-
-			float x2 = baseRadiusTop * cos(angle);
-			float z2 = baseRadiusTop * sin(angle);
-			float y2 = 0.0f;
-
-			cgra::mesh_vertex v1, v2;
-			v1.pos = vec3(x1, y1, z1);
-			v2.pos = vec3(x2, y2, z2);
-			
-			// Calculate surface normal
-			float baseRadiusDiff = baseRadiusBottom - baseRadiusTop;
-			float baseHeight = y2 - y1;
-			vec3 baseSlopeDir = normalize(vec3(baseRadiusDiff, baseHeight, 0));
-			vec3 baseRadialDir = normalize(vec3(cos(angle), 0, sin(angle)));
-			vec3 baseSurfaceNormal = normalize(vec3(
-				baseRadialDir.x * baseSlopeDir.y,
-				baseSlopeDir.x,
-				baseRadialDir.z * baseSlopeDir.y
-			));
-			
-			v1.norm = baseSurfaceNormal;
-			v2.norm = baseSurfaceNormal;
-			v1.uv = vec2(float(i) / segments, 0.0f);
-			v2.uv = vec2(float(i) / segments, 1.0f);
-
-			builder.push_vertex(v1);
-			builder.push_vertex(v2);
-		}
-
-		for (int i = 0; i < segments; ++i) {
-			int i0 = baseStart + i * 2;
-			int i1 = baseStart + i * 2 + 1;
-			int i2 = baseStart + (i + 1) * 2;
-			int i3 = baseStart + (i + 1) * 2 + 1;
-
-			builder.push_index(i0);
-			builder.push_index(i2);
-			builder.push_index(i1);
-
-			builder.push_index(i1);
-			builder.push_index(i2);
-			builder.push_index(i3);
-		}
-
-		int baseBottomCenter = builder.vertices.size();
-		cgra::mesh_vertex baseBottomV;
-		baseBottomV.pos = vec3(0, baseHeight, 0);
-		baseBottomV.norm = vec3(0, -1, 0);
-		baseBottomV.uv = vec2(0.5f, 0.5f);
-		builder.push_vertex(baseBottomV);
-
-		for (int i = 0; i < segments; ++i) {
-			int outer0 = baseStart + i * 2;
-			int outer1 = baseStart + (i + 1) * 2;
-			builder.push_index(baseBottomCenter);
-			builder.push_index(outer1);
-			builder.push_index(outer0);
-		}
+std::vector<cgra::gl_mesh> LavaLamp::buildLampLods(const cgra::lathe_builder& lathe, const std::string& name, bool tangents, cgra::triangle_bvh& bvh) {
+	std::vector<cgra::mesh_builder> builders = lathe.build(m_lampLodTolerances);
+	bvh = cgra::triangle_bvh(builders[0]);
+	std::vector<cgra::gl_mesh> lods;
+	for (size_t i = 0; i < builders.size(); ++i) {
+		if (tangents) builders[i].generate_tangents();
+		builders[i].format = cgra::vertex_format::packed;
+		builders[i].optimise(name + " LOD " + std::to_string(i));
+		lods.push_back(builders[i].build());
 	}
-
-	return builder.build();
+	return lods;
 }
 
 // The main rendering function, previously Application::renderLavaLamp
@@ -1005,6 +731,7 @@ void LavaLamp::renderLavaLamp(const glm::mat4& view, const glm::mat4& proj, GLFW
 	float heaterTemp, float gravity)
 {
 	if (!show) return;
+	CGRA_TRACE_ZONE("LavaLamp::renderLavaLamp");
 
 	// Save current state
 	GLboolean depthMask;
@@ -1029,70 +756,84 @@ void LavaLamp::renderLavaLamp(const glm::mat4& view, const glm::mat4& proj, GLFW
 		update(deltaTime);
 	}
 
-	glUseProgram(m_lavaShader);
-
-	// Set up matrices
+	// Per-frame values shared by every pass
 	mat4 model = mat4(1.0f);
 	mat4 modelView = view * model;
 	mat4 normalMatrix = transpose(inverse(model));
-	glUniformMatrix4fv(glGetUniformLocation(m_lavaShader, "uProjectionMatrix"), 1, GL_FALSE, value_ptr(proj));
-	glUniformMatrix4fv(glGetUniformLocation(m_lavaShader, "uModelViewMatrix"), 1, GL_FALSE, value_ptr(modelView));
-	glUniformMatrix4fv(glGetUniformLocation(m_lavaShader, "uModelMatrix"), 1, GL_FALSE, value_ptr(model));
-	glUniformMatrix4fv(glGetUniformLocation(m_lavaShader, "uNormalMatrix"), 1, GL_FALSE, value_ptr(normalMatrix));
-	glUniformMatrix4fv(glGetUniformLocation(m_lavaShader, "uViewMatrix"), 1, GL_FALSE, value_ptr(view));
-
-	// Pass inverse matrices for raymarching
 	mat4 invProj = inverse(proj);
 	mat4 invView = inverse(view);
-	glUniformMatrix4fv(glGetUniformLocation(m_lavaShader, "uInvProjectionMatrix"), 1, GL_FALSE, value_ptr(invProj));
-	glUniformMatrix4fv(glGetUniformLocation(m_lavaShader, "uInvViewMatrix"), 1, GL_FALSE, value_ptr(invView));
-
-	// Set time uniform
-	glUniform1f(glGetUniformLocation(m_lavaShader, "uTime"), static_cast<float>(glfwGetTime()));
-
-	// Set camera position (world-space)
 	vec3 cameraPos = vec3(inverse(view) * vec4(0, 0, 0, 1));
-	glUniform3fv(glGetUniformLocation(m_lavaShader, "uCameraPos"), 1, value_ptr(cameraPos));
-
-	// Pass framebuffer resolution
 	m_windowsize = vec2(width, height);
-	glUniform2fv(glGetUniformLocation(m_lavaShader, "uResolution"), 1, value_ptr(m_windowsize));
-
-	// Lamp parameters (use simulation getters so geometry + sim match)
-	glUniform1f(glGetUniformLocation(m_lavaShader, "uLampRadius"), getRadius());
-	glUniform1f(glGetUniformLocation(m_lavaShader, "uLampTopRadius"), 1.0f);
-	glUniform1f(glGetUniformLocation(m_lavaShader, "uLampHeight"), getHeight());
-	glUniform1f(glGetUniformLocation(m_lavaShader, "uThreshold"), threshold);
-
-	// Radius padding (small safety margin)
-	GLint locPad = glGetUniformLocation(m_lavaShader, "uRadiusPadding");
-	if (locPad != -1) {
-		float padding = glm::max(0.02f, 0.02f * getRadius());
-		glUniform1f(locPad, padding + 0.02f);
-	}
 
-	// Lighting
+	// Lamp level of detail, the coarsest whose error stays under half a pixel at the lamp's distance
+	float lampDistance = length(cameraPos - vec3(model * vec4(0.0f, 4.75f, 0.0f, 1.0f)));
+	size_t lod = cgra::select_lod(m_lampLodTolerances, cgra::screen_space_tolerance(0.5f, lampDistance, proj, float(height)));
+	cgra::gl_mesh& lampGlassMesh = m_lampGlassLods[lod];
+	cgra::gl_mesh& lampMetalMesh = m_lampMetalLods[lod];
+
 	vec3 lightPos = vec3(5.0f, 15.0f, 5.0f);
 	vec3 lightColor = vec3(1.0f, 1.0f, 1.0f);
 	vec3 ambientColor = vec3(0.2f, 0.1f, 0.1f);
-	glUniform3fv(glGetUniformLocation(m_lavaShader, "uLightPos"), 1, value_ptr(lightPos));
-	glUniform3fv(glGetUniformLocation(m_lavaShader, "uLightColor"), 1, value_ptr(lightColor));
-	glUniform3fv(glGetUniformLocation(m_lavaShader, "uAmbientColor"), 1, value_ptr(ambientColor));
 
-	// Blob data
 	auto positions = getBlobPositions();
 	auto radii = getBlobRadii();
 	auto blobbiness = getBlobBlobbiness();
 	auto colors = getBlobColors();
 	int blobCount = getBlobCount();
 
-	glUniform1i(glGetUniformLocation(m_lavaShader, "uBlobCount"), blobCount);
-	if (blobCount > 0) {
-		int count = std::min(blobCount, 16);
-		glUniform4fv(glGetUniformLocation(m_lavaShader, "uBlobPositions"), count, value_ptr(positions[0]));
-		glUniform1fv(glGetUniformLocation(m_lavaShader, "uBlobRadii"), count, radii.data());
-		glUniform1fv(glGetUniformLocation(m_lavaShader, "uBlobBlobbiness"), count, blobbiness.data());
-		glUniform3fv(glGetUniformLocation(m_lavaShader, "uBlobColors"), count, value_ptr(colors[0]));
+	// Each pass has its own program, uniforms a pass does not use have location -1 and are ignored
+	// (the metaball program is last, so it is left bound for pass 1)
+	for (GLuint shader : { m_lavaGlassShader, m_lavaShader }) {
+		glUseProgram(shader);
+
+		// Set up matrices (the glass mesh has packed positions, which its position transform maps back to model space)
+		mat4 positionTransform = shader == m_lavaGlassShader ? lampGlassMesh.position_transform : mat4(1.0f);
+		glUniformMatrix4fv(cgra::uniform_location(shader, "uProjectionMatrix"), 1, GL_FALSE, value_ptr(proj));
+		glUniformMatrix4fv(cgra::uniform_location(shader, "uModelViewMatrix"), 1, GL_FALSE, value_ptr(modelView * positionTransform));
+		glUniformMatrix4fv(cgra::uniform_location(shader, "uModelMatrix"), 1, GL_FALSE, value_ptr(model * positionTransform));
+		glUniformMatrix4fv(cgra::uniform_location(shader, "uNormalMatrix"), 1, GL_FALSE, value_ptr(normalMatrix));
+		glUniformMatrix4fv(cgra::uniform_location(shader, "uViewMatrix"), 1, GL_FALSE, value_ptr(view));
+
+		// Pass inverse matrices for raymarching
+		glUniformMatrix4fv(cgra::uniform_location(shader, "uInvProjectionMatrix"), 1, GL_FALSE, value_ptr(invProj));
+		glUniformMatrix4fv(cgra::uniform_location(shader, "uInvViewMatrix"), 1, GL_FALSE, value_ptr(invView));
+
+		// Set time uniform
+		glUniform1f(cgra::uniform_location(shader, "uTime"), static_cast<float>(glfwGetTime()));
+
+		// Set camera position (world-space)
+		glUniform3fv(cgra::uniform_location(shader, "uCameraPos"), 1, value_ptr(cameraPos));
+
+		// Pass framebuffer resolution
+		glUniform2fv(cgra::uniform_location(shader, "uResolution"), 1, value_ptr(m_windowsize));
+
+		// Lamp parameters (use simulation getters so geometry + sim match)
+		glUniform1f(cgra::uniform_location(shader, "uLampRadius"), getRadius());
+		glUniform1f(cgra::uniform_location(shader, "uLampTopRadius"), 1.0f);
+		glUniform1f(cgra::uniform_location(shader, "uLampHeight"), getHeight());
+		glUniform1f(cgra::uniform_location(shader, "uThreshold"), threshold);
+
+		// Radius padding (small safety margin)
+		GLint locPad = cgra::uniform_location(shader, "uRadiusPadding");
+		if (locPad != -1) {
+			float padding = glm::max(0.02f, 0.02f * getRadius());
+			glUniform1f(locPad, padding + 0.02f);
+		}
+
+		// Lighting
+		glUniform3fv(cgra::uniform_location(shader, "uLightPos"), 1, value_ptr(lightPos));
+		glUniform3fv(cgra::uniform_location(shader, "uLightColor"), 1, value_ptr(lightColor));
+		glUniform3fv(cgra::uniform_location(shader, "uAmbientColor"), 1, value_ptr(ambientColor));
+
+		// Blob data
+		glUniform1i(cgra::uniform_location(shader, "uBlobCount"), blobCount);
+		if (blobCount > 0) {
+			int count = std::min(blobCount, m_maxBlobs);
+			glUniform4fv(cgra::uniform_location(shader, "uBlobPositions"), count, value_ptr(positions[0]));
+			glUniform1fv(cgra::uniform_location(shader, "uBlobRadii"), count, radii.data());
+			glUniform1fv(cgra::uniform_location(shader, "uBlobBlobbiness"), count, blobbiness.data());
+			glUniform3fv(cgra::uniform_location(shader, "uBlobColors"), count, value_ptr(colors[0]));
+		}
 	}
 
 	// PASS 1: Metaball raymarching
@@ -1100,14 +841,13 @@ void LavaLamp::renderLavaLamp(const glm::mat4& view, const glm::mat4& proj, GLFW
 	glDepthFunc(GL_LESS);
 	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
-	glUniform1i(glGetUniformLocation(m_lavaShader, "uRenderMode"), 1);
-	glUniform1i(glGetUniformLocation(m_lavaShader, "uIsFullscreenQuad"), 1);
-
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, 0);
 
-	m_fullscreenQuadMesh.draw();
-	glUniform1i(glGetUniformLocation(m_lavaShader, "uIsFullscreenQuad"), 0);
+	{
+		cgra::gpu_profiler::scope pass("Metaball raymarch");
+		cgra::quad_mesh().draw();
+	}
 
 	// PASS 2: Glass
 	glEnable(GL_BLEND);
@@ -1115,19 +855,19 @@ void LavaLamp::renderLavaLamp(const glm::mat4& view, const glm::mat4& proj, GLFW
 	glDepthMask(GL_FALSE);
 	glDepthFunc(GL_LESS);
 
-	glUniform1i(glGetUniformLocation(m_lavaShader, "uRenderMode"), 0);
-	m_lampGlassMesh.draw();
+	glUseProgram(m_lavaGlassShader);
+	{
+		cgra::gpu_profiler::scope pass("Glass");
+		lampGlassMesh.draw();
+	}
 
 	// PASS 3: Metal with PBR
 	glDisable(GL_BLEND);
 	glDepthMask(GL_TRUE);
 	glDepthFunc(GL_LESS);
 
-	// Switch to PBR shader for metal parts
-	glUseProgram(m_pbr_shader);
-	glUniformMatrix4fv(glGetUniformLocation(m_pbr_shader, "projection"), 1, GL_FALSE, value_ptr(proj));
-	glUniformMatrix4fv(glGetUniformLocation(m_pbr_shader, "view"), 1, GL_FALSE, value_ptr(view));
-	glUniform3fv(glGetUniformLocation(m_pbr_shader, "camPos"), 1, value_ptr(cameraPos));
+	// Camera for the PBR shaders used for metal parts
+	setPBRCamera(view, proj, cameraPos);
 
 	// Bind IBL data
 	glActiveTexture(GL_TEXTURE0);
@@ -1140,13 +880,15 @@ void LavaLamp::renderLavaLamp(const glm::mat4& view, const glm::mat4& proj, GLFW
 	// Bind gold PBR textures
 	bindPBRTextures(plastic);
 
-	// Set model matrix for lamp metal
+	// Switch to the PBR shader for the lamp metal's vertices, with its model matrix
 	mat4 metalModel = mat4(1.0f);
-	glUniformMatrix4fv(glGetUniformLocation(m_pbr_shader, "model"), 1, GL_FALSE, value_ptr(metalModel));
-	glUniformMatrix3fv(glGetUniformLocation(m_pbr_shader, "normalMatrix"), 1, GL_FALSE, value_ptr(glm::transpose(glm::inverse(glm::mat3(metalModel)))));
+	usePBRShader(lampMetalMesh, metalModel);
 
 	// Draw metal parts with PBR shader
-	m_lampMetalMesh.draw();
+	{
+		cgra::gpu_profiler::scope pass("PBR metal");
+		lampMetalMesh.draw();
+	}
 
 	// Switch back to lava shader
 	glUseProgram(m_lavaShader);
@@ -6,8 +6,11 @@
 // std
 #include <vector>
 #include <random>
+#include <string>
 
 // project
+#include "cgra/cgra_bvh.hpp"
+#include "cgra/cgra_lathe.hpp"
 #include "cgra/cgra_mesh.hpp"
 
 struct LavaBlob {
@@ -57,15 +60,22 @@ private:
 	std::uniform_real_distribution<float> m_randomDist;
 
 	//Rendering Resources
-	GLuint m_lavaShader = 0;
+	GLuint m_lavaShader = 0;       // metaball raymarching permutation
+	GLuint m_lavaGlassShader = 0;  // glass permutation
+	int m_maxBlobs = 16;           // MAX_BLOBS the metaball permutation is built with
 	GLuint m_depthFBO = 0;
 	GLuint m_depthTextureFront = 0; // depth from front faces
 	GLuint m_depthTextureBack = 0;  // depth from back faces
 	int m_depthTexW = 0, m_depthTexH = 0;
 
-	cgra::gl_mesh m_lampGlassMesh;
-	cgra::gl_mesh m_lampMetalMesh;
-	cgra::gl_mesh m_fullscreenQuadMesh;
+	// Lamp container levels of detail, finest first, tessellated to these tolerances (model units).
+	// They are not a cgra::gl_mesh_lods: each level's error is known from its tolerance, so cgra::select_lod
+	// can switch at a fixed error in pixels rather than guessing from the lamp's size on screen
+	std::vector<float> m_lampLodTolerances = { 0.003f, 0.012f, 0.05f };
+	std::vector<cgra::gl_mesh> m_lampGlassLods;
+	std::vector<cgra::gl_mesh> m_lampMetalLods;
+	cgra::triangle_bvh m_lampGlassBvh; // of the finest level, for picking
+	cgra::triangle_bvh m_lampMetalBvh;
 
 	float m_lastTime = 0.0f;
 	glm::vec2 m_windowsize = glm::vec2(1280, 720);
@@ -126,9 +136,13 @@ public:
 
 	void ensureDepthFBO(int width, int height);
 	void initialiseLavaLamp(const std::string& shader_vertex_path, const std::string& shader_fragment_path);
-	cgra::gl_mesh createFullscreenQuad();
-	cgra::gl_mesh createLampContainerGlass();
-	cgra::gl_mesh createLampContainerMetal();
+	std::vector<cgra::gl_mesh> createLampContainerGlass();
+	std::vector<cgra::gl_mesh> createLampContainerMetal();
+	std::vector<cgra::gl_mesh> buildLampLods(const cgra::lathe_builder& lathe, const std::string& name, bool tangents, cgra::triangle_bvh& bvh);
+
+	// lamp container triangles in model space (the lamp is drawn with an identity model matrix)
+	const cgra::triangle_bvh& getGlassBvh() const { return m_lampGlassBvh; }
+	const cgra::triangle_bvh& getMetalBvh() const { return m_lampMetalBvh; }
 
 	void renderLavaLamp(const glm::mat4& view, const glm::mat4& proj, GLFWwindow* window,
 		bool animate, bool show, float threshold,
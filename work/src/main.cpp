@@ -1,5 +1,7 @@
 
 // std
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <stdexcept>
@@ -7,7 +9,15 @@
 // project
 #include "application.hpp"
 #include "opengl.hpp"
+#include "cgra/cgra_bvh.hpp"
 #include "cgra/cgra_gui.hpp"
+#include "cgra/cgra_gpu_profiler.hpp"
+#include "cgra/cgra_primitives.hpp"
+#include "cgra/cgra_shader.hpp"
+#include "cgra/cgra_shader_watcher.hpp"
+#include "cgra/cgra_simplify.hpp"
+#include "cgra/cgra_trace.hpp"
+#include "cgra/cgra_wavefront.hpp"
 
 
 using namespace std;
@@ -33,6 +43,20 @@ namespace {
 // 
 int main() {
 
+	// CPU trace recording can be enabled from startup (to capture loading)
+	// by setting the CGRA_TRACE environment variable
+	cgra::trace::set_thread_name("main");
+	if (getenv("CGRA_TRACE")) cgra::trace::set_enabled(true);
+
+	// setting CGRA_BVH_BENCHMARK to an OBJ file times ray casts against its BVH before starting
+	if (const char *obj = getenv("CGRA_BVH_BENCHMARK")) cgra::benchmark_bvh(obj);
+
+	// setting CGRA_OBJ_BENCHMARK to an OBJ file times loading it against the previous loader (a large torus is written there if it doesn't exist)
+	if (const char *obj = getenv("CGRA_OBJ_BENCHMARK")) cgra::benchmark_wavefront(obj);
+
+	// setting CGRA_LOD_REPORT to an OBJ file (or "sphere") prints the triangles and Hausdorff error of each level the simplifier makes
+	if (const char *obj = getenv("CGRA_LOD_REPORT")) cgra::report_lods(std::string(obj));
+
 	// initialize the GLFW library
 	if (!glfwInit()) {
 		cerr << "Error: Could not initialize GLFW" << endl;
@@ -112,12 +136,25 @@ int main() {
 
 	
 	// create the application object (and a global pointer to it)
+	auto startup_begin = chrono::steady_clock::now();
 	Application application(window);
 	application_ptr = &application;
 
+	// report startup cost, compare a cold run (empty res/cache) against a warm one
+	const cgra::program_cache_stats &cache_stats = cgra::program_cache_statistics();
+	cout << "Startup took " << chrono::duration<double, milli>(chrono::steady_clock::now() - startup_begin).count() << "ms ("
+		<< cache_stats.hits << " cached programs, " << cache_stats.misses << " compiled, "
+		<< cache_stats.build_ms << "ms building shaders)" << endl;
+
 	// loop until the user closes the window
 	while (!glfwWindowShouldClose(window)) {
 
+		// relink any shader programs whose source files have been saved
+		cgra::shader_watcher::poll();
+
+		// start timing the frame (collects timings from earlier frames)
+		cgra::gpu_profiler::begin_frame();
+
 		// main Render
 		//glEnable(GL_FRAMEBUFFER_SRGB); // use if you know about gamma correction
 		application.render();
@@ -126,7 +163,11 @@ int main() {
 		//glDisable(GL_FRAMEBUFFER_SRGB); // use if you know about gamma correction
 		cgra::gui::newFrame();
 		application.renderGUI();
-		cgra::gui::render();
+		{
+			cgra::gpu_profiler::scope pass("ImGui");
+			cgra::gui::render();
+		}
+		cgra::gpu_profiler::end_frame();
 
 		// swap front and back buffers
 		glfwSwapBuffers(window);
@@ -135,6 +176,9 @@ int main() {
 		glfwPollEvents();
 	}
 
+	// free the shared meshes while the context is still current
+	cgra::destroy_primitives();
+
 	// clean up ImGui
 	cgra::gui::shutdown();
 	glfwTerminate();
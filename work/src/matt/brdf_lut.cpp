@@ -0,0 +1,215 @@
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+// sse2
+#include <emmintrin.h>
+
+#include "cgra/cgra_cache.hpp"
+#include "cgra/cgra_trace.hpp"
+#include "matt/brdf_lut.hpp"
+#ifndef CGRA_NO_GL
+#include "matt/render_utils.hpp"
+#endif
+
+namespace {
+	const float PI = 3.14159265359f;
+
+	// http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
+	float radicalInverse(uint32_t bits) {
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return float(bits) * 2.3283064365386963e-10f;
+	}
+
+	float horizontalSum(__m128 v) {
+		__m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 sums = _mm_add_ps(v, shuf);
+		shuf = _mm_movehl_ps(shuf, sums);
+		return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+	}
+
+	// IntegrateBRDF from brdf.fs, four samples at a time. with N = (0,0,1) the
+	// tangent frame is fixed, so the sampled half vector in world space is
+	// H = (sin(phi) sin(theta), -cos(phi) sin(theta), cos(theta)) and V has no y
+	// component, which leaves only sin(phi) and Xi.y per sample
+	void integrateBRDF(float NdotV, float roughness, const float* sinPhi, const float* xiY, int samples, float* out) {
+		float a = roughness * roughness;
+		float k = a / 2.0f; // GeometrySchlickGGX for IBL
+		float ggxV = NdotV / (NdotV * (1.0f - k) + k);
+
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 a2m1 = _mm_set1_ps(a * a - 1.0f);
+		const __m128 vx = _mm_set1_ps(std::sqrt(1.0f - NdotV * NdotV));
+		const __m128 vz = _mm_set1_ps(NdotV);
+		const __m128 oneMinusK = _mm_set1_ps(1.0f - k);
+		const __m128 kk = _mm_set1_ps(k);
+		const __m128 ggxVOverNdotV = _mm_set1_ps(ggxV / NdotV);
+
+		__m128 sumA = zero;
+		__m128 sumB = zero;
+		for (int i = 0; i < samples; i += 4) {
+			__m128 xi = _mm_loadu_ps(xiY + i);
+			__m128 cosTheta = _mm_sqrt_ps(_mm_div_ps(_mm_sub_ps(one, xi), _mm_add_ps(one, _mm_mul_ps(a2m1, xi))));
+			__m128 sinTheta = _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(one, _mm_mul_ps(cosTheta, cosTheta))));
+			__m128 hx = _mm_mul_ps(_mm_loadu_ps(sinPhi + i), sinTheta);
+			__m128 hz = cosTheta;
+
+			__m128 VdotH = _mm_add_ps(_mm_mul_ps(vx, hx), _mm_mul_ps(vz, hz));
+			__m128 lz = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(VdotH, VdotH), hz), vz);
+
+			__m128 NdotL = _mm_max_ps(lz, zero);
+			__m128 NdotH = _mm_max_ps(hz, zero);
+			VdotH = _mm_max_ps(VdotH, zero);
+			__m128 mask = _mm_cmpgt_ps(NdotL, zero);
+
+			// G_Vis = G * VdotH / (NdotH * NdotV)
+			__m128 ggxL = _mm_div_ps(NdotL, _mm_add_ps(_mm_mul_ps(NdotL, oneMinusK), kk));
+			__m128 gVis = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(ggxL, ggxVOverNdotV), VdotH), NdotH);
+
+			// Fc = (1 - VdotH)^5
+			__m128 f = _mm_sub_ps(one, VdotH);
+			__m128 f2 = _mm_mul_ps(f, f);
+			__m128 fc = _mm_mul_ps(_mm_mul_ps(f2, f2), f);
+
+			sumA = _mm_add_ps(sumA, _mm_and_ps(mask, _mm_mul_ps(_mm_sub_ps(one, fc), gVis)));
+			sumB = _mm_add_ps(sumB, _mm_and_ps(mask, _mm_mul_ps(fc, gVis)));
+		}
+
+		out[0] = horizontalSum(sumA) / float(samples);
+		out[1] = horizontalSum(sumB) / float(samples);
+	}
+
+	std::string cacheFile(int size, int samples) {
+		std::string key = "brdf_lut v1 " + std::to_string(size) + " " + std::to_string(samples);
+		return cgra::cache_path("brdf", cgra::hash_string(key), ".lut");
+	}
+
+#ifndef CGRA_NO_GL
+	// loads the LUT from res/cache, computing and saving it if needed
+	std::vector<float> cachedBRDFLUT(int size, int samples, bool* computed) {
+		std::vector<char> data;
+		std::vector<float> lut(size_t(size) * size * 2);
+		if (cgra::read_binary_file(cacheFile(size, samples), data) && data.size() == lut.size() * sizeof(float)) {
+			std::copy(data.begin(), data.end(), reinterpret_cast<char*>(lut.data()));
+			if (computed) *computed = false;
+			return lut;
+		}
+
+		lut = computeBRDFLUT(size, samples);
+		saveBRDFLUT(lut, size, samples);
+		if (computed) *computed = true;
+		return lut;
+	}
+#endif
+}
+
+std::vector<float> computeBRDFLUT(int size, int samples) {
+	CGRA_TRACE_ZONE("computeBRDFLUT");
+	auto start = std::chrono::steady_clock::now();
+
+	// the sample sequence is the same for every texel (rounded up to whole SSE lanes)
+	samples = (samples + 3) / 4 * 4;
+	std::vector<float> sinPhi(samples);
+	std::vector<float> xiY(samples);
+	for (int i = 0; i < samples; i++) {
+		sinPhi[i] = std::sin(2.0f * PI * float(i) / float(samples));
+		xiY[i] = radicalInverse(uint32_t(i));
+	}
+
+	// rows are roughness, columns NdotV (row 0 is the bottom of the texture)
+	std::vector<float> lut(size_t(size) * size * 2);
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int y = 0; y < size; y++) {
+		float roughness = (float(y) + 0.5f) / float(size);
+		for (int x = 0; x < size; x++) {
+			float NdotV = (float(x) + 0.5f) / float(size);
+			integrateBRDF(NdotV, roughness, sinPhi.data(), xiY.data(), samples, &lut[(size_t(y) * size + x) * 2]);
+		}
+	}
+
+	std::cout << "Computed " << size << "x" << size << " BRDF LUT in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << "ms" << std::endl;
+	return lut;
+}
+
+void saveBRDFLUT(const std::vector<float>& lut, int size, int samples) {
+	if (!cgra::write_binary_file(cacheFile(size, samples), lut.data(), lut.size() * sizeof(float)))
+		std::cout << "Failed to write BRDF LUT " << cacheFile(size, samples) << std::endl;
+}
+
+#ifndef CGRA_NO_GL
+
+GLuint loadBRDFLUT(int size, bool* baked) {
+	CGRA_TRACE_ZONE("loadBRDFLUT");
+	std::vector<float> lut = cachedBRDFLUT(size, 1024, baked);
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, size, size, 0, GL_RG, GL_FLOAT, lut.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return texture;
+}
+
+float validateBRDFLUT(GLuint brdfShader, int size) {
+	CGRA_TRACE_ZONE("validateBRDFLUT");
+
+	GLint lastFramebuffer;
+	GLint lastViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &lastFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, lastViewport);
+
+	// render the GPU version at full float precision
+	GLuint texture, fbo;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, size, size, 0, GL_RG, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+	glViewport(0, 0, size, size);
+	glUseProgram(brdfShader);
+	glDisable(GL_DEPTH_TEST);
+	renderQuad();
+	glEnable(GL_DEPTH_TEST);
+
+	std::vector<float> gpu(size_t(size) * size * 2);
+	glReadPixels(0, 0, size, size, GL_RG, GL_FLOAT, gpu.data());
+
+	glBindFramebuffer(GL_FRAMEBUFFER, lastFramebuffer);
+	glViewport(lastViewport[0], lastViewport[1], lastViewport[2], lastViewport[3]);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &texture);
+
+	// the baked table (read back from res/cache rather than integrated a second time)
+	std::vector<float> cpu = cachedBRDFLUT(size, 1024, nullptr);
+	float maxError = 0.0f;
+	double sumError = 0.0;
+	for (size_t i = 0; i < cpu.size(); i++) {
+		float error = std::abs(cpu[i] - gpu[i]);
+		maxError = std::max(maxError, error);
+		sumError += error;
+	}
+
+	std::cout << "BRDF LUT CPU vs GPU: max error " << maxError << ", mean error " << (sumError / cpu.size()) << std::endl;
+	return maxError;
+}
+
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+// std
+#include <vector>
+
+// project
+#include "opengl.hpp"
+
+// integrates the split-sum BRDF (same Hammersley/GGX importance sampling as brdf.fs)
+// on the CPU. returns size*size RG pairs, x = NdotV and y = roughness at texel centers
+std::vector<float> computeBRDFLUT(int size = 512, int samples = 1024);
+
+// writes a LUT to res/cache where loadBRDFLUT looks for it
+void saveBRDFLUT(const std::vector<float>& lut, int size, int samples);
+
+// the functions below need a GL context (not built with CGRA_NO_GL)
+
+// returns the RG16F BRDF LUT texture, computed on first use and cached in res/cache.
+// baked (if given) is set to whether it had to be computed this time
+GLuint loadBRDFLUT(int size = 512, bool* baked = nullptr);
+
+// renders the LUT with the brdf.fs shader and compares it against the CPU table,
+// printing the maximum and mean absolute error. returns the maximum error
+float validateBRDFLUT(GLuint brdfShader, int size = 512);
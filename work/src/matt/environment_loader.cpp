@@ -0,0 +1,315 @@
+
+// std
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <vector>
+
+#include "cgra/cgra_hdr.hpp"
+#include "cgra/cgra_trace.hpp"
+#include "matt/environment_loader.hpp"
+#include "matt/environment_manager.hpp"
+#include "matt/ibl_cache.hpp"
+#include "matt/pbr.hpp"
+
+namespace {
+	// reading: decoding the hdr (or reading the cache) on the worker
+	// copying: the worker fills a mapped pixel unpack buffer
+	// uploading: textures are sourced from the buffer, waiting on a fence
+	// downloading: a freshly baked set is read back into a pixel pack buffer
+	// saving: the worker writes the read back maps to the IBL cache
+	enum class loadStage { idle, reading, copying, uploading, downloading, saving };
+
+	struct environmentLoad {
+		loadStage stage = loadStage::idle;
+		std::string hdrPath;
+		std::chrono::steady_clock::time_point start;
+		std::future<void> task;
+
+		// filled in on the worker while reading
+		uint64_t key = 0;
+		bool cached = false;
+		iblBake bake;
+		cgra::hdr_image hdr;
+		shIrradiance irradianceSH;
+
+		GLuint buffer = 0;
+		void* mapped = nullptr;
+		size_t bytes = 0;
+		GLsync fence = nullptr;
+		iblMaps maps;
+	};
+
+	environmentLoad g_load;
+	std::string g_pending;
+	std::string g_latest; // the last requested environment, the one that should end up current
+
+	const GLuint64 fenceTimeout = 100000000; // 100ms, only used when blocking
+
+	// the three cubemaps in the order they are packed into the pixel buffers
+	iblTexture* bakeTextures(iblBake& bake, int i) {
+		iblTexture* textures[] = { &bake.environment, &bake.irradiance, &bake.prefilter };
+		return textures[i];
+	}
+
+	size_t bakeBytes(iblBake& bake) {
+		size_t bytes = 0;
+		for (int i = 0; i < 3; i++) bytes += iblTextureCount(*bakeTextures(bake, i)) * sizeof(uint16_t);
+		return bytes;
+	}
+
+	void readEnvironment(environmentLoad& load) {
+		CGRA_TRACE_ZONE("readEnvironment");
+
+		load.key = iblCacheKey(load.hdrPath, iblBakeParameters(useIrradianceSH));
+		if (load.key && loadIBLCache(load.key, load.bake)) {
+			load.cached = true;
+			load.irradianceSH = load.bake.irradianceSH;
+			return;
+		}
+
+		// straight to half floats, the format of the texture
+		if (cgra::load_hdr(load.hdrPath, load.hdr) && useIrradianceSH) {
+			load.irradianceSH = projectIrradianceSH(load.hdr.pixels.data(), load.hdr.width, load.hdr.height);
+		}
+	}
+
+	void copyEnvironment(environmentLoad& load) {
+		CGRA_TRACE_ZONE("copyEnvironment");
+
+		char* dst = static_cast<char*>(load.mapped);
+		if (!load.cached) {
+			std::memcpy(dst, load.hdr.pixels.data(), load.bytes);
+			std::vector<uint16_t>().swap(load.hdr.pixels); // the size is still needed for the upload
+			return;
+		}
+		for (int i = 0; i < 3; i++) {
+			std::vector<uint16_t>& data = bakeTextures(load.bake, i)->data;
+			std::memcpy(dst, data.data(), data.size() * sizeof(uint16_t));
+			dst += data.size() * sizeof(uint16_t);
+			std::vector<uint16_t>().swap(data);
+		}
+	}
+
+	void saveEnvironment(environmentLoad& load) {
+		CGRA_TRACE_ZONE("saveEnvironment");
+
+		const uint16_t* src = static_cast<const uint16_t*>(load.mapped);
+		for (int i = 0; i < 3; i++) {
+			iblTexture* tex = bakeTextures(load.bake, i);
+			tex->data.assign(src, src + iblTextureCount(*tex));
+			src += tex->data.size();
+		}
+		load.bake.irradianceSH = load.irradianceSH;
+		saveIBLCache(load.key, load.bake);
+		load.bake = iblBake();
+	}
+
+	bool taskReady(environmentLoad& load, bool wait) {
+		if (!wait && load.task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+		load.task.get(); // rethrows anything thrown on the worker
+		return true;
+	}
+
+	bool fenceSignaled(environmentLoad& load, bool wait) {
+		GLenum status = glClientWaitSync(load.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? fenceTimeout : 0);
+		if (status == GL_TIMEOUT_EXPIRED) return false;
+		glDeleteSync(load.fence);
+		load.fence = nullptr;
+		return true;
+	}
+
+	// maps a new pixel buffer and hands it to the worker
+	void mapBuffer(environmentLoad& load, GLenum target, GLbitfield access) {
+		glBindBuffer(target, load.buffer);
+		load.mapped = glMapBufferRange(target, 0, load.bytes, access);
+		glBindBuffer(target, 0);
+	}
+
+	void unmapBuffer(environmentLoad& load, GLenum target) {
+		glBindBuffer(target, load.buffer);
+		glUnmapBuffer(target);
+		glBindBuffer(target, 0);
+		load.mapped = nullptr;
+	}
+
+	void deleteBuffer(environmentLoad& load) {
+		glDeleteBuffers(1, &load.buffer);
+		load.buffer = 0;
+	}
+
+	void startLoad(const std::string& hdrPath) {
+		g_load = environmentLoad();
+		g_load.hdrPath = hdrPath;
+		g_load.start = std::chrono::steady_clock::now();
+		g_load.stage = loadStage::reading;
+		g_load.task = std::async(std::launch::async, readEnvironment, std::ref(g_load));
+	}
+
+	void finishRead() {
+		if (!g_load.cached && g_load.hdr.pixels.empty()) {
+			std::cout << "Failed to load HDR image " << g_load.hdrPath << std::endl;
+			g_load.stage = loadStage::idle;
+			return;
+		}
+
+		g_load.bytes = g_load.cached ? bakeBytes(g_load.bake) : g_load.hdr.pixels.size() * sizeof(uint16_t);
+		glGenBuffers(1, &g_load.buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_load.buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, g_load.bytes, nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		mapBuffer(g_load, GL_PIXEL_UNPACK_BUFFER, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+		g_load.stage = loadStage::copying;
+		g_load.task = std::async(std::launch::async, copyEnvironment, std::ref(g_load));
+	}
+
+	void finishCopy() {
+		CGRA_TRACE_ZONE("uploadEnvironment");
+		unmapBuffer(g_load, GL_PIXEL_UNPACK_BUFFER);
+
+		// with the buffer bound the pixel pointers are offsets into it
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, g_load.buffer);
+		if (g_load.cached) {
+			size_t offset = 0;
+			GLuint* textures[] = { &g_load.maps.environment, &g_load.maps.irradiance, &g_load.maps.prefilter };
+			for (int i = 0; i < 3; i++) {
+				const iblTexture* tex = bakeTextures(g_load.bake, i);
+				if (tex->levels) *textures[i] = uploadIBLTexture(*tex, reinterpret_cast<const void*>(offset));
+				offset += iblTextureCount(*tex) * sizeof(uint16_t);
+			}
+		}
+		else {
+			// rows of RGB half floats are only 4 byte aligned for even widths
+			GLint unpackAlignment;
+			glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glGenTextures(1, &g_load.maps.hdr);
+			glBindTexture(GL_TEXTURE_2D, g_load.maps.hdr);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, g_load.hdr.width, g_load.hdr.height, 0, GL_RGB, GL_HALF_FLOAT, nullptr);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		g_load.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		g_load.stage = loadStage::uploading;
+	}
+
+	// issues the read back of freshly baked maps for the next time this environment is loaded
+	void startDownload() {
+		CGRA_TRACE_ZONE("downloadEnvironment");
+		g_load.bake.environment = iblTextureLayout(GL_TEXTURE_CUBE_MAP, GL_RGB16F, GL_RGB, 1024, 11);
+		if (g_load.maps.irradiance) g_load.bake.irradiance = iblTextureLayout(GL_TEXTURE_CUBE_MAP, GL_RGB16F, GL_RGB, 32, 1);
+		g_load.bake.prefilter = iblTextureLayout(GL_TEXTURE_CUBE_MAP, GL_RGB16F, GL_RGB, 256, 5);
+		g_load.bytes = bakeBytes(g_load.bake);
+
+		glGenBuffers(1, &g_load.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, g_load.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, g_load.bytes, nullptr, GL_STREAM_READ);
+		size_t offset = 0;
+		GLuint textures[] = { g_load.maps.environment, g_load.maps.irradiance, g_load.maps.prefilter };
+		for (int i = 0; i < 3; i++) {
+			const iblTexture* tex = bakeTextures(g_load.bake, i);
+			if (tex->levels) readIBLTexture(textures[i], *tex, reinterpret_cast<void*>(offset));
+			offset += iblTextureCount(*tex) * sizeof(uint16_t);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		g_load.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		g_load.stage = loadStage::downloading;
+	}
+
+	void finishUpload() {
+		deleteBuffer(g_load);
+		g_load.maps.irradianceSH = g_load.irradianceSH;
+		g_load.stage = loadStage::idle;
+
+		if (!g_load.cached) {
+			bakeEnvironment(g_load.maps);
+			// the equirectangular source isn't needed once baked, so it isn't kept resident
+			glDeleteTextures(1, &g_load.maps.hdr);
+			g_load.maps.hdr = 0;
+			// before the manager owns the maps, which could evict them straight away
+			if (g_load.key) startDownload();
+		}
+
+		// the user may have switched to a resident environment in the meantime
+		addResidentEnvironment(g_load.hdrPath, g_load.maps, g_load.hdrPath == g_latest);
+		std::cout << "Loaded environment " << g_load.hdrPath << (g_load.cached ? " from the IBL cache" : "") << " in "
+			<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - g_load.start).count() << "ms" << std::endl;
+	}
+
+	void finishDownload() {
+		mapBuffer(g_load, GL_PIXEL_PACK_BUFFER, GL_MAP_READ_BIT);
+		g_load.stage = loadStage::saving;
+		g_load.task = std::async(std::launch::async, saveEnvironment, std::ref(g_load));
+	}
+
+	void finishSave() {
+		unmapBuffer(g_load, GL_PIXEL_PACK_BUFFER);
+		deleteBuffer(g_load);
+		g_load.stage = loadStage::idle;
+	}
+
+	void step(bool wait) {
+		switch (g_load.stage) {
+		case loadStage::idle:
+			if (!g_pending.empty()) {
+				startLoad(g_pending);
+				g_pending.clear();
+			}
+			break;
+		case loadStage::reading:
+			if (taskReady(g_load, wait)) finishRead();
+			break;
+		case loadStage::copying:
+			if (taskReady(g_load, wait)) finishCopy();
+			break;
+		case loadStage::uploading:
+			if (fenceSignaled(g_load, wait)) finishUpload();
+			break;
+		case loadStage::downloading:
+			if (fenceSignaled(g_load, wait)) finishDownload();
+			break;
+		case loadStage::saving:
+			if (taskReady(g_load, wait)) finishSave();
+			break;
+		}
+	}
+}
+
+void requestEnvironment(const std::string& hdrPath) {
+	g_latest = hdrPath;
+	g_pending.clear();
+
+	// already on the GPU, or on its way there
+	if (useResidentEnvironment(hdrPath)) return;
+	if (loadingEnvironment() == hdrPath) return;
+	g_pending = hdrPath;
+}
+
+void updateEnvironmentLoader() {
+	CGRA_TRACE_ZONE("updateEnvironmentLoader");
+	step(false);
+}
+
+void finishEnvironmentLoad() {
+	CGRA_TRACE_ZONE("finishEnvironmentLoad");
+	while (g_load.stage != loadStage::idle || !g_pending.empty()) step(true);
+}
+
+std::string loadingEnvironment() {
+	switch (g_load.stage) {
+	case loadStage::reading:
+	case loadStage::copying:
+	case loadStage::uploading:
+		return g_load.hdrPath;
+	default:
+		return g_pending;
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// std
+#include <string>
+
+// loads IBL environments without stalling the render loop. the hdr file is decoded
+// (or the baked maps are read from the IBL cache) on a worker thread, uploaded
+// through pixel buffers and handed to the environment manager once it is all on
+// the GPU, so the old environment keeps rendering until then.
+// everything here must be called from the thread that owns the GL context
+
+// queues an environment, replacing any queued request that hasn't started yet
+void requestEnvironment(const std::string& hdrPath);
+
+// advances the current load by at most one step without blocking, call once a frame
+void updateEnvironmentLoader();
+
+// blocks until every requested environment has been swapped in
+void finishEnvironmentLoad();
+
+// the hdr file of the environment being loaded, empty if there isn't one
+std::string loadingEnvironment();
@@ -0,0 +1,164 @@
+
+// std
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// imgui
+#include <imgui.h>
+
+#include "cgra/cgra_trace.hpp"
+#include "matt/environment_manager.hpp"
+
+namespace {
+	struct residentEnvironment {
+		std::string hdrPath;
+		iblMaps maps;
+		size_t bytes = 0;
+		uint64_t lastUsed = 0;
+	};
+
+	std::vector<residentEnvironment> g_resident;
+	std::string g_current;
+	uint64_t g_clock = 0;
+
+	size_t defaultBudget() {
+		const char* env = std::getenv("CGRA_IBL_BUDGET_MB");
+		size_t mb = env ? size_t(std::strtoul(env, nullptr, 10)) : 0;
+		return (mb ? mb : 256) * 1024 * 1024;
+	}
+
+	size_t g_budget = defaultBudget();
+
+	// size of every defined level (and face) as reported by the driver
+	size_t textureBytes(GLuint texture, GLenum target) {
+		if (texture == 0) return 0;
+		GLenum face = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+		size_t faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+
+		glBindTexture(target, texture);
+		GLint maxLevel = 0;
+		glGetTexParameteriv(target, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+		size_t bytes = 0;
+		for (int level = 0; level <= std::min(maxLevel, 15); level++) {
+			GLint width = 0, height = 0, bits = 0;
+			glGetTexLevelParameteriv(face, level, GL_TEXTURE_WIDTH, &width);
+			glGetTexLevelParameteriv(face, level, GL_TEXTURE_HEIGHT, &height);
+			if (width == 0) break;
+			for (GLenum component : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE }) {
+				GLint size = 0;
+				glGetTexLevelParameteriv(face, level, component, &size);
+				bits += size;
+			}
+			bytes += size_t(width) * height * faces * bits / 8;
+		}
+		return bytes;
+	}
+
+	size_t mapsBytes(const iblMaps& maps) {
+		return textureBytes(maps.hdr, GL_TEXTURE_2D)
+			+ textureBytes(maps.environment, GL_TEXTURE_CUBE_MAP)
+			+ textureBytes(maps.irradiance, GL_TEXTURE_CUBE_MAP)
+			+ textureBytes(maps.prefilter, GL_TEXTURE_CUBE_MAP);
+	}
+
+	void deleteMaps(iblMaps& maps) {
+		for (GLuint* texture : { &maps.hdr, &maps.environment, &maps.irradiance, &maps.prefilter }) {
+			if (*texture != 0) glDeleteTextures(1, texture);
+			*texture = 0;
+		}
+	}
+
+	std::vector<residentEnvironment>::iterator findResident(const std::string& hdrPath) {
+		return std::find_if(g_resident.begin(), g_resident.end(), [&](const residentEnvironment& r) {
+			return r.hdrPath == hdrPath;
+		});
+	}
+
+	void makeCurrent(residentEnvironment& r) {
+		r.lastUsed = ++g_clock;
+		g_current = r.hdrPath;
+		setEnvironment(r.maps);
+	}
+
+	void evict() {
+		CGRA_TRACE_ZONE("evictEnvironments");
+		while (residentEnvironmentBytes() > g_budget) {
+			auto lru = g_resident.end();
+			for (auto it = g_resident.begin(); it != g_resident.end(); ++it) {
+				if (it->hdrPath == g_current) continue;
+				if (lru == g_resident.end() || it->lastUsed < lru->lastUsed) lru = it;
+			}
+			if (lru == g_resident.end()) return; // only the current set is left
+
+			std::cout << "Evicting environment " << lru->hdrPath << " (" << (lru->bytes >> 20) << "MB)" << std::endl;
+			deleteMaps(lru->maps);
+			g_resident.erase(lru);
+		}
+	}
+
+	std::string fileName(const std::string& path) {
+		return path.substr(path.find_last_of("/\\") + 1);
+	}
+}
+
+void addResidentEnvironment(const std::string& hdrPath, const iblMaps& maps, bool current) {
+	CGRA_TRACE_ZONE("addResidentEnvironment");
+
+	auto it = findResident(hdrPath);
+	if (it != g_resident.end()) {
+		// reloaded (e.g. after the bake shaders changed), the new set replaces it
+		if (g_current == hdrPath && !current) g_current.clear();
+		deleteMaps(it->maps);
+		g_resident.erase(it);
+	}
+
+	residentEnvironment r;
+	r.hdrPath = hdrPath;
+	r.maps = maps;
+	r.bytes = mapsBytes(maps);
+	r.lastUsed = ++g_clock;
+	g_resident.push_back(r);
+
+	if (current) makeCurrent(g_resident.back());
+	evict();
+}
+
+bool useResidentEnvironment(const std::string& hdrPath) {
+	auto it = findResident(hdrPath);
+	if (it == g_resident.end()) return false;
+	if (g_current != hdrPath) makeCurrent(*it);
+	return true;
+}
+
+bool isEnvironmentResident(const std::string& hdrPath) {
+	return findResident(hdrPath) != g_resident.end();
+}
+
+void setEnvironmentBudget(size_t bytes) {
+	g_budget = bytes;
+	evict();
+}
+
+size_t environmentBudget() {
+	return g_budget;
+}
+
+size_t residentEnvironmentBytes() {
+	size_t bytes = 0;
+	for (const residentEnvironment& r : g_resident) bytes += r.bytes;
+	return bytes;
+}
+
+void renderEnvironmentGUI() {
+	int budget = int(g_budget >> 20);
+	if (ImGui::SliderInt("IBL Budget (MB)", &budget, 64, 2048)) setEnvironmentBudget(size_t(budget) << 20);
+
+	ImGui::Text("Resident: %.1f / %d MB", residentEnvironmentBytes() / (1024.0 * 1024.0), budget);
+	for (const residentEnvironment& r : g_resident) {
+		ImGui::BulletText("%s  %.1f MB%s", fileName(r.hdrPath).c_str(), r.bytes / (1024.0 * 1024.0),
+			r.hdrPath == g_current ? "  (current)" : "");
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <string>
+
+// project
+#include "matt/pbr.hpp"
+
+// keeps several baked IBL sets resident on the GPU, so switching to one that has
+// been loaded before is just a swap of texture handles. sets are evicted least
+// recently used first once the total goes over the budget (the current set is
+// never evicted). the budget can be set with CGRA_IBL_BUDGET_MB
+
+// takes ownership of a loaded set, making it current if requested
+void addResidentEnvironment(const std::string& hdrPath, const iblMaps& maps, bool makeCurrent);
+
+// makes a resident set current, false if it isn't resident
+bool useResidentEnvironment(const std::string& hdrPath);
+
+bool isEnvironmentResident(const std::string& hdrPath);
+
+void setEnvironmentBudget(size_t bytes);
+size_t environmentBudget();
+
+// estimated video memory of all resident sets
+size_t residentEnvironmentBytes();
+
+// budget slider and the memory used by each set, drawn into the current ImGui window
+void renderEnvironmentGUI();
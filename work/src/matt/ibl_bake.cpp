@@ -0,0 +1,358 @@
+
+// ibl_bake: bakes the IBL maps for equirectangular hdr images on the CPU and
+// writes them to the IBL cache, so the application loads them instead of baking
+// on the GPU. follows cubemap.fs, prefilter.fs and irradiance.fs, which are part
+// of the cache key, so editing those shaders invalidates the baked files
+//
+// usage: ibl_bake [--irradiance-map] [--cache <dir>] <file.hdr>...
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "cgra/cgra_cache.hpp"
+#include "cgra/cgra_hdr.hpp"
+#include "matt/brdf_lut.hpp"
+#include "matt/ibl_cache.hpp"
+#include "matt/sh_irradiance.hpp"
+
+using namespace glm;
+
+namespace {
+	const float PI = 3.14159265359f;
+
+	// same sizes as the GPU bake (see iblBakeParameters)
+	const int environmentSize = 1024;
+	const int environmentLevels = 11;
+	const int irradianceSize = 32;
+	const int prefilterSize = 256;
+	const int prefilterLevels = 5;
+	const int prefilterSamples = 1024;
+
+	struct image {
+		int width = 0;
+		int height = 0;
+		std::vector<vec3> pixels;
+
+		image() {}
+		image(int w, int h) : width(w), height(h), pixels(size_t(w) * h) {}
+		vec3& at(int x, int y) { return pixels[size_t(y) * width + x]; }
+		const vec3& at(int x, int y) const { return pixels[size_t(y) * width + x]; }
+	};
+
+	// levels[level][face], faces in GL order (+x, -x, +y, -y, +z, -z)
+	struct cubemap {
+		std::vector<std::vector<image>> levels;
+	};
+
+	double elapsedMs(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// bilinear filtering with GL_CLAMP_TO_EDGE, s and t in [0, 1]
+	vec3 sampleBilinear(const image& img, float s, float t) {
+		float x = s * img.width - 0.5f;
+		float y = t * img.height - 0.5f;
+		float fx = std::floor(x), fy = std::floor(y);
+		float ax = x - fx, ay = y - fy;
+		int x0 = clamp(int(fx), 0, img.width - 1), x1 = clamp(int(fx) + 1, 0, img.width - 1);
+		int y0 = clamp(int(fy), 0, img.height - 1), y1 = clamp(int(fy) + 1, 0, img.height - 1);
+		return mix(mix(img.at(x0, y0), img.at(x1, y0), ax), mix(img.at(x0, y1), img.at(x1, y1), ax), ay);
+	}
+
+	// SampleSphericalMap in cubemap.fs (including its rounded constants)
+	vec3 sampleEquirectangular(const image& hdr, const vec3& v) {
+		vec2 uv = vec2(std::atan2(v.z, v.x), std::asin(clamp(v.y, -1.0f, 1.0f))) * vec2(0.1591f, 0.3183f) + 0.5f;
+		return sampleBilinear(hdr, uv.x, uv.y);
+	}
+
+	// direction through texture coordinates s, t of a cubemap face (table 8.19 of the GL spec inverted)
+	vec3 faceDirection(int face, float s, float t) {
+		float sc = 2.0f * s - 1.0f;
+		float tc = 2.0f * t - 1.0f;
+		vec3 dirs[] = {
+			vec3(1.0f, -tc, -sc), vec3(-1.0f, -tc, sc),
+			vec3(sc, 1.0f, tc), vec3(sc, -1.0f, -tc),
+			vec3(sc, -tc, 1.0f), vec3(-sc, -tc, -1.0f)
+		};
+		return normalize(dirs[face]);
+	}
+
+	void faceCoordinates(const vec3& d, int& face, float& s, float& t) {
+		vec3 a = abs(d);
+		float sc, tc, ma;
+		if (a.x >= a.y && a.x >= a.z) {
+			face = d.x > 0 ? 0 : 1;
+			ma = a.x; sc = d.x > 0 ? -d.z : d.z; tc = -d.y;
+		}
+		else if (a.y >= a.z) {
+			face = d.y > 0 ? 2 : 3;
+			ma = a.y; sc = d.x; tc = d.y > 0 ? d.z : -d.z;
+		}
+		else {
+			face = d.z > 0 ? 4 : 5;
+			ma = a.z; sc = d.z > 0 ? d.x : -d.x; tc = -d.y;
+		}
+		s = 0.5f * (sc / ma + 1.0f);
+		t = 0.5f * (tc / ma + 1.0f);
+	}
+
+	// trilinear textureLod on a cubemap (without seamless filtering across faces)
+	vec3 sampleCube(const cubemap& cube, const vec3& dir, float lod) {
+		int face;
+		float s, t;
+		faceCoordinates(dir, face, s, t);
+		lod = clamp(lod, 0.0f, float(cube.levels.size() - 1));
+		int l0 = int(lod);
+		int l1 = std::min(l0 + 1, int(cube.levels.size() - 1));
+		vec3 c0 = sampleBilinear(cube.levels[l0][face], s, t);
+		if (l1 == l0) return c0;
+		return mix(c0, sampleBilinear(cube.levels[l1][face], s, t), lod - float(l0));
+	}
+
+	cubemap allocateCube(int size, int levels) {
+		cubemap cube;
+		for (int level = 0; level < levels; level++) {
+			int s = std::max(1, size >> level);
+			cube.levels.push_back(std::vector<image>(6, image(s, s)));
+		}
+		return cube;
+	}
+
+	// sets every texel of a level to f(direction through the texel), rows in parallel
+	template <typename F>
+	void forEachTexel(image* faces, F f) {
+		int size = faces[0].width;
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int row = 0; row < 6 * size; row++) {
+			int face = row / size, y = row % size;
+			for (int x = 0; x < size; x++) {
+				vec3 dir = faceDirection(face, (x + 0.5f) / size, (y + 0.5f) / size);
+				faces[face].at(x, y) = f(dir);
+			}
+		}
+	}
+
+	// cubemap.fs into level 0, then 2x2 box filtered levels like glGenerateMipmap
+	cubemap bakeEnvironment(const image& hdr) {
+		cubemap env = allocateCube(environmentSize, environmentLevels);
+		forEachTexel(env.levels[0].data(), [&](const vec3& dir) { return sampleEquirectangular(hdr, dir); });
+
+		for (int level = 1; level < environmentLevels; level++) {
+			for (int face = 0; face < 6; face++) {
+				const image& src = env.levels[level - 1][face];
+				image& dst = env.levels[level][face];
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for
+#endif
+				for (int y = 0; y < dst.height; y++) {
+					for (int x = 0; x < dst.width; x++) {
+						dst.at(x, y) = 0.25f * (src.at(2 * x, 2 * y) + src.at(2 * x + 1, 2 * y) + src.at(2 * x, 2 * y + 1) + src.at(2 * x + 1, 2 * y + 1));
+					}
+				}
+			}
+		}
+		return env;
+	}
+
+	// http://holger.dammertz.org/stuff/notes_HammersleyOnHemisphere.html
+	float radicalInverse(uint32_t bits) {
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return float(bits) * 2.3283064365386963e-10f;
+	}
+
+	// a light direction in the tangent frame of N and the mip level to read it from
+	struct prefilterSample {
+		vec3 L;
+		float lod;
+	};
+
+	// with V = R = N every sample only depends on the roughness, not on N
+	std::vector<prefilterSample> prefilterSamplesFor(float roughness) {
+		std::vector<prefilterSample> samples;
+		float a = roughness * roughness;
+		for (int i = 0; i < prefilterSamples; i++) {
+			vec2 xi(float(i) / float(prefilterSamples), radicalInverse(uint32_t(i)));
+			float phi = 2.0f * PI * xi.x;
+			float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+			float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+			vec3 H(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+			vec3 L = normalize(2.0f * H.z * H - vec3(0, 0, 1));
+			if (L.z <= 0.0f) continue;
+
+			// DistributionGGX and the mip selection in prefilter.fs (which assumes a 512 source)
+			float a2 = a * a;
+			float denom = cosTheta * cosTheta * (a2 - 1.0f) + 1.0f;
+			float D = a2 / (PI * denom * denom);
+			float pdf = D * cosTheta / (4.0f * cosTheta) + 0.0001f;
+			float saTexel = 4.0f * PI / (6.0f * 512.0f * 512.0f);
+			float saSample = 1.0f / (float(prefilterSamples) * pdf + 0.0001f);
+			float lod = roughness == 0.0f ? 0.0f : 0.5f * std::log2(saSample / saTexel);
+			samples.push_back({ L, lod });
+		}
+		return samples;
+	}
+
+	cubemap bakePrefilter(const cubemap& env) {
+		cubemap prefilter = allocateCube(prefilterSize, prefilterLevels);
+		for (int mip = 0; mip < prefilterLevels; mip++) {
+			float roughness = float(mip) / float(prefilterLevels - 1);
+
+			// every sample of a mirror reflection lands on N at lod 0
+			if (roughness == 0.0f) {
+				forEachTexel(prefilter.levels[mip].data(), [&](const vec3& N) { return sampleCube(env, N, 0.0f); });
+				continue;
+			}
+
+			std::vector<prefilterSample> samples = prefilterSamplesFor(roughness);
+			forEachTexel(prefilter.levels[mip].data(), [&](const vec3& N) {
+				vec3 up = std::abs(N.z) < 0.999f ? vec3(0, 0, 1) : vec3(1, 0, 0);
+				vec3 tangent = normalize(cross(up, N));
+				vec3 bitangent = cross(N, tangent);
+
+				vec3 color(0.0f);
+				float totalWeight = 0.0f;
+				for (const prefilterSample& sample : samples) {
+					vec3 L = normalize(tangent * sample.L.x + bitangent * sample.L.y + N * sample.L.z);
+					color += sampleCube(env, L, sample.lod) * sample.L.z;
+					totalWeight += sample.L.z;
+				}
+				return color / totalWeight;
+			});
+		}
+		return prefilter;
+	}
+
+	// irradiance.fs. texture() there picks its lod from screen space derivatives,
+	// which for a 32x32 target over a 1024 source comes out at about level 5
+	cubemap bakeIrradiance(const cubemap& env) {
+		const float lod = std::log2(float(environmentSize) / float(irradianceSize));
+		cubemap irradiance = allocateCube(irradianceSize, 1);
+		forEachTexel(irradiance.levels[0].data(), [&](const vec3& N) {
+			vec3 up(0.0f, 1.0f, 0.0f);
+			vec3 right = normalize(cross(up, N));
+			up = normalize(cross(N, right));
+
+			vec3 sum(0.0f);
+			float count = 0.0f;
+			const float sampleDelta = 0.025f;
+			for (float phi = 0.0f; phi < 2.0f * PI; phi += sampleDelta) {
+				for (float theta = 0.0f; theta < 0.5f * PI; theta += sampleDelta) {
+					vec3 t(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+					vec3 sampleVec = t.x * right + t.y * up + t.z * N;
+					sum += sampleCube(env, sampleVec, lod) * std::cos(theta) * std::sin(theta);
+					count++;
+				}
+			}
+			return PI * sum / count;
+		});
+		return irradiance;
+	}
+
+	// half float RGB, laid out like readIBLTexture
+	iblTexture toIBLTexture(const cubemap& cube) {
+		iblTexture tex = iblTextureLayout(GL_TEXTURE_CUBE_MAP, GL_RGB16F, GL_RGB, cube.levels[0][0].width, int(cube.levels.size()));
+		tex.data.reserve(iblTextureCount(tex));
+		for (const std::vector<image>& faces : cube.levels) {
+			for (const image& face : faces) {
+				for (const vec3& p : face.pixels) {
+					for (int c = 0; c < 3; c++) tex.data.push_back(packHalf1x16(p[c]));
+				}
+			}
+		}
+		return tex;
+	}
+
+	bool bake(const std::string& hdrPath, bool irradianceSH) {
+		std::cout << hdrPath << std::endl;
+		auto total = std::chrono::steady_clock::now();
+
+		uint64_t key = iblCacheKey(hdrPath, iblBakeParameters(irradianceSH));
+		auto start = std::chrono::steady_clock::now();
+		// decoded the same way as the application, so the baker sees the same half float texels
+		cgra::hdr_image decoded;
+		if (!key || !cgra::load_hdr(hdrPath, decoded)) {
+			std::cerr << "Error: Could not load " << hdrPath << std::endl;
+			return false;
+		}
+		image hdr;
+		hdr.width = decoded.width;
+		hdr.height = decoded.height;
+		hdr.pixels.resize(size_t(hdr.width) * hdr.height);
+		cgra::half_to_float(decoded.pixels.data(), &hdr.pixels[0].x, decoded.pixels.size());
+		std::cout << "  decode      " << elapsedMs(start) << "ms (" << hdr.width << "x" << hdr.height << ")" << std::endl;
+
+		iblBake result;
+		start = std::chrono::steady_clock::now();
+		cubemap env = bakeEnvironment(hdr);
+		std::cout << "  environment " << elapsedMs(start) << "ms" << std::endl;
+
+		start = std::chrono::steady_clock::now();
+		if (irradianceSH) {
+			result.irradianceSH = projectIrradianceSH(&hdr.pixels[0].x, hdr.width, hdr.height, 3);
+			std::cout << "  irradiance  " << elapsedMs(start) << "ms (SH)" << std::endl;
+		}
+		else {
+			result.irradiance = toIBLTexture(bakeIrradiance(env));
+			std::cout << "  irradiance  " << elapsedMs(start) << "ms" << std::endl;
+		}
+
+		start = std::chrono::steady_clock::now();
+		cubemap prefilter = bakePrefilter(env);
+		std::cout << "  prefilter   " << elapsedMs(start) << "ms" << std::endl;
+
+		start = std::chrono::steady_clock::now();
+		result.environment = toIBLTexture(env);
+		result.prefilter = toIBLTexture(prefilter);
+		saveIBLCache(key, result);
+		std::cout << "  write       " << elapsedMs(start) << "ms" << std::endl;
+
+		std::cout << "  total       " << elapsedMs(total) << "ms" << std::endl;
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* usage = "usage: ibl_bake [--irradiance-map] [--cache <dir>] <file.hdr>...";
+	bool irradianceSH = true;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--irradiance-map") irradianceSH = false;
+		else if (arg == "--cache" && i + 1 < argc) cgra::set_cache_directory(argv[++i]);
+		else if (arg.rfind("--", 0) != 0) files.push_back(arg);
+		else {
+			std::cerr << "Error: Unknown option " << arg << std::endl << usage << std::endl;
+			return 1;
+		}
+	}
+	if (files.empty()) {
+		std::cerr << usage << std::endl;
+		return 1;
+	}
+
+	// the BRDF LUT doesn't depend on the environment
+	auto start = std::chrono::steady_clock::now();
+	saveBRDFLUT(computeBRDFLUT(512, 1024), 512, 1024);
+	std::cout << "BRDF LUT " << elapsedMs(start) << "ms" << std::endl;
+
+	int failed = 0;
+	for (const std::string& file : files) {
+		if (!bake(file, irradianceSH)) failed++;
+	}
+	return failed ? 1 : 0;
+}
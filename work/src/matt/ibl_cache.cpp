@@ -0,0 +1,209 @@
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "cgra/cgra_cache.hpp"
+#include "cgra/cgra_trace.hpp"
+#include "matt/ibl_cache.hpp"
+
+namespace {
+	const char iblMagic[4] = { 'C', 'I', 'B', 'L' };
+	const uint32_t iblVersion = 3;
+
+	// header stored before each texture's data
+	struct iblTextureHeader {
+		uint32_t target;
+		uint32_t internalFormat;
+		uint32_t format;
+		uint32_t size;
+		uint32_t levels;
+		uint32_t count; // number of half floats that follow
+	};
+
+	int channels(GLenum format) {
+		return format == GL_RG ? 2 : format == GL_RGBA ? 4 : 3;
+	}
+
+	int faces(GLenum target) {
+		return target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+	}
+
+	size_t levelCount(const iblTexture& tex, int level) {
+		size_t s = size_t(std::max(1, tex.size >> level));
+		return s * s * channels(tex.format);
+	}
+
+	size_t totalCount(const iblTexture& tex) {
+		size_t count = 0;
+		for (int level = 0; level < tex.levels; level++) {
+			count += levelCount(tex, level) * faces(tex.target);
+		}
+		return count;
+	}
+
+#ifndef CGRA_NO_GL
+	GLenum faceTarget(GLenum target, int face) {
+		return target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+	}
+#endif
+
+	void append(std::vector<char>& out, const void* data, size_t size) {
+		const char* p = static_cast<const char*>(data);
+		out.insert(out.end(), p, p + size);
+	}
+
+	bool read(const std::vector<char>& in, size_t& offset, void* data, size_t size) {
+		if (offset + size > in.size()) return false;
+		std::memcpy(data, in.data() + offset, size);
+		offset += size;
+		return true;
+	}
+
+	std::string cacheFile(uint64_t key) {
+		return cgra::cache_path("ibl", key, ".ibl");
+	}
+}
+
+std::string iblBakeParameters(bool irradianceSH) {
+	std::string params = irradianceSH ? "env1024 irradianceSH prefilter256x5" : "env1024 irradiance32 prefilter256x5";
+	for (const char* shader : { "cubemap.vs", "cubemap.fs", "irradiance.fs", "prefilter.fs" }) {
+		params += " " + std::to_string(cgra::hash_file(CGRA_SRCDIR + std::string("/res/shaders/") + shader));
+	}
+	return params;
+}
+
+iblTexture iblTextureLayout(GLenum target, GLenum internalFormat, GLenum format, int size, int levels) {
+	iblTexture tex;
+	tex.target = target;
+	tex.internalFormat = internalFormat;
+	tex.format = format;
+	tex.size = size;
+	tex.levels = levels;
+	return tex;
+}
+
+size_t iblTextureCount(const iblTexture& tex) {
+	return totalCount(tex);
+}
+
+#ifndef CGRA_NO_GL
+
+iblTexture readIBLTexture(GLuint texture, GLenum target, GLenum internalFormat, GLenum format, int size, int levels) {
+	iblTexture tex = iblTextureLayout(target, internalFormat, format, size, levels);
+	tex.data.resize(totalCount(tex));
+	readIBLTexture(texture, tex, tex.data.data());
+	return tex;
+}
+
+void readIBLTexture(GLuint texture, const iblTexture& layout, void* pixels) {
+	// rows of RGB half floats are not 4 byte aligned at small mips
+	GLint packAlignment;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+	glBindTexture(layout.target, texture);
+	uint16_t* dst = static_cast<uint16_t*>(pixels);
+	for (int level = 0; level < layout.levels; level++) {
+		for (int face = 0; face < faces(layout.target); face++) {
+			glGetTexImage(faceTarget(layout.target, face), level, layout.format, GL_HALF_FLOAT, dst);
+			dst += levelCount(layout, level);
+		}
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+}
+
+GLuint uploadIBLTexture(const iblTexture& tex) {
+	return uploadIBLTexture(tex, tex.data.data());
+}
+
+GLuint uploadIBLTexture(const iblTexture& tex, const void* pixels) {
+	GLint unpackAlignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(tex.target, texture);
+
+	const uint16_t* src = static_cast<const uint16_t*>(pixels);
+	for (int level = 0; level < tex.levels; level++) {
+		int s = std::max(1, tex.size >> level);
+		for (int face = 0; face < faces(tex.target); face++) {
+			glTexImage2D(faceTarget(tex.target, face), level, tex.internalFormat, s, s, 0, tex.format, GL_HALF_FLOAT, src);
+			src += levelCount(tex, level);
+		}
+	}
+
+	glTexParameteri(tex.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(tex.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (tex.target == GL_TEXTURE_CUBE_MAP) glTexParameteri(tex.target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexParameteri(tex.target, GL_TEXTURE_MIN_FILTER, tex.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(tex.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// only the stored levels exist, so the texture is complete without a full chain
+	glTexParameteri(tex.target, GL_TEXTURE_MAX_LEVEL, tex.levels - 1);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+	return texture;
+}
+
+#endif
+
+uint64_t iblCacheKey(const std::string& hdrPath, const std::string& bakeParameters) {
+	CGRA_TRACE_ZONE("iblCacheKey");
+	uint64_t hash = cgra::hash_file(hdrPath);
+	if (!hash) return 0;
+	return cgra::hash_string(bakeParameters, hash);
+}
+
+bool loadIBLCache(uint64_t key, iblBake& bake) {
+	CGRA_TRACE_ZONE("loadIBLCache");
+
+	std::vector<char> in;
+	if (!cgra::read_binary_file(cacheFile(key), in)) return false;
+
+	size_t offset = 0;
+	char magic[4];
+	uint32_t version;
+	uint64_t storedKey;
+	if (!read(in, offset, magic, sizeof(magic)) || std::memcmp(magic, iblMagic, sizeof(magic)) != 0) return false;
+	if (!read(in, offset, &version, sizeof(version)) || version != iblVersion) return false;
+	if (!read(in, offset, &storedKey, sizeof(storedKey)) || storedKey != key) return false;
+
+	for (iblTexture* tex : { &bake.environment, &bake.irradiance, &bake.prefilter }) {
+		iblTextureHeader header;
+		if (!read(in, offset, &header, sizeof(header))) return false;
+		tex->target = header.target;
+		tex->internalFormat = header.internalFormat;
+		tex->format = header.format;
+		tex->size = int(header.size);
+		tex->levels = int(header.levels);
+		if (header.size > 16384 || header.levels > 15) return false;
+		if (header.count != totalCount(*tex)) return false;
+		tex->data.resize(header.count);
+		if (!read(in, offset, tex->data.data(), header.count * sizeof(uint16_t))) return false;
+	}
+	if (!read(in, offset, bake.irradianceSH.coeffs, sizeof(bake.irradianceSH.coeffs))) return false;
+	return offset == in.size();
+}
+
+void saveIBLCache(uint64_t key, const iblBake& bake) {
+	CGRA_TRACE_ZONE("saveIBLCache");
+
+	std::vector<char> out;
+	append(out, iblMagic, sizeof(iblMagic));
+	append(out, &iblVersion, sizeof(iblVersion));
+	append(out, &key, sizeof(key));
+
+	for (const iblTexture* tex : { &bake.environment, &bake.irradiance, &bake.prefilter }) {
+		iblTextureHeader header = { tex->target, uint32_t(tex->internalFormat), tex->format, uint32_t(tex->size), uint32_t(tex->levels), uint32_t(tex->data.size()) };
+		append(out, &header, sizeof(header));
+		append(out, tex->data.data(), tex->data.size() * sizeof(uint16_t));
+	}
+	append(out, bake.irradianceSH.coeffs, sizeof(bake.irradianceSH.coeffs));
+
+	if (!cgra::write_binary_file(cacheFile(key), out.data(), out.size()))
+		std::cout << "Failed to write IBL cache " << cacheFile(key) << std::endl;
+}
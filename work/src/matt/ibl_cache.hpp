@@ -0,0 +1,60 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// project
+#include "opengl.hpp"
+#include "matt/sh_irradiance.hpp"
+
+// one baked IBL texture (a cubemap or a 2D table) with every mip level
+// stored as half floats, faces in GL cubemap order within each level
+struct iblTexture {
+	GLenum target = GL_TEXTURE_CUBE_MAP;
+	GLenum internalFormat = GL_RGB16F;
+	GLenum format = GL_RGB;
+	int size = 0;   // width/height of level 0
+	int levels = 0;
+	std::vector<uint16_t> data;
+};
+
+// everything baked for one environment
+struct iblBake {
+	iblTexture environment;
+	iblTexture irradiance; // empty (no levels) when the SH irradiance is used instead
+	iblTexture prefilter;
+	shIrradiance irradianceSH;
+};
+
+// the bake parameters (and the shaders doing the bake) are part of the cache key,
+// the CPU baker in ibl_bake.cpp follows the same shaders so it shares the key
+std::string iblBakeParameters(bool irradianceSH);
+
+// a texture description without any data
+iblTexture iblTextureLayout(GLenum target, GLenum internalFormat, GLenum format, int size, int levels);
+
+// number of half floats in all levels and faces of a texture
+size_t iblTextureCount(const iblTexture& tex);
+
+// cache key from the contents of the hdr file and the bake parameters, 0 if the file can't be read
+uint64_t iblCacheKey(const std::string& hdrPath, const std::string& bakeParameters);
+
+// cache files live in res/cache/ibl, loading fails (returns false) on any mismatch
+bool loadIBLCache(uint64_t key, iblBake& bake);
+void saveIBLCache(uint64_t key, const iblBake& bake);
+
+// the functions below need a GL context (not built with CGRA_NO_GL)
+
+// reads back the first `levels` mip levels of a texture
+iblTexture readIBLTexture(GLuint texture, GLenum target, GLenum internalFormat, GLenum format, int size, int levels);
+
+// reads back into `pixels`, which is an offset into the pixel pack buffer if one is bound
+void readIBLTexture(GLuint texture, const iblTexture& layout, void* pixels);
+
+// creates a texture (clamped, trilinear if it has mips) from baked data
+GLuint uploadIBLTexture(const iblTexture& tex);
+
+// same, from `pixels` laid out like tex.data (an offset if a pixel unpack buffer is bound)
+GLuint uploadIBLTexture(const iblTexture& tex, const void* pixels);
@@ -0,0 +1,347 @@
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <memory>
+
+// stb (stb_dxt.h has no extern "C" of its own, it is built in stb.c)
+extern "C" {
+#include <stb_dxt.h>
+}
+#include <stb_image.h>
+#include <stb_image_resize.h>
+
+#include "cgra/cgra_cache.hpp"
+#include "cgra/cgra_mipmap.hpp"
+#include "cgra/cgra_trace.hpp"
+#include "matt/material_cache.hpp"
+
+namespace {
+	const char materialMagic[4] = { 'C', 'M', 'A', 'T' };
+	const uint32_t materialVersion = 1;
+
+	// header stored before each texture's data
+	struct materialTextureHeader {
+		uint32_t internalFormat;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levels;
+		uint32_t size; // bytes of data that follow
+	};
+
+	// an 8 bit image with `channels` interleaved channels
+	struct image {
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		std::vector<unsigned char> pixels;
+	};
+
+	bool compressed(GLenum internalFormat) {
+		return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RG_RGTC2;
+	}
+
+	size_t levelSize(GLenum internalFormat, int width, int height) {
+		size_t blocks = size_t((width + 3) / 4) * size_t((height + 3) / 4);
+		switch (internalFormat) {
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return blocks * 8;
+		case GL_COMPRESSED_RG_RGTC2: return blocks * 16;
+		case GL_RG8: return size_t(width) * height * 2;
+		default: return size_t(width) * height * 3;
+		}
+	}
+
+	size_t totalSize(const materialTexture& tex) {
+		size_t size = 0;
+		for (int level = 0; level < tex.levels; level++) {
+			size += levelSize(tex.internalFormat, std::max(1, tex.width >> level), std::max(1, tex.height >> level));
+		}
+		return size;
+	}
+
+	// the file as is, loaded with `channels` channels (flipped only if stb's flag is set,
+	// which it isn't while the materials load at startup)
+	image decode(const std::string& path, int channels) {
+		CGRA_TRACE_ZONE("decodeMaterialImage");
+		image img;
+		int fileChannels;
+		std::unique_ptr<unsigned char, void(*)(void*)> pixels{ stbi_load(path.c_str(), &img.width, &img.height, &fileChannels, channels), stbi_image_free };
+		if (!pixels) {
+			std::cout << "Texture failed to load at path: " << path << std::endl;
+			return image();
+		}
+		img.channels = channels;
+		img.pixels.assign(pixels.get(), pixels.get() + size_t(img.width) * img.height * channels);
+		return img;
+	}
+
+	// keeps only the first `channels` channels
+	image dropChannels(const image& src, int channels) {
+		image dst;
+		dst.width = src.width;
+		dst.height = src.height;
+		dst.channels = channels;
+		dst.pixels.resize(size_t(src.width) * src.height * channels);
+		for (size_t i = 0; i < size_t(src.width) * src.height; i++) {
+			for (int c = 0; c < channels; c++) dst.pixels[i * channels + c] = src.pixels[i * src.channels + c];
+		}
+		return dst;
+	}
+
+	// packs single channel maps into one image, resampling any that are smaller.
+	// maps that failed to load become `fallback` (ao 1, roughness 1, metallic 0)
+	image pack(const image* maps[3], const unsigned char fallback[3]) {
+		image dst;
+		for (int i = 0; i < 3; i++) {
+			dst.width = std::max(dst.width, maps[i]->width);
+			dst.height = std::max(dst.height, maps[i]->height);
+		}
+		dst.width = std::max(dst.width, 1);
+		dst.height = std::max(dst.height, 1);
+		dst.channels = 3;
+		dst.pixels.resize(size_t(dst.width) * dst.height * 3);
+
+		std::vector<unsigned char> resized;
+		for (int i = 0; i < 3; i++) {
+			const image& src = *maps[i];
+			const unsigned char* channel = src.pixels.data();
+			if (src.pixels.empty()) {
+				resized.assign(size_t(dst.width) * dst.height, fallback[i]);
+				channel = resized.data();
+			}
+			else if (src.width != dst.width || src.height != dst.height) {
+				resized.resize(size_t(dst.width) * dst.height);
+				stbir_resize_uint8(src.pixels.data(), src.width, src.height, 0, resized.data(), dst.width, dst.height, 0, 1);
+				channel = resized.data();
+			}
+			for (size_t p = 0; p < size_t(dst.width) * dst.height; p++) dst.pixels[p * 3 + i] = channel[p];
+		}
+		return dst;
+	}
+
+	// a BC4 block (one channel, the 8 value mode) for 16 values `stride` bytes apart
+	void compressBC4Block(unsigned char* dest, const unsigned char* src, int stride) {
+		int lo = 255, hi = 0;
+		for (int i = 0; i < 16; i++) {
+			lo = std::min(lo, int(src[i * stride]));
+			hi = std::max(hi, int(src[i * stride]));
+		}
+		dest[0] = (unsigned char)hi;
+		dest[1] = (unsigned char)lo;
+
+		// the palette runs from hi (index 0) through six steps (indices 2..7) to lo (index 1)
+		uint64_t bits = 0;
+		if (hi > lo) {
+			for (int i = 0; i < 16; i++) {
+				int step = ((hi - src[i * stride]) * 7 + (hi - lo) / 2) / (hi - lo);
+				uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+				bits |= index << (3 * i);
+			}
+		}
+		for (int i = 0; i < 6; i++) dest[2 + i] = (unsigned char)(bits >> (8 * i));
+	}
+
+	// block compresses one level, blocks past the edge repeat the last row/column
+	std::vector<unsigned char> compressLevel(const cgra::mip_level& src, int channels, GLenum internalFormat) {
+		const int blocksX = (src.width + 3) / 4;
+		const int blocksY = (src.height + 3) / 4;
+		const size_t blockSize = internalFormat == GL_COMPRESSED_RG_RGTC2 ? 16 : 8;
+		std::vector<unsigned char> out(size_t(blocksX) * blocksY * blockSize);
+
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for (int by = 0; by < blocksY; by++) {
+			unsigned char rgba[64];
+			for (int bx = 0; bx < blocksX; bx++) {
+				for (int i = 0; i < 16; i++) {
+					int x = std::min(bx * 4 + i % 4, src.width - 1);
+					int y = std::min(by * 4 + i / 4, src.height - 1);
+					const unsigned char* p = &src.pixels[(size_t(y) * src.width + x) * channels];
+					for (int c = 0; c < 4; c++) rgba[i * 4 + c] = c < channels ? p[c] : c == 3 ? 255 : 0;
+				}
+				unsigned char* dest = &out[(size_t(by) * blocksX + bx) * blockSize];
+				if (internalFormat == GL_COMPRESSED_RG_RGTC2) {
+					compressBC4Block(dest, rgba, 4);
+					compressBC4Block(dest + 8, rgba + 1, 4);
+				}
+				else {
+					stb_compress_dxt_block(dest, rgba, 0, STB_DXT_NORMAL);
+				}
+			}
+		}
+		return out;
+	}
+
+	// builds every level down to 1x1, compressing each one if the format is compressed
+	materialTexture buildTexture(const image& img, GLenum internalFormat, bool srgb) {
+		// the materials repeat, and the albedo is averaged in linear space
+		cgra::mip_options options;
+		options.filter = cgra::mip_filter::kaiser;
+		options.srgb = srgb;
+		options.wrap = true;
+		std::vector<cgra::mip_level> levels = cgra::build_mipmaps(img.pixels.data(), img.width, img.height, img.channels, options);
+
+		materialTexture tex;
+		tex.internalFormat = internalFormat;
+		tex.width = img.width;
+		tex.height = img.height;
+		tex.levels = int(levels.size());
+		for (const cgra::mip_level& level : levels) {
+			if (compressed(internalFormat)) {
+				std::vector<unsigned char> blocks = compressLevel(level, img.channels, internalFormat);
+				tex.data.insert(tex.data.end(), blocks.begin(), blocks.end());
+			}
+			else {
+				tex.data.insert(tex.data.end(), level.pixels.begin(), level.pixels.end());
+			}
+		}
+		return tex;
+	}
+
+	void append(std::vector<char>& out, const void* data, size_t size) {
+		const char* p = static_cast<const char*>(data);
+		out.insert(out.end(), p, p + size);
+	}
+
+	bool read(const std::vector<char>& in, size_t& offset, void* data, size_t size) {
+		if (offset + size > in.size()) return false;
+		std::memcpy(data, in.data() + offset, size);
+		offset += size;
+		return true;
+	}
+
+	std::string cacheFile(uint64_t key) {
+		return cgra::cache_path("materials", key, ".mat");
+	}
+
+	const char* sourceMaps[] = { "albedo", "normal", "metallic", "roughness", "ao" };
+}
+
+uint64_t materialCacheKey(const std::string& basePath, bool compress) {
+	CGRA_TRACE_ZONE("materialCacheKey");
+	uint64_t hash = cgra::hash_string(compress ? "materials v2 bc1 bc5" : "materials v2 rgb8 rg8");
+	for (const char* map : sourceMaps) {
+		uint64_t file = cgra::hash_file(basePath + "/" + map + ".png");
+		if (!file) return 0;
+		hash = cgra::hash_bytes(&file, sizeof(file), hash);
+	}
+	return hash;
+}
+
+materialBake bakeMaterial(const std::string& basePath, bool compress) {
+	CGRA_TRACE_ZONE("bakeMaterial");
+	auto start = std::chrono::steady_clock::now();
+
+	// the PNG decode is most of the time, so the five images decode at once
+	std::future<image> decoded[5];
+	for (int i = 0; i < 5; i++) {
+		decoded[i] = std::async(std::launch::async, decode, basePath + "/" + sourceMaps[i] + ".png", i < 2 ? 3 : 1);
+	}
+	image albedo = decoded[0].get();
+	image normal = decoded[1].get();
+	image metallic = decoded[2].get();
+	image roughness = decoded[3].get();
+	image ao = decoded[4].get();
+
+	// a missing albedo or normal map becomes a single texel (black, and a flat normal)
+	if (albedo.pixels.empty()) albedo = image{ 1, 1, 3, { 0, 0, 0 } };
+	if (normal.pixels.empty()) normal = image{ 1, 1, 3, { 128, 128, 255 } };
+
+	const image* ormMaps[3] = { &ao, &roughness, &metallic };
+	const unsigned char ormFallback[3] = { 255, 255, 0 };
+
+	materialBake bake;
+	bake.albedo = buildTexture(albedo, compress ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGB8, true);
+	bake.normal = buildTexture(dropChannels(normal, 2), compress ? GL_COMPRESSED_RG_RGTC2 : GL_RG8, false);
+	bake.orm = buildTexture(pack(ormMaps, ormFallback), compress ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGB8, false);
+
+	std::cout << "Baked material " << basePath << " in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << "ms" << std::endl;
+	return bake;
+}
+
+bool loadMaterialCache(uint64_t key, materialBake& bake) {
+	CGRA_TRACE_ZONE("loadMaterialCache");
+
+	std::vector<char> in;
+	if (!cgra::read_binary_file(cacheFile(key), in)) return false;
+
+	size_t offset = 0;
+	char magic[4];
+	uint32_t version;
+	uint64_t storedKey;
+	if (!read(in, offset, magic, sizeof(magic)) || std::memcmp(magic, materialMagic, sizeof(magic)) != 0) return false;
+	if (!read(in, offset, &version, sizeof(version)) || version != materialVersion) return false;
+	if (!read(in, offset, &storedKey, sizeof(storedKey)) || storedKey != key) return false;
+
+	for (materialTexture* tex : { &bake.albedo, &bake.normal, &bake.orm }) {
+		materialTextureHeader header;
+		if (!read(in, offset, &header, sizeof(header))) return false;
+		if (header.width > 16384 || header.height > 16384 || header.levels > 15) return false;
+		tex->internalFormat = header.internalFormat;
+		tex->width = int(header.width);
+		tex->height = int(header.height);
+		tex->levels = int(header.levels);
+		if (header.size != totalSize(*tex)) return false;
+		tex->data.resize(header.size);
+		if (!read(in, offset, tex->data.data(), header.size)) return false;
+	}
+	return offset == in.size();
+}
+
+void saveMaterialCache(uint64_t key, const materialBake& bake) {
+	CGRA_TRACE_ZONE("saveMaterialCache");
+
+	std::vector<char> out;
+	append(out, materialMagic, sizeof(materialMagic));
+	append(out, &materialVersion, sizeof(materialVersion));
+	append(out, &key, sizeof(key));
+
+	for (const materialTexture* tex : { &bake.albedo, &bake.normal, &bake.orm }) {
+		materialTextureHeader header = { uint32_t(tex->internalFormat), uint32_t(tex->width), uint32_t(tex->height), uint32_t(tex->levels), uint32_t(tex->data.size()) };
+		append(out, &header, sizeof(header));
+		append(out, tex->data.data(), tex->data.size());
+	}
+
+	if (!cgra::write_binary_file(cacheFile(key), out.data(), out.size()))
+		std::cout << "Failed to write material cache " << cacheFile(key) << std::endl;
+}
+
+GLuint uploadMaterialTexture(const materialTexture& tex) {
+	// RGB8 rows are not 4 byte aligned at small mips
+	GLint unpackAlignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	const unsigned char* src = tex.data.data();
+	for (int level = 0; level < tex.levels; level++) {
+		int w = std::max(1, tex.width >> level);
+		int h = std::max(1, tex.height >> level);
+		GLsizei size = GLsizei(levelSize(tex.internalFormat, w, h));
+		if (compressed(tex.internalFormat)) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, tex.internalFormat, w, h, 0, size, src);
+		}
+		else {
+			GLenum format = tex.internalFormat == GL_RG8 ? GL_RG : GL_RGB;
+			glTexImage2D(GL_TEXTURE_2D, level, tex.internalFormat, w, h, 0, format, GL_UNSIGNED_BYTE, src);
+		}
+		src += size;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex.levels - 1);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+	return texture;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// project
+#include "opengl.hpp"
+
+// one texture of a preprocessed material with its whole mip chain,
+// levels stored back to back from level 0 down to 1x1
+struct materialTexture {
+	GLenum internalFormat = GL_RGB8; // GL_RGB8, GL_RG8 or a block compressed format
+	int width = 0;
+	int height = 0;
+	int levels = 0;
+	std::vector<unsigned char> data;
+};
+
+// a material as pbr.fs samples it: albedo, the x and y of the tangent space normal
+// (z is reconstructed in the shader) and ambient occlusion, roughness and metallic
+// packed into the R, G and B channels of one ORM texture
+struct materialBake {
+	materialTexture albedo;
+	materialTexture normal;
+	materialTexture orm;
+};
+
+// cache key from the contents of the five source images and the bake options, 0 if one can't be read
+uint64_t materialCacheKey(const std::string& basePath, bool compress);
+
+// decodes albedo, normal, metallic, roughness and ao.png from basePath, packs them and builds
+// the mip chains on the CPU. with compress every level is block compressed, BC1 for the albedo
+// and ORM (needs EXT_texture_compression_s3tc) and BC5 for the normal
+materialBake bakeMaterial(const std::string& basePath, bool compress);
+
+// cache files live in res/cache/materials, loading fails (returns false) on any mismatch
+bool loadMaterialCache(uint64_t key, materialBake& bake);
+void saveMaterialCache(uint64_t key, const materialBake& bake);
+
+// creates a repeating, trilinear texture from the stored levels (needs a GL context)
+GLuint uploadMaterialTexture(const materialTexture& tex);
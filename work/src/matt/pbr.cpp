@@ -2,17 +2,30 @@
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <cstdlib>
 #include <algorithm>
+#include <future>
+#include <memory>
+#include <vector>
 
 // glm
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "cgra/cgra_cache.hpp"
 #include "cgra/cgra_image.hpp"
+#include "cgra/cgra_mipmap.hpp"
 #include "cgra/cgra_shader.hpp"
+#include "cgra/cgra_shader_watcher.hpp"
+#include "cgra/cgra_trace.hpp"
+#include "matt/brdf_lut.hpp"
+#include "matt/environment_loader.hpp"
+#include "matt/ibl_cache.hpp"
+#include "matt/material_cache.hpp"
 #include "matt/pbr.hpp"
 #include "matt/render_utils.hpp"
+#include "matt/sh_irradiance.hpp"
 
 textureData gold;
 textureData plastic;
@@ -21,6 +34,7 @@ textureData cloth;
 GLuint m_shader = 0;
 GLuint m_default_shader = 0;
 GLuint m_pbr_shader = 0;
+GLuint m_pbr_tangent_shader = 0;
 GLuint m_cubemap_shader = 0;
 GLuint m_irradiance_shader = 0;
 GLuint m_prefilter_shader = 0;
@@ -35,49 +49,105 @@ unsigned int brdfLUTTexture = 0;
 unsigned int envCubemap = 0;
 unsigned int hdrTexture = 0;
 
-GLuint loadTexture(char const* path) {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data) {
-		GLenum format = GL_RGB; // default initialization
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
+const bool useIrradianceSH = true;
+shIrradiance irradianceSH;
+
+// false to keep the material textures uncompressed (RGB8 albedo and ORM, RG8 normal)
+const bool compressMaterials = true;
+
+namespace {
+	// a decoded 8 bit image, the file as is (flipped only if stb's flag is set)
+	struct decodedImage {
+		std::string path;
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		std::unique_ptr<unsigned char, void(*)(void*)> pixels{ nullptr, stbi_image_free };
+	};
+
+	// safe to run on several threads at once, as long as nobody changes the flip flag meanwhile
+	decodedImage decodeImage(const std::string& path) {
+		CGRA_TRACE_ZONE("decodeImage");
+		decodedImage image;
+		image.path = path;
+		image.pixels.reset(stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0));
+		return image;
 	}
-	else {
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
+
+	GLuint uploadTexture(const decodedImage& image, bool srgb) {
+		unsigned int textureID;
+		glGenTextures(1, &textureID);
+
+		if (image.pixels) {
+			GLenum format = GL_RGB; // default initialization
+			if (image.channels == 1)
+				format = GL_RED;
+			else if (image.channels == 3)
+				format = GL_RGB;
+			else if (image.channels == 4)
+				format = GL_RGBA;
+
+			glBindTexture(GL_TEXTURE_2D, textureID);
+
+			// the textures repeat, and sRGB colours are averaged in linear space
+			cgra::mip_options options;
+			options.filter = cgra::mip_filter::kaiser;
+			options.srgb = srgb && image.channels >= 3;
+			options.wrap = true;
+			cgra::upload_mipmaps(GL_TEXTURE_2D, format, format, cgra::cached_mipmaps(image.pixels.get(), image.width, image.height, image.channels, options));
+
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+		else {
+			std::cout << "Texture failed to load at path: " << image.path << std::endl;
+		}
+		return textureID;
 	}
-	return textureID;
 }
 
-textureData loadPBRTextures(const std::string& basePath) {
-	textureData tex;
+GLuint loadTexture(char const* path, bool srgb) {
+	return uploadTexture(decodeImage(path), srgb);
+}
+
+std::vector<textureData> loadPBRTextures(const std::vector<std::string>& basePaths) {
+	CGRA_TRACE_ZONE("loadPBRTextures");
+	auto start = std::chrono::steady_clock::now();
+
+	// BC1 needs the s3tc extension (BC5 is core), without it everything stays uncompressed
+	bool compress = compressMaterials && GLEW_EXT_texture_compression_s3tc;
+
+	// each material loads from the cache, or is baked and saved, on its own thread
+	std::vector<std::future<materialBake>> baked;
+	for (const std::string& basePath : basePaths) {
+		baked.push_back(std::async(std::launch::async, [basePath, compress] {
+			materialBake bake;
+			uint64_t key = materialCacheKey(basePath, compress);
+			if (key && loadMaterialCache(key, bake)) return bake;
+			bake = bakeMaterial(basePath, compress);
+			if (key) saveMaterialCache(key, bake);
+			return bake;
+		}));
+	}
 
-	tex.albedo = loadTexture((basePath + "/albedo.png").c_str());
-	tex.normal = loadTexture((basePath + "/normal.png").c_str());
-	tex.metallic = loadTexture((basePath + "/metallic.png").c_str());
-	tex.roughness = loadTexture((basePath + "/roughness.png").c_str());
-	tex.ao = loadTexture((basePath + "/ao.png").c_str());
+	// and upload them on this thread in order, while the rest are still loading
+	std::vector<textureData> materials(basePaths.size());
+	for (size_t i = 0; i < materials.size(); i++) {
+		materialBake bake = baked[i].get();
+		materials[i].albedo = uploadMaterialTexture(bake.albedo);
+		materials[i].normal = uploadMaterialTexture(bake.normal);
+		materials[i].orm = uploadMaterialTexture(bake.orm);
+	}
 
-	return tex;
+	std::cout << "Loaded " << materials.size() << " materials in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << "ms" << std::endl;
+	return materials;
+}
+
+textureData loadPBRTextures(const std::string& basePath) {
+	return loadPBRTextures(std::vector<std::string>{ basePath })[0];
 }
 
 void bindPBRTextures(const textureData& tex) {
@@ -86,42 +156,35 @@ void bindPBRTextures(const textureData& tex) {
 	glActiveTexture(GL_TEXTURE4);
 	glBindTexture(GL_TEXTURE_2D, tex.normal);
 	glActiveTexture(GL_TEXTURE5);
-	glBindTexture(GL_TEXTURE_2D, tex.metallic);
-	glActiveTexture(GL_TEXTURE6);
-	glBindTexture(GL_TEXTURE_2D, tex.roughness);
-	glActiveTexture(GL_TEXTURE7);
-	glBindTexture(GL_TEXTURE_2D, tex.ao);
+	glBindTexture(GL_TEXTURE_2D, tex.orm);
 }
 
-void loadPBRShaders(const std::string& hdrPath = CGRA_SRCDIR + std::string("//res//textures//space.hdr")) {
-	glUseProgram(m_pbr_shader);
-	glUniform1i(glGetUniformLocation(m_pbr_shader, "irradianceMap"), 0);
-	glUniform1i(glGetUniformLocation(m_pbr_shader, "prefilterMap"), 1);
-	glUniform1i(glGetUniformLocation(m_pbr_shader, "brdfLUT"), 2);
-	glUniform1i(glGetUniformLocation(m_pbr_shader, "albedoMap"), 3);
-	glUniform1i(glGetUniformLocation(m_pbr_shader, "normalMap"), 4);
-	glUniform1i(glGetUniformLocation(m_pbr_shader, "metallicMap"), 5);
-	glUniform1i(glGetUniformLocation(m_pbr_shader, "roughnessMap"), 6);
-	glUniform1i(glGetUniformLocation(m_pbr_shader, "aoMap"), 7);
-
-	glUseProgram(m_background_shader);
-	glUniform1i(glGetUniformLocation(m_background_shader, "environmentMap"), 0);
-
-	// texture loading
-	static bool texturesLoaded = false;
-	if (!texturesLoaded) {
-		gold = loadPBRTextures(CGRA_SRCDIR + std::string("/res/textures/gold"));
-		plastic = loadPBRTextures(CGRA_SRCDIR + std::string("/res/textures/plastic"));
-		cloth = loadPBRTextures(CGRA_SRCDIR + std::string("/res/textures/cloth"));
-		texturesLoaded = true;
+// the camera uniforms of both pbr permutations, once a frame
+void setPBRCamera(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos) {
+	for (GLuint shader : { m_pbr_shader, m_pbr_tangent_shader }) {
+		glUseProgram(shader);
+		glUniformMatrix4fv(cgra::uniform_location(shader, "projection"), 1, GL_FALSE, glm::value_ptr(proj));
+		glUniformMatrix4fv(cgra::uniform_location(shader, "view"), 1, GL_FALSE, glm::value_ptr(view));
+		glUniform3fv(cgra::uniform_location(shader, "camPos"), 1, glm::value_ptr(camPos));
 	}
+}
+
+// the permutation for the mesh's vertex attributes, with the per draw uniforms for its model matrix
+GLuint usePBRShader(const cgra::gl_mesh& mesh, const glm::mat4& model) {
+	GLuint shader = mesh.has_tangents ? m_pbr_tangent_shader : m_pbr_shader;
+	glUseProgram(shader);
+	glUniformMatrix4fv(cgra::uniform_location(shader, "model"), 1, GL_FALSE, glm::value_ptr(model * mesh.position_transform));
+
+	// both without the position transform, which only maps the packed positions
+	glm::mat3 linear(model);
+	glUniformMatrix3fv(cgra::uniform_location(shader, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(linear))));
+	glUniformMatrix3fv(cgra::uniform_location(shader, "tangentMatrix"), 1, GL_FALSE, glm::value_ptr(linear));
+	return shader;
+}
 
-	// Clean up old textures if they exist
-	if (hdrTexture != 0) glDeleteTextures(1, &hdrTexture);
-	if (envCubemap != 0) glDeleteTextures(1, &envCubemap);
-	if (irradianceMap != 0) glDeleteTextures(1, &irradianceMap);
-	if (prefilterMap != 0) glDeleteTextures(1, &prefilterMap);
-	if (brdfLUTTexture != 0) glDeleteTextures(1, &brdfLUTTexture);
+// renders the environment cubemap, irradiance map (unless SH is used) and prefiltered map
+void bakeEnvironment(iblMaps& maps) {
+	CGRA_TRACE_ZONE("bakeEnvironment");
 
 	//pbr framebuffer
 	unsigned int captureFBO;
@@ -134,29 +197,9 @@ void loadPBRShaders(const std::string& hdrPath = CGRA_SRCDIR + std::string("//re
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 1024, 1024);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
 
-	//load hdr environment map
-	stbi_set_flip_vertically_on_load(true);
-	int width, height, nrComponents;
-	float* data = stbi_loadf(hdrPath.c_str(), &width, &height, &nrComponents, 0);
-	if (data) {
-		glGenTextures(1, &hdrTexture);
-		glBindTexture(GL_TEXTURE_2D, hdrTexture);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else {
-		std::cout << "Failed to load HDR image." << std::endl;
-	}
-
 	// create cubemap
-	glGenTextures(1, &envCubemap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+	glGenTextures(1, &maps.environment);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, maps.environment);
 
 	for (unsigned int i = 0; i < 6; ++i) {
 		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F,
@@ -180,62 +223,64 @@ void loadPBRShaders(const std::string& hdrPath = CGRA_SRCDIR + std::string("//re
 
 	// convert HDR to cubemap
 	glUseProgram(m_cubemap_shader);
-	glUniform1i(glGetUniformLocation(m_cubemap_shader, "equirectangularMap"), 0);
-	glUniformMatrix4fv(glGetUniformLocation(m_cubemap_shader, "projection"), 1, GL_FALSE, glm::value_ptr(captureProjection));
+	glUniform1i(cgra::uniform_location(m_cubemap_shader, "equirectangularMap"), 0);
+	glUniformMatrix4fv(cgra::uniform_location(m_cubemap_shader, "projection"), 1, GL_FALSE, glm::value_ptr(captureProjection));
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, hdrTexture);
+	glBindTexture(GL_TEXTURE_2D, maps.hdr);
 
 	glViewport(0, 0, 1024, 1024);
 	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
 	for (unsigned int i = 0; i < 6; i++) {
-		glUniformMatrix4fv(glGetUniformLocation(m_cubemap_shader, "view"), 1, GL_FALSE, glm::value_ptr(captureViews[i]));
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
+		glUniformMatrix4fv(cgra::uniform_location(m_cubemap_shader, "view"), 1, GL_FALSE, glm::value_ptr(captureViews[i]));
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, maps.environment, 0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		renderCube();
 	}
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, maps.environment);
 	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-	// create irradiance cubemap
-	glGenTextures(1, &irradianceMap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-	for (unsigned int i = 0; i < 6; ++i) {
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
-	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-	// solve diffuse integral by convolution to create an irradiance cubemap
-	glUseProgram(m_irradiance_shader);
-	glUniform1i(glGetUniformLocation(m_irradiance_shader, "environmentMap"), 0);
-	glUniformMatrix4fv(glGetUniformLocation(m_irradiance_shader, "projection"), 1, GL_FALSE, glm::value_ptr(captureProjection));
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+	// create irradiance cubemap (not needed when the SH irradiance is used)
+	if (!useIrradianceSH) {
+		glGenTextures(1, &maps.irradiance);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, maps.irradiance);
+		for (unsigned int i = 0; i < 6; ++i) {
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
+		}
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	glViewport(0, 0, 32, 32);
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	for (unsigned int i = 0; i < 6; i++) {
-		glUniformMatrix4fv(glGetUniformLocation(m_irradiance_shader, "view"), 1, GL_FALSE, glm::value_ptr(captureViews[i]));
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+		glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
+
+		// solve diffuse integral by convolution to create an irradiance cubemap
+		glUseProgram(m_irradiance_shader);
+		glUniform1i(cgra::uniform_location(m_irradiance_shader, "environmentMap"), 0);
+		glUniformMatrix4fv(cgra::uniform_location(m_irradiance_shader, "projection"), 1, GL_FALSE, glm::value_ptr(captureProjection));
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, maps.environment);
+
+		glViewport(0, 0, 32, 32);
+		glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+		for (unsigned int i = 0; i < 6; i++) {
+			glUniformMatrix4fv(cgra::uniform_location(m_irradiance_shader, "view"), 1, GL_FALSE, glm::value_ptr(captureViews[i]));
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, maps.irradiance, 0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		renderCube();
+			renderCube();
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	// pre-filter cubemap
-	glGenTextures(1, &prefilterMap);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+	glGenTextures(1, &maps.prefilter);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, maps.prefilter);
 	for (unsigned int i = 0; i < 6; i++) {
 		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 256, 256, 0, GL_RGB, GL_FLOAT, nullptr);
 	}
@@ -248,10 +293,10 @@ void loadPBRShaders(const std::string& hdrPath = CGRA_SRCDIR + std::string("//re
 
 	// run a quasi Monte Carlo simulation to generate a pre-filtered environment cubemap
 	glUseProgram(m_prefilter_shader);
-	glUniform1i(glGetUniformLocation(m_prefilter_shader, "environmentMap"), 0);
-	glUniformMatrix4fv(glGetUniformLocation(m_prefilter_shader, "projection"), 1, GL_FALSE, glm::value_ptr(captureProjection));
+	glUniform1i(cgra::uniform_location(m_prefilter_shader, "environmentMap"), 0);
+	glUniformMatrix4fv(cgra::uniform_location(m_prefilter_shader, "projection"), 1, GL_FALSE, glm::value_ptr(captureProjection));
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, maps.environment);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
 	unsigned int maxMipLevels = 5;
@@ -264,10 +309,10 @@ void loadPBRShaders(const std::string& hdrPath = CGRA_SRCDIR + std::string("//re
 		glViewport(0, 0, mipWidth, mipHeight);
 
 		float roughness = (float)mip / (float)(maxMipLevels - 1);
-		glUniform1f(glGetUniformLocation(m_prefilter_shader, "roughness"), roughness);
+		glUniform1f(cgra::uniform_location(m_prefilter_shader, "roughness"), roughness);
 		for (unsigned int i = 0; i < 6; ++i) {
-			glUniformMatrix4fv(glGetUniformLocation(m_prefilter_shader, "view"), 1, GL_FALSE, glm::value_ptr(captureViews[i]));
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, prefilterMap, mip);
+			glUniformMatrix4fv(cgra::uniform_location(m_prefilter_shader, "view"), 1, GL_FALSE, glm::value_ptr(captureViews[i]));
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, maps.prefilter, mip);
 
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 			renderCube();
@@ -275,72 +320,131 @@ void loadPBRShaders(const std::string& hdrPath = CGRA_SRCDIR + std::string("//re
 	}
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-	// generate BRDF lookup texture
-	glGenTextures(1, &brdfLUTTexture);
+	// clean up buffers
+	glDeleteFramebuffers(1, &captureFBO);
+	glDeleteRenderbuffers(1, &captureRBO);
+}
 
-	// pre-allocate enough memory for the LUT texture.
-	glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, 512, 512, 0, GL_RG, GL_FLOAT, 0);
-	// be sure to set wrapping mode to GL_CLAMP_TO_EDGE
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+// static uniforms (set once, and again whenever the program is hot-reloaded)
+// expects the program to be bound
+void setPBRUniforms(GLuint shader) {
+	glUniform1i(cgra::uniform_location(shader, "irradianceMap"), 0);
+	glUniform1i(cgra::uniform_location(shader, "prefilterMap"), 1);
+	glUniform1i(cgra::uniform_location(shader, "brdfLUT"), 2);
+	glUniform1i(cgra::uniform_location(shader, "albedoMap"), 3);
+	glUniform1i(cgra::uniform_location(shader, "normalMap"), 4);
+	glUniform1i(cgra::uniform_location(shader, "ormMap"), 5);
 
-	// then re-configure capture framebuffer object and render screen-space quad with BRDF shader.
-	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), float(1280) / float(720), 0.1f, 100.f);
+	glUniformMatrix4fv(cgra::uniform_location(shader, "projection"), 1, false, value_ptr(projection));
 
-	glViewport(0, 0, 512, 512);
-	glUseProgram(m_brdf_shader);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	renderQuad();
+	// only present in the IRRADIANCE_SH permutation
+	glUniform3fv(cgra::uniform_location(shader, "shCoeffs"), 9, value_ptr(irradianceSH.coeffs[0]));
+}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void setBackgroundUniforms(GLuint shader) {
+	glUniform1i(cgra::uniform_location(shader, "environmentMap"), 0);
 
-	// initialize static shader uniforms
 	glm::mat4 projection = glm::perspective(glm::radians(90.0f), float(1280) / float(720), 0.1f, 100.f);
-	glUseProgram(m_pbr_shader);
-	glUniformMatrix4fv(glGetUniformLocation(m_pbr_shader, "projection"), 1, false, value_ptr(projection));
-	glUseProgram(m_background_shader);
-	glUniformMatrix4fv(glGetUniformLocation(m_background_shader, "projection"), 1, false, value_ptr(projection));
+	glUniformMatrix4fv(cgra::uniform_location(shader, "projection"), 1, false, value_ptr(projection));
+}
 
-	// clean up buffers
-	glDeleteFramebuffers(1, &captureFBO);
-	glDeleteRenderbuffers(1, &captureRBO);
+void loadPBRShaders(const std::string& hdrPath = CGRA_SRCDIR + std::string("//res//textures//space.hdr")) {
+	CGRA_TRACE_ZONE("loadPBRShaders");
+
+	// texture loading
+	static bool texturesLoaded = false;
+	if (!texturesLoaded) {
+		std::vector<textureData> materials = loadPBRTextures({
+			CGRA_SRCDIR + std::string("/res/textures/gold"),
+			CGRA_SRCDIR + std::string("/res/textures/plastic"),
+			CGRA_SRCDIR + std::string("/res/textures/cloth")
+		});
+		gold = materials[0];
+		plastic = materials[1];
+		cloth = materials[2];
+		texturesLoaded = true;
+	}
+
+	// the BRDF LUT doesn't depend on the environment, so it is only made once. a freshly baked
+	// table is checked against the GPU integration in brdf.fs, as is every run with CGRA_VALIDATE_BRDF_LUT set
+	if (brdfLUTTexture == 0) {
+		bool baked = false;
+		brdfLUTTexture = loadBRDFLUT(512, &baked);
+		if (baked || std::getenv("CGRA_VALIDATE_BRDF_LUT")) validateBRDFLUT(m_brdf_shader);
+	}
+
+	// the first environment is needed straight away, later ones load in the background
+	requestEnvironment(hdrPath);
+	finishEnvironmentLoad();
+}
+
+void setEnvironment(const iblMaps& maps) {
+	CGRA_TRACE_ZONE("setEnvironment");
+
+	// the textures are owned by the environment manager, this only swaps the handles
+	hdrTexture = maps.hdr;
+	envCubemap = maps.environment;
+	irradianceMap = maps.irradiance;
+	prefilterMap = maps.prefilter;
+	irradianceSH = maps.irradianceSH;
+
+	// the SH coefficients depend on the environment
+	GLint lastProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &lastProgram);
+	for (GLuint shader : { m_pbr_shader, m_pbr_tangent_shader }) {
+		glUseProgram(shader);
+		setPBRUniforms(shader);
+	}
+	glUseProgram(m_background_shader);
+	setBackgroundUniforms(m_background_shader);
+	glUseProgram(lastProgram);
 }
 
 void buildShaders() {
+	CGRA_TRACE_ZONE("buildShaders");
+
 	cgra::shader_builder sb;
 	sb.set_shader(GL_VERTEX_SHADER, CGRA_SRCDIR + std::string("//res//shaders//color_vert.glsl"));
 	sb.set_shader(GL_FRAGMENT_SHADER, CGRA_SRCDIR + std::string("//res//shaders//color_frag.glsl"));
 	m_default_shader = sb.build();
+	cgra::shader_watcher::watch(m_default_shader, sb);
 
 	sb.set_shader(GL_VERTEX_SHADER, CGRA_SRCDIR + std::string("//res//shaders//pbr.vs"));
 	sb.set_shader(GL_FRAGMENT_SHADER, CGRA_SRCDIR + std::string("//res//shaders//pbr.fs"));
-	m_pbr_shader = sb.build();
+	cgra::shader_defines pbrDefines;
+	if (useIrradianceSH) pbrDefines["IRRADIANCE_SH"] = "1";
+	m_pbr_shader = sb.build(pbrDefines);
+	cgra::shader_watcher::watch(m_pbr_shader, sb, pbrDefines, setPBRUniforms);
+	// usePBRShader picks between them by whether the mesh has tangents
+	pbrDefines["HAS_TANGENTS"] = "1";
+	m_pbr_tangent_shader = sb.build(pbrDefines);
+	cgra::shader_watcher::watch(m_pbr_tangent_shader, sb, pbrDefines, setPBRUniforms);
 
 	sb.set_shader(GL_VERTEX_SHADER, CGRA_SRCDIR + std::string("//res//shaders//cubemap.vs"));
 	sb.set_shader(GL_FRAGMENT_SHADER, CGRA_SRCDIR + std::string("//res//shaders//cubemap.fs"));
 	m_cubemap_shader = sb.build();
+	cgra::shader_watcher::watch(m_cubemap_shader, sb);
 
 	sb.set_shader(GL_VERTEX_SHADER, CGRA_SRCDIR + std::string("//res//shaders//cubemap.vs"));
 	sb.set_shader(GL_FRAGMENT_SHADER, CGRA_SRCDIR + std::string("//res//shaders//irradiance.fs"));
 	m_irradiance_shader = sb.build();
+	cgra::shader_watcher::watch(m_irradiance_shader, sb);
 
 	sb.set_shader(GL_VERTEX_SHADER, CGRA_SRCDIR + std::string("//res//shaders//cubemap.vs"));
 	sb.set_shader(GL_FRAGMENT_SHADER, CGRA_SRCDIR + std::string("//res//shaders//prefilter.fs"));
 	m_prefilter_shader = sb.build();
+	cgra::shader_watcher::watch(m_prefilter_shader, sb);
 
 	sb.set_shader(GL_VERTEX_SHADER, CGRA_SRCDIR + std::string("//res//shaders//brdf.vs"));
 	sb.set_shader(GL_FRAGMENT_SHADER, CGRA_SRCDIR + std::string("//res//shaders//brdf.fs"));
 	m_brdf_shader = sb.build();
+	cgra::shader_watcher::watch(m_brdf_shader, sb);
 
 	sb.set_shader(GL_VERTEX_SHADER, CGRA_SRCDIR + std::string("//res//shaders//background.vs"));
 	sb.set_shader(GL_FRAGMENT_SHADER, CGRA_SRCDIR + std::string("//res//shaders//background.fs"));
 	m_background_shader = sb.build();
+	cgra::shader_watcher::watch(m_background_shader, sb, setBackgroundUniforms);
 
 	loadPBRShaders();
 }
\ No newline at end of file
@@ -1,12 +1,22 @@
 #pragma once
 
-// texture data struct
+// std
+#include <string>
+#include <vector>
+
+// glm
+#include <glm/glm.hpp>
+
+// project
+#include "opengl.hpp"
+#include "cgra/cgra_mesh.hpp"
+#include "matt/sh_irradiance.hpp"
+
+// texture data struct (see matt/material_cache.hpp for what each texture holds)
 struct textureData {
 	GLuint albedo = 0;
 	GLuint normal = 0;
-	GLuint metallic = 0;
-	GLuint roughness = 0;
-	GLuint ao = 0;
+	GLuint orm = 0; // ao, roughness and metallic
 };
 
 // textures
@@ -17,7 +27,8 @@ extern textureData cloth;
 // shaders
 extern GLuint m_shader;
 extern GLuint m_default_shader;
-extern GLuint m_pbr_shader;
+extern GLuint m_pbr_shader; // for meshes without tangents, normal maps use screen space derivatives
+extern GLuint m_pbr_tangent_shader; // the HAS_TANGENTS permutation, for meshes with cgra::mesh_builder::generate_tangents
 extern GLuint m_cubemap_shader;
 extern GLuint m_irradiance_shader;
 extern GLuint m_prefilter_shader;
@@ -32,8 +43,34 @@ extern unsigned int brdfLUTTexture;
 extern unsigned int envCubemap;
 extern unsigned int hdrTexture;
 
-GLuint loadTexture(char const* path);
+// false to convolve a 32x32 irradiance cubemap instead of using 9 SH coefficients
+extern const bool useIrradianceSH;
+
+// the maps for one environment, swapped in all at once by setEnvironment
+struct iblMaps {
+	GLuint hdr = 0;         // equirectangular source, 0 when loaded from the IBL cache
+	GLuint environment = 0;
+	GLuint irradiance = 0;  // 0 when the SH irradiance is used
+	GLuint prefilter = 0;
+	shIrradiance irradianceSH;
+};
+
+// srgb for colour maps, so their mips are filtered in linear space
+GLuint loadTexture(char const* path, bool srgb = false);
 textureData loadPBRTextures(const std::string& basePath);
+// loads every material in parallel from res/cache/materials, packing and
+// compressing the PNGs (and caching the result) the first time
+std::vector<textureData> loadPBRTextures(const std::vector<std::string>& basePaths);
 void bindPBRTextures(const textureData& tex);
+// sets the camera uniforms of both pbr shader permutations, once a frame before any usePBRShader
+void setPBRCamera(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos);
+// binds the pbr shader permutation for mesh's vertex attributes and sets its model, normalMatrix and tangentMatrix
+// uniforms for the model matrix (the mesh's position_transform is added to model here)
+GLuint usePBRShader(const cgra::gl_mesh& mesh, const glm::mat4& model);
 void loadPBRShaders(const std::string& hdrPath);
+
+// renders the cubemaps for maps.hdr, creating the other textures in maps
+void bakeEnvironment(iblMaps& maps);
+// makes an environment current (the textures are owned by the environment manager)
+void setEnvironment(const iblMaps& maps);
 void buildShaders();
\ No newline at end of file
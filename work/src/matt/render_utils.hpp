@@ -1,5 +1,14 @@
 #pragma once
 
-void renderSphere();
+#include <glm/glm.hpp>
+
+#include <opengl.hpp>
+
+#include "cgra/cgra_bvh.hpp"
+
+// draws a unit sphere with the pbr shader (see usePBRShader), at a level of detail for its size on screen
+void renderSphere(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj, float viewportHeight);
+// the finest sphere drawn by renderSphere, for picking
+const cgra::triangle_bvh& sphereBvh();
 void renderCube();
 void renderQuad();
\ No newline at end of file
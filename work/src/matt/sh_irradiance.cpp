@@ -0,0 +1,112 @@
+
+// std
+#include <cmath>
+#include <vector>
+
+#include "cgra/cgra_hdr.hpp"
+#include "cgra/cgra_trace.hpp"
+#include "matt/sh_irradiance.hpp"
+
+namespace {
+	const double PI = 3.14159265358979323846;
+
+	// real SH basis constants for bands 0-2
+	const double basis[9] = {
+		0.282095,
+		0.488603, 0.488603, 0.488603,
+		1.092548, 1.092548, 0.315392, 1.092548, 0.546274
+	};
+
+	// cosine lobe convolution per band divided by pi (pi, 2pi/3, pi/4 over pi)
+	const double band[9] = {
+		1.0,
+		2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0,
+		0.25, 0.25, 0.25, 0.25, 0.25
+	};
+
+	// basis polynomials without their constants, in the order used by pbr.fs
+	void polynomials(double x, double y, double z, double p[9]) {
+		p[0] = 1.0;
+		p[1] = y;
+		p[2] = z;
+		p[3] = x;
+		p[4] = x * y;
+		p[5] = y * z;
+		p[6] = 3.0 * z * z - 1.0;
+		p[7] = x * z;
+		p[8] = x * x - y * y;
+	}
+
+	// row(y, buffer) returns row y as floats, converting into buffer if it has to
+	template <typename RowFn>
+	shIrradiance project(int width, int height, int channels, RowFn row) {
+		// per row sums (so the result doesn't depend on the number of threads)
+		std::vector<double> rows(size_t(height) * 27, 0.0);
+
+#ifdef CGRA_HAVE_OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+		for (int y = 0; y < height; y++) {
+			// same mapping as SampleSphericalMap in cubemap.fs, v = asin(dir.y) / pi + 0.5
+			double latitude = ((y + 0.5) / height - 0.5) * PI;
+			double cosLat = std::cos(latitude);
+			double sinLat = std::sin(latitude);
+			double solidAngle = (2.0 * PI / width) * (PI / height) * cosLat;
+
+			double* sum = &rows[size_t(y) * 27];
+			std::vector<float> buffer;
+			const float* texels = row(y, buffer);
+			for (int x = 0; x < width; x++) {
+				// u = atan(dir.z, dir.x) / 2pi + 0.5
+				double phi = ((x + 0.5) / width - 0.5) * 2.0 * PI;
+				double p[9];
+				polynomials(cosLat * std::cos(phi), sinLat, cosLat * std::sin(phi), p);
+
+				const float* texel = texels + size_t(x) * channels;
+				for (int i = 0; i < 9; i++) {
+					double w = p[i] * solidAngle;
+					sum[i * 3 + 0] += texel[0] * w;
+					sum[i * 3 + 1] += texel[1] * w;
+					sum[i * 3 + 2] += texel[2] * w;
+				}
+			}
+		}
+
+		double total[27] = {};
+		for (int y = 0; y < height; y++) {
+			for (int i = 0; i < 27; i++) total[i] += rows[size_t(y) * 27 + i];
+		}
+
+		// projection uses the basis constant once, evaluation once more
+		shIrradiance sh;
+		for (int i = 0; i < 9; i++) {
+			double scale = basis[i] * basis[i] * band[i];
+			sh.coeffs[i] = glm::vec3(total[i * 3] * scale, total[i * 3 + 1] * scale, total[i * 3 + 2] * scale);
+		}
+		return sh;
+	}
+}
+
+shIrradiance projectIrradianceSH(const float* data, int width, int height, int channels) {
+	CGRA_TRACE_ZONE("projectIrradianceSH");
+	return project(width, height, channels, [=](int y, std::vector<float>&) {
+		return data + size_t(y) * width * channels;
+	});
+}
+
+shIrradiance projectIrradianceSH(const uint16_t* data, int width, int height) {
+	CGRA_TRACE_ZONE("projectIrradianceSH");
+	return project(width, height, 3, [=](int y, std::vector<float>& buffer) {
+		buffer.resize(size_t(width) * 3);
+		cgra::half_to_float(data + size_t(y) * width * 3, buffer.data(), buffer.size());
+		return static_cast<const float*>(buffer.data());
+	});
+}
+
+glm::vec3 evaluateIrradianceSH(const shIrradiance& sh, const glm::vec3& n) {
+	double p[9];
+	polynomials(n.x, n.y, n.z, p);
+	glm::vec3 irradiance(0.0f);
+	for (int i = 0; i < 9; i++) irradiance += sh.coeffs[i] * float(p[i]);
+	return glm::max(irradiance, glm::vec3(0.0f));
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// std
+#include <cstdint>
+
+// glm
+#include <glm/glm.hpp>
+
+// diffuse irradiance as 9 spherical harmonic coefficients per channel (bands 0-2).
+// the coefficients are premultiplied by the SH basis constants and the cosine lobe
+// convolution (and divided by pi, like the irradiance cubemap), see irradianceSH in pbr.fs
+struct shIrradiance {
+	glm::vec3 coeffs[9] = {};
+};
+
+// projects an equirectangular radiance map (rows bottom to top, as loaded with
+// stbi_set_flip_vertically_on_load) onto SH irradiance, rows are processed in parallel
+shIrradiance projectIrradianceSH(const float* data, int width, int height, int channels);
+
+// same, for RGB half floats (a cgra::hdr_image)
+shIrradiance projectIrradianceSH(const uint16_t* data, int width, int height);
+
+// evaluates the irradiance for a normal, same as pbr.fs (for checking on the CPU)
+glm::vec3 evaluateIrradianceSH(const shIrradiance& sh, const glm::vec3& n);